@@ -98,6 +98,12 @@ ATOMIC_INLINE int64_t atomic_fetch_and_sub_int64(int64_t *p, int64_t x)
 {
 	return InterlockedExchangeAdd64(p, -x);
 }
+
+/* Aligned loads are atomic, volatile adds acquire semantics with MSVC. */
+ATOMIC_INLINE uint64_t atomic_load_uint64(const uint64_t *v)
+{
+	return *(const volatile uint64_t *)v;
+}
 #endif
 
 /******************************************************************************/
@@ -133,6 +139,11 @@ ATOMIC_INLINE uint32_t atomic_fetch_and_and_uint32(uint32_t *p, uint32_t x)
 	return InterlockedAnd((long *)p, x);
 }
 
+ATOMIC_INLINE uint32_t atomic_load_uint32(const uint32_t *v)
+{
+	return *(const volatile uint32_t *)v;
+}
+
 /* Signed */
 ATOMIC_INLINE int32_t atomic_add_and_fetch_int32(int32_t *p, int32_t x)
 {
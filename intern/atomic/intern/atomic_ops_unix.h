@@ -199,6 +199,11 @@ ATOMIC_INLINE int64_t atomic_cas_int64(int64_t *v, int64_t old, int64_t _new)
 #  else
 #    error "Missing implementation for 64-bit atomic operations"
 #  endif
+
+ATOMIC_INLINE uint64_t atomic_load_uint64(const uint64_t *v)
+{
+	return __atomic_load_n(v, __ATOMIC_SEQ_CST);
+}
 #endif
 
 /******************************************************************************/
@@ -309,6 +314,11 @@ ATOMIC_INLINE int32_t atomic_cas_int32(int32_t *v, int32_t old, int32_t _new)
 #  error "Missing implementation for 32-bit atomic operations"
 #endif
 
+ATOMIC_INLINE uint32_t atomic_load_uint32(const uint32_t *v)
+{
+	return __atomic_load_n(v, __ATOMIC_SEQ_CST);
+}
+
 #if (defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4) || defined(JE_FORCE_SYNC_COMPARE_AND_SWAP_4))
 /* Unsigned */
 ATOMIC_INLINE uint32_t atomic_fetch_and_add_uint32(uint32_t *p, uint32_t x)
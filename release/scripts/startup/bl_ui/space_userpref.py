@@ -526,6 +526,8 @@ class USERPREF_PT_system(Panel):
 
         col.separator()
         col.prop(system, "gpu_viewport_quality")
+        col.prop(system, "use_gpu_mesh_lod")
+        col.prop(system, "use_gpu_occlusion_culling")
 
         col.separator()
         col.label(text="Grease Pencil Options:")
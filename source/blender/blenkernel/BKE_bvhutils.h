@@ -200,6 +200,12 @@ bool     bvhcache_find(const BVHCache *cache, int type, BVHTree **r_tree);
 bool     bvhcache_has_tree(const BVHCache *cache, const BVHTree *tree);
 void     bvhcache_insert(BVHCache **cache_p, BVHTree *tree, int type);
 void     bvhcache_free(BVHCache **cache_p);
+void     bvhcache_refit_from_mesh(BVHCache **cache_p, const struct Mesh *mesh);
+
+typedef struct BVHCacheStash BVHCacheStash;
+void     bvhcache_stash_from_mesh(BVHCacheStash **stash_p, struct Mesh *mesh);
+void     bvhcache_unstash_to_mesh(BVHCacheStash **stash_p, struct Mesh *mesh);
+void     bvhcache_stash_free(BVHCacheStash **stash_p);
 
 
 #endif
@@ -74,6 +74,8 @@ typedef enum eCDAllocType {
 	CD_REFERENCE = 3,  /* use data pointers, set layer flag NOFREE */
 	CD_DUPLICATE = 4,  /* do a full copy of all layers, only allowed if source
 	                    * has same number of elements */
+	CD_SHARE     = 5,  /* use data pointers, set layer flags NOFREE and SHARED, the data
+	                    * stays valid until the last layer sharing it is freed */
 } eCDAllocType;
 
 #define CD_TYPE_AS_MASK(_type) (CustomDataMask)((CustomDataMask)1 << (CustomDataMask)(_type))
@@ -164,6 +166,10 @@ void CustomData_free_typemask(struct CustomData *data, int totelem, CustomDataMa
 /* frees all layers with CD_FLAG_TEMPORARY */
 void CustomData_free_temporary(struct CustomData *data, int totelem);
 
+/* frees a layer data array which was detached from its layer, keeping it alive
+ * while it is still shared with other layers (see CD_SHARE) */
+void CustomData_free_layer_data(int type, void *data, int totelem);
+
 /* adds a data layer of the given type to the CustomData object, optionally
  * backed by an external data array. the different allocation types are
  * defined above. returns the data of the layer.
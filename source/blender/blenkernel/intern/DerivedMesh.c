@@ -2889,6 +2889,8 @@ static void mesh_build_data(
 	        true,
 	        &ob->runtime.mesh_deform_eval, &ob->runtime.mesh_eval);
 
+	bvhcache_unstash_to_mesh(&ob->runtime.bvh_cache_stash, ob->runtime.mesh_eval);
+
 	mesh_finalize_eval(ob);
 
 	ob->derivedDeform = CDDM_from_mesh_ex(ob->runtime.mesh_deform_eval, CD_REFERENCE, CD_MASK_MESH);
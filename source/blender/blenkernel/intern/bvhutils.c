@@ -40,6 +40,7 @@
 #include "BLI_utildefines.h"
 #include "BLI_linklist.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BKE_DerivedMesh.h"
@@ -1536,8 +1537,13 @@ typedef struct BVHCacheItem {
 	int type;
 	BVHTree *tree;
 
+	/* #BLI_bvhtree_calc_branch_area_ratio of the tree when it was built. */
+	float area_ratio_build;
 } BVHCacheItem;
 
+/* Refit trees are removed (to be rebuilt) once traversal gets this much more expensive. */
+#define BVHCACHE_REFIT_AREA_RATIO_LIMIT 1.5f
+
 /**
  * Queries a bvhcache for the cache bvhtree of the request type
  */
@@ -1583,6 +1589,7 @@ void bvhcache_insert(BVHCache **cache_p, BVHTree *tree, int type)
 
 	item->type = type;
 	item->tree = tree;
+	item->area_ratio_build = tree ? BLI_bvhtree_calc_branch_area_ratio(tree) : 0.0f;
 
 	BLI_linklist_prepend(cache_p, item);
 }
@@ -1605,4 +1612,213 @@ void bvhcache_free(BVHCache **cache_p)
 	*cache_p = NULL;
 }
 
+typedef struct BVHCacheRefitData {
+	BVHTree *tree;
+	int type;
+	const MVert *vert;
+	const MEdge *edge;
+	const MFace *face;
+	const MLoop *loop;
+	const MLoopTri *looptri;
+} BVHCacheRefitData;
+
+static void bvhcache_refit_leaf_cb(
+        void *__restrict userdata,
+        const int i,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	const BVHCacheRefitData *data = userdata;
+	const MVert *vert = data->vert;
+	float co[4][3];
+	int co_len = 0;
+
+	switch (data->type) {
+		case BVHTREE_FROM_VERTS:
+			copy_v3_v3(co[0], vert[i].co);
+			co_len = 1;
+			break;
+		case BVHTREE_FROM_EDGES:
+			copy_v3_v3(co[0], vert[data->edge[i].v1].co);
+			copy_v3_v3(co[1], vert[data->edge[i].v2].co);
+			co_len = 2;
+			break;
+		case BVHTREE_FROM_FACES:
+			copy_v3_v3(co[0], vert[data->face[i].v1].co);
+			copy_v3_v3(co[1], vert[data->face[i].v2].co);
+			copy_v3_v3(co[2], vert[data->face[i].v3].co);
+			if (data->face[i].v4) {
+				copy_v3_v3(co[3], vert[data->face[i].v4].co);
+			}
+			co_len = data->face[i].v4 ? 4 : 3;
+			break;
+		case BVHTREE_FROM_LOOPTRI:
+			copy_v3_v3(co[0], vert[data->loop[data->looptri[i].tri[0]].v].co);
+			copy_v3_v3(co[1], vert[data->loop[data->looptri[i].tri[1]].v].co);
+			copy_v3_v3(co[2], vert[data->loop[data->looptri[i].tri[2]].v].co);
+			co_len = 3;
+			break;
+		default:
+			BLI_assert(0);
+			break;
+	}
+
+	BLI_bvhtree_update_node(data->tree, i, co[0], NULL, co_len);
+}
+
+/**
+ * Refit a cached tree to the current vertex positions of \a mesh.
+ *
+ * \return false when the tree can't be refit or refitting degraded it too much.
+ */
+static bool bvhcacheitem_refit_from_mesh(BVHCacheItem *item, const Mesh *mesh)
+{
+	BVHCacheRefitData data = {
+		.tree = item->tree, .type = item->type,
+		.vert = mesh->mvert, .edge = mesh->medge, .face = mesh->mface,
+		.loop = mesh->mloop, .looptri = mesh->runtime.looptris.array,
+	};
+	int leafs_len;
+
+	/* Trees built from a mask (loose elements) store a subset of elements,
+	 * these could be refit too but aren't worth the extra complexity. */
+	switch (item->type) {
+		case BVHTREE_FROM_VERTS:
+			leafs_len = mesh->totvert;
+			break;
+		case BVHTREE_FROM_EDGES:
+			leafs_len = mesh->totedge;
+			break;
+		case BVHTREE_FROM_FACES:
+			leafs_len = mesh->totface;
+			break;
+		case BVHTREE_FROM_LOOPTRI:
+			leafs_len = (data.looptri != NULL) ? mesh->runtime.looptris.len : -1;
+			break;
+		default:
+			return false;
+	}
+
+	if (leafs_len != BLI_bvhtree_get_len(item->tree)) {
+		return false;
+	}
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.use_threading = (leafs_len > BKE_MESH_OMP_LIMIT);
+	BLI_task_parallel_range(0, leafs_len, &data, bvhcache_refit_leaf_cb, &settings);
+
+	BLI_bvhtree_update_tree(item->tree);
+
+	if (item->area_ratio_build != 0.0f) {
+		const float area_ratio = BLI_bvhtree_calc_branch_area_ratio(item->tree);
+		if (area_ratio > item->area_ratio_build * BVHCACHE_REFIT_AREA_RATIO_LIMIT) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Update the trees cached for \a mesh after its vertex positions changed
+ * (the topology must be unchanged), refitting instead of rebuilding them.
+ *
+ * Trees which can't be refit are removed from the cache, to be rebuilt when requested.
+ */
+void bvhcache_refit_from_mesh(BVHCache **cache_p, const Mesh *mesh)
+{
+	BLI_rw_mutex_lock(&cache_rwlock, THREAD_LOCK_WRITE);
+
+	BVHCache **link_p = cache_p;
+	while (*link_p) {
+		BVHCache *link = *link_p;
+		BVHCacheItem *item = link->link;
+
+		if ((item->tree == NULL) || bvhcacheitem_refit_from_mesh(item, mesh)) {
+			link_p = &link->next;
+		}
+		else {
+			*link_p = link->next;
+			bvhcacheitem_free(item);
+			MEM_freeN(link);
+		}
+	}
+
+	BLI_rw_mutex_unlock(&cache_rwlock);
+}
+
+/**
+ * Trees of an evaluated mesh kept past its lifetime,
+ * so the next evaluated mesh of the same object can refit them.
+ */
+struct BVHCacheStash {
+	BVHCache *cache;
+	/* Topology of the mesh the trees were built for. */
+	int totvert, totedge, totface, totloop, totpoly;
+};
+
+/**
+ * Move the trees cached for \a mesh into \a stash_p, replacing the previously stashed trees.
+ */
+void bvhcache_stash_from_mesh(BVHCacheStash **stash_p, Mesh *mesh)
+{
+	bvhcache_stash_free(stash_p);
+
+	if (mesh->runtime.bvh_cache == NULL) {
+		return;
+	}
+
+	BVHCacheStash *stash = MEM_mallocN(sizeof(*stash), __func__);
+	stash->cache = mesh->runtime.bvh_cache;
+	stash->totvert = mesh->totvert;
+	stash->totedge = mesh->totedge;
+	stash->totface = mesh->totface;
+	stash->totloop = mesh->totloop;
+	stash->totpoly = mesh->totpoly;
+	mesh->runtime.bvh_cache = NULL;
+
+	*stash_p = stash;
+}
+
+/**
+ * Give the stashed trees to \a mesh when it has the same topology (and no trees of its own),
+ * refitting them to its vertex positions. Otherwise they are freed.
+ */
+void bvhcache_unstash_to_mesh(BVHCacheStash **stash_p, Mesh *mesh)
+{
+	BVHCacheStash *stash = *stash_p;
+
+	if (stash == NULL) {
+		return;
+	}
+
+	if ((mesh->runtime.bvh_cache == NULL) &&
+	    (stash->totvert == mesh->totvert) &&
+	    (stash->totedge == mesh->totedge) &&
+	    (stash->totface == mesh->totface) &&
+	    (stash->totloop == mesh->totloop) &&
+	    (stash->totpoly == mesh->totpoly))
+	{
+		if (bvhcache_find(stash->cache, BVHTREE_FROM_LOOPTRI, &(BVHTree *){0})) {
+			BKE_mesh_runtime_looptri_ensure(mesh);
+		}
+		mesh->runtime.bvh_cache = stash->cache;
+		stash->cache = NULL;
+		bvhcache_refit_from_mesh(&mesh->runtime.bvh_cache, mesh);
+	}
+
+	bvhcache_stash_free(stash_p);
+}
+
+void bvhcache_stash_free(BVHCacheStash **stash_p)
+{
+	BVHCacheStash *stash = *stash_p;
+
+	if (stash) {
+		bvhcache_free(&stash->cache);
+		MEM_freeN(stash);
+		*stash_p = NULL;
+	}
+}
+
 /** \} */
@@ -41,12 +41,14 @@
 #include "DNA_ID.h"
 
 #include "BLI_utildefines.h"
+#include "BLI_ghash.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
 #include "BLI_string_utils.h"
 #include "BLI_math.h"
 #include "BLI_math_color_blend.h"
 #include "BLI_mempool.h"
+#include "BLI_threads.h"
 
 #include "BLT_translation.h"
 
@@ -60,6 +62,8 @@
 
 #include "bmesh.h"
 
+#include "atomic_ops.h"
+
 /* only for customdata_data_transfer_interp_normal_normals */
 #include "data_transfer_intern.h"
 
@@ -1428,6 +1432,152 @@ static bool customdata_typemap_is_valid(const CustomData *data)
 }
 #endif
 
+/* -------------------------------------------------------------------- */
+/** \name Shared Layer Data
+ *
+ * Layers added with #CD_SHARE reuse the data array of the source layer instead
+ * of copying it, the array gets a user count in a global registry.
+ * This lets copy-on-write meshes of the dependency graph use the arrays of
+ * linked meshes until something actually writes to them (see #BKE_mesh_copy_data).
+ *
+ * - Sharing layers have #CD_FLAG_NOFREE | #CD_FLAG_SHARED, so they are handled like
+ *   referenced layers and duplicated before writing
+ *   (see #CustomData_duplicate_referenced_layer).
+ * - When the owning layer frees or reallocates a shared array, the array is
+ *   orphaned instead, and freed once the last sharing layer releases it.
+ *
+ * Writes done directly on the owning layer would be seen by the sharing layers,
+ * so only arrays which stay read-only for the lifetime of the sharing layers
+ * may be shared.
+ *
+ * Owners can't tell if their arrays are shared, so every free does a lookup.
+ * It's skipped while nothing is shared.
+ * \{ */
+
+typedef struct CustomDataSharedData {
+	int users;
+	int type;
+	int totelem;
+	bool orphan;
+} CustomDataSharedData;
+
+/* Maps layer data arrays to their CustomDataSharedData, NULL when nothing is shared.
+ * Only accessed with the lock held. */
+static GHash *cd_shared_data = NULL;
+static ThreadMutex cd_shared_data_lock = BLI_MUTEX_INITIALIZER;
+
+static void customData_shared_data_free_array(int type, void *data, int totelem)
+{
+	const LayerTypeInfo *typeInfo = layerType_getInfo(type);
+
+	if (typeInfo->free)
+		typeInfo->free(data, totelem, typeInfo->size);
+
+	MEM_freeN(data);
+}
+
+/* Register a new user of the array of the layer, which must be owned by the source layer
+ * or already shared. */
+static void customData_shared_data_add_user(CustomDataLayer *layer, int totelem)
+{
+	CustomDataSharedData *shared;
+	void **val_p;
+
+	BLI_mutex_lock(&cd_shared_data_lock);
+	if (cd_shared_data == NULL) {
+		cd_shared_data = BLI_ghash_ptr_new(__func__);
+	}
+	if (!BLI_ghash_ensure_p(cd_shared_data, layer->data, &val_p)) {
+		shared = MEM_mallocN(sizeof(*shared), __func__);
+		shared->users = 0;
+		shared->type = layer->type;
+		shared->totelem = totelem;
+		shared->orphan = false;
+		*val_p = shared;
+	}
+	shared = *val_p;
+	shared->users++;
+	BLI_mutex_unlock(&cd_shared_data_lock);
+
+	layer->flag |= CD_FLAG_NOFREE | CD_FLAG_SHARED;
+}
+
+/* Must be called with the lock held. */
+static void customData_shared_data_remove(void *data)
+{
+	BLI_ghash_remove(cd_shared_data, data, NULL, MEM_freeN);
+	if (BLI_ghash_len(cd_shared_data) == 0) {
+		BLI_ghash_free(cd_shared_data, NULL, NULL);
+		cd_shared_data = NULL;
+	}
+}
+
+/* Drop the user of a layer with #CD_FLAG_SHARED, freeing the array when it was orphaned
+ * by its owner and this was the last user. */
+static void customData_shared_data_release(CustomDataLayer *layer)
+{
+	CustomDataSharedData *shared = NULL;
+	bool do_free = false;
+	int type = 0, totelem = 0;
+
+	BLI_assert(layer->flag & CD_FLAG_SHARED);
+
+	BLI_mutex_lock(&cd_shared_data_lock);
+	if (cd_shared_data) {
+		shared = BLI_ghash_lookup(cd_shared_data, layer->data);
+	}
+	BLI_assert(shared != NULL);
+	if (shared && --shared->users == 0) {
+		do_free = shared->orphan;
+		type = shared->type;
+		totelem = shared->totelem;
+		customData_shared_data_remove(layer->data);
+	}
+	BLI_mutex_unlock(&cd_shared_data_lock);
+
+	if (do_free) {
+		customData_shared_data_free_array(type, layer->data, totelem);
+	}
+
+	layer->flag &= ~(CD_FLAG_NOFREE | CD_FLAG_SHARED);
+}
+
+/* Called by the owner of an array before freeing or reallocating it.
+ * Returns true when the array is still in use by sharing layers, in which case
+ * it is orphaned and must not be touched by the owner anymore. */
+static bool customData_shared_data_orphan(void *data, int *r_totelem)
+{
+	CustomDataSharedData *shared = NULL;
+
+	/* Only shared while copy-on-write copies exist, avoid locking otherwise. */
+	if (atomic_load_ptr((void *const *)&cd_shared_data) == NULL) {
+		return false;
+	}
+
+	BLI_mutex_lock(&cd_shared_data_lock);
+	if (cd_shared_data) {
+		shared = BLI_ghash_lookup(cd_shared_data, data);
+	}
+	if (shared) {
+		shared->orphan = true;
+		if (r_totelem) {
+			*r_totelem = shared->totelem;
+		}
+	}
+	BLI_mutex_unlock(&cd_shared_data_lock);
+
+	return (shared != NULL);
+}
+
+void CustomData_free_layer_data(int type, void *data, int totelem)
+{
+	if (data && !customData_shared_data_orphan(data, NULL)) {
+		customData_shared_data_free_array(type, data, totelem);
+	}
+}
+
+/** \} */
+
 bool CustomData_merge(
         const struct CustomData *source, struct CustomData *dest,
         CustomDataMask mask, eCDAllocType alloctype, int totelem)
@@ -1467,6 +1617,7 @@ bool CustomData_merge(
 			case CD_ASSIGN:
 			case CD_REFERENCE:
 			case CD_DUPLICATE:
+			case CD_SHARE:
 				data = layer->data;
 				break;
 			default:
@@ -1474,9 +1625,17 @@ bool CustomData_merge(
 				break;
 		}
 
-		if ((alloctype == CD_ASSIGN) && (flag & CD_FLAG_NOFREE)) {
+		if (ELEM(alloctype, CD_ASSIGN, CD_SHARE) && (flag & CD_FLAG_SHARED)) {
+			/* Keep a user of its own, the source layer releases its user when freed. */
+			newlayer = customData_add_layer__internal(dest, type, CD_SHARE, data, totelem, layer->name);
+		}
+		else if ((alloctype == CD_ASSIGN) && (flag & CD_FLAG_NOFREE)) {
 			newlayer = customData_add_layer__internal(dest, type, CD_REFERENCE, data, totelem, layer->name);
 		}
+		else if ((alloctype == CD_SHARE) && (flag & CD_FLAG_NOFREE)) {
+			/* The source does not own this array, its lifetime is unknown. */
+			newlayer = customData_add_layer__internal(dest, type, CD_DUPLICATE, data, totelem, layer->name);
+		}
 		else {
 			newlayer = customData_add_layer__internal(dest, type, alloctype, data, totelem, layer->name);
 		}
@@ -1500,7 +1659,7 @@ bool CustomData_merge(
 /* NOTE: Take care of referenced layers by yourself! */
 void CustomData_realloc(CustomData *data, int totelem)
 {
-	int i;
+	int i, totelem_old;
 	for (i = 0; i < data->totlayer; ++i) {
 		CustomDataLayer *layer = &data->layers[i];
 		const LayerTypeInfo *typeInfo;
@@ -1508,7 +1667,19 @@ void CustomData_realloc(CustomData *data, int totelem)
 			continue;
 		}
 		typeInfo = layerType_getInfo(layer->type);
-		layer->data = MEM_reallocN(layer->data, (size_t)totelem * typeInfo->size);
+		if (layer->data && customData_shared_data_orphan(layer->data, &totelem_old)) {
+			/* The old array stays with the layers sharing it, move to a copy of our own. */
+			void *layerdata = MEM_malloc_arrayN((size_t)totelem, typeInfo->size, layerType_getName(layer->type));
+			const int totelem_copy = min_ii(totelem, totelem_old);
+			if (typeInfo->copy)
+				typeInfo->copy(layer->data, layerdata, totelem_copy);
+			else
+				memcpy(layerdata, layer->data, (size_t)totelem_copy * typeInfo->size);
+			layer->data = layerdata;
+		}
+		else {
+			layer->data = MEM_reallocN(layer->data, (size_t)totelem * typeInfo->size);
+		}
 	}
 }
 
@@ -1526,16 +1697,11 @@ void CustomData_copy(
 
 static void customData_free_layer__internal(CustomDataLayer *layer, int totelem)
 {
-	const LayerTypeInfo *typeInfo;
-
-	if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
-		typeInfo = layerType_getInfo(layer->type);
-
-		if (typeInfo->free)
-			typeInfo->free(layer->data, totelem, typeInfo->size);
-
-		if (layer->data)
-			MEM_freeN(layer->data);
+	if (layer->flag & CD_FLAG_SHARED) {
+		customData_shared_data_release(layer);
+	}
+	else if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
+		CustomData_free_layer_data(layer->type, layer->data, totelem);
 	}
 }
 
@@ -1826,12 +1992,13 @@ static CustomDataLayer *customData_add_layer__internal(
 	BLI_assert(!layerdata ||
 	           (alloctype == CD_ASSIGN) ||
 	           (alloctype == CD_DUPLICATE) ||
-	           (alloctype == CD_REFERENCE));
+	           (alloctype == CD_REFERENCE) ||
+	           (alloctype == CD_SHARE));
 
 	if (!typeInfo->defaultname && CustomData_has_layer(data, type))
 		return &data->layers[CustomData_get_layer_index(data, type)];
 
-	if ((alloctype == CD_ASSIGN) || (alloctype == CD_REFERENCE)) {
+	if (ELEM(alloctype, CD_ASSIGN, CD_REFERENCE, CD_SHARE)) {
 		newlayerdata = layerdata;
 	}
 	else if (totelem > 0 && typeInfo->size > 0) {
@@ -1877,6 +2044,10 @@ static CustomDataLayer *customData_add_layer__internal(
 	data->layers[index].flag = flag;
 	data->layers[index].data = newlayerdata;
 
+	if (alloctype == CD_SHARE && newlayerdata) {
+		customData_shared_data_add_user(&data->layers[index], totelem);
+	}
+
 	if (name || (name = DATA_(typeInfo->defaultname))) {
 		BLI_strncpy(data->layers[index].name, name, sizeof(data->layers[index].name));
 		CustomData_set_layer_unique_name(data, index);
@@ -2041,16 +2212,21 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data, const
 		 * So in case a custom copy function is defined, use it!
 		 */
 		const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+		void *dst_data;
 
 		if (typeInfo->copy) {
-			void *dst_data = MEM_malloc_arrayN((size_t)totelem, typeInfo->size, "CD duplicate ref layer");
+			dst_data = MEM_malloc_arrayN((size_t)totelem, typeInfo->size, "CD duplicate ref layer");
 			typeInfo->copy(layer->data, dst_data, totelem);
-			layer->data = dst_data;
 		}
 		else {
-			layer->data = MEM_dupallocN(layer->data);
+			dst_data = MEM_dupallocN(layer->data);
+		}
+
+		if (layer->flag & CD_FLAG_SHARED) {
+			customData_shared_data_release(layer);
 		}
 
+		layer->data = dst_data;
 		layer->flag &= ~CD_FLAG_NOFREE;
 	}
 
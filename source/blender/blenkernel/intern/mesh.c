@@ -43,6 +43,7 @@
 #include "BLI_string.h"
 
 #include "BKE_animsys.h"
+#include "BKE_bvhutils.h"
 #include "BKE_idcode.h"
 #include "BKE_main.h"
 #include "BKE_global.h"
@@ -528,6 +529,17 @@ Mesh *BKE_mesh_add(Main *bmain, const char *name)
 	return me;
 }
 
+/* Layers shared by copies made with #LIB_ID_COPY_CD_SHARE, evaluation never writes to them in place. */
+#define CD_MASK_MESH_SHARE \
+	(CD_MASK_MEDGE | CD_MASK_MPOLY | CD_MASK_MLOOP | CD_MASK_MLOOPUV | CD_MASK_MLOOPCOL | CD_MASK_MDEFORMVERT)
+
+static void mesh_customdata_copy_shared(
+        const CustomData *source, CustomData *dest, CustomDataMask mask, int totelem)
+{
+	CustomData_copy(source, dest, mask & CD_MASK_MESH_SHARE, CD_SHARE, totelem);
+	CustomData_merge(source, dest, mask & ~CD_MASK_MESH_SHARE, CD_DUPLICATE, totelem);
+}
+
 /**
  * Only copy internal data of Mesh ID from source to already allocated/initialized destination.
  * You probably nerver want to use that directly, use id_copy or BKE_id_copy_ex for typical needs.
@@ -549,10 +561,20 @@ void BKE_mesh_copy_data(Main *bmain, Mesh *me_dst, const Mesh *me_src, const int
 	me_dst->mat = MEM_dupallocN(me_src->mat);
 
 	const eCDAllocType alloc_type = (flag & LIB_ID_COPY_CD_REFERENCE) ? CD_REFERENCE : CD_DUPLICATE;
-	CustomData_copy(&me_src->vdata, &me_dst->vdata, mask, alloc_type, me_dst->totvert);
-	CustomData_copy(&me_src->edata, &me_dst->edata, mask, alloc_type, me_dst->totedge);
-	CustomData_copy(&me_src->ldata, &me_dst->ldata, mask, alloc_type, me_dst->totloop);
-	CustomData_copy(&me_src->pdata, &me_dst->pdata, mask, alloc_type, me_dst->totpoly);
+	if ((alloc_type == CD_DUPLICATE) && (flag & LIB_ID_COPY_CD_SHARE) && ID_IS_LINKED(me_src)) {
+		/* Only share the layers of linked meshes, which can't be edited while the copy exists,
+		 * and leave out vertices, evaluation writes normals to them in place. */
+		mesh_customdata_copy_shared(&me_src->vdata, &me_dst->vdata, mask, me_dst->totvert);
+		mesh_customdata_copy_shared(&me_src->edata, &me_dst->edata, mask, me_dst->totedge);
+		mesh_customdata_copy_shared(&me_src->ldata, &me_dst->ldata, mask, me_dst->totloop);
+		mesh_customdata_copy_shared(&me_src->pdata, &me_dst->pdata, mask, me_dst->totpoly);
+	}
+	else {
+		CustomData_copy(&me_src->vdata, &me_dst->vdata, mask, alloc_type, me_dst->totvert);
+		CustomData_copy(&me_src->edata, &me_dst->edata, mask, alloc_type, me_dst->totedge);
+		CustomData_copy(&me_src->ldata, &me_dst->ldata, mask, alloc_type, me_dst->totloop);
+		CustomData_copy(&me_src->pdata, &me_dst->pdata, mask, alloc_type, me_dst->totpoly);
+	}
 	if (do_tessface) {
 		CustomData_copy(&me_src->fdata, &me_dst->fdata, mask, alloc_type, me_dst->totface);
 	}
@@ -1527,6 +1549,11 @@ void BKE_mesh_apply_vert_coords(Mesh *mesh, float (*vertCoords)[3])
 		copy_v3_v3(vert->co, vertCoords[i]);
 
 	mesh->runtime.cd_dirty_vert |= CD_MASK_NORMAL;
+
+	/* The topology is unchanged, cached BVH trees can be refit. */
+	if (mesh->runtime.bvh_cache) {
+		bvhcache_refit_from_mesh(&mesh->runtime.bvh_cache, mesh);
+	}
 }
 
 void BKE_mesh_apply_vert_normals(Mesh *mesh, short (*vertNormals)[3])
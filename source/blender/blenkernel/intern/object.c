@@ -77,6 +77,7 @@
 #include "BKE_global.h"
 #include "BKE_idprop.h"
 #include "BKE_armature.h"
+#include "BKE_bvhutils.h"
 #include "BKE_action.h"
 #include "BKE_deform.h"
 #include "BKE_DerivedMesh.h"
@@ -378,6 +379,8 @@ void BKE_object_free_derived_caches(Object *ob)
 		}
 		/* Evaluated mesh points to edit mesh, but does not own it. */
 		mesh_eval->edit_btmesh = NULL;
+		/* Keep its BVH trees, the next evaluation refits them when the topology is unchanged. */
+		bvhcache_stash_from_mesh(&ob->runtime.bvh_cache_stash, mesh_eval);
 		BKE_mesh_free(mesh_eval);
 		BKE_libblock_free_data(&mesh_eval->id, false);
 		MEM_freeN(mesh_eval);
@@ -509,6 +512,7 @@ void BKE_object_free(Object *ob)
 		MEM_freeN(ob->runtime.curve_cache);
 		ob->runtime.curve_cache = NULL;
 	}
+	bvhcache_stash_free(&ob->runtime.bvh_cache_stash);
 
 	BKE_previewimg_free(&ob->preview);
 }
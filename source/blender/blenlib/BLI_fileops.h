@@ -122,6 +122,7 @@ int    BLI_file_gzip(const char *from, const char *to) ATTR_WARN_UNUSED_RESULT A
 char  *BLI_file_ungzip_to_mem(const char *from_file, int *r_size) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
 
 size_t BLI_file_descriptor_size(int file) ATTR_WARN_UNUSED_RESULT;
+bool   BLI_file_descriptor_is_local(int file) ATTR_WARN_UNUSED_RESULT;
 size_t BLI_file_size(const char *file) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
 
 /* compare if one was last modified before the other */
@@ -49,6 +49,8 @@ BLI_mempool *BLI_mempool_create(unsigned int esize, unsigned int totelem,
 void        *BLI_mempool_alloc(BLI_mempool *pool) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
 void        *BLI_mempool_calloc(BLI_mempool *pool) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
 void         BLI_mempool_free(BLI_mempool *pool, void *addr) ATTR_NONNULL(1, 2);
+void         BLI_mempool_alloc_n(BLI_mempool *pool, void **r_elems, unsigned int elems_len) ATTR_NONNULL(1, 2);
+void         BLI_mempool_free_n(BLI_mempool *pool, void **elems, unsigned int elems_len) ATTR_NONNULL(1, 2);
 void         BLI_mempool_clear_ex(BLI_mempool *pool,
                                   const int totelem_reserve) ATTR_NONNULL(1);
 void         BLI_mempool_clear(BLI_mempool *pool) ATTR_NONNULL(1);
@@ -84,8 +86,28 @@ enum {
 	 * \note order of iteration is only assured to be the order of allocation when no chunks have been freed.
 	 */
 	BLI_MEMPOOL_ALLOW_ITER = (1 << 0),
+	/** allow allocating and freeing from multiple threads (directly or using #BLI_mempool_local).
+	 *
+	 * \note other functions (clear, iteration... etc) must not run at the same time.
+	 * \note unused chunks are only freed by #BLI_mempool_clear.
+	 */
+	BLI_MEMPOOL_THREADSAFE = (1 << 1),
 };
 
+/** thread local allocation (#BLI_MEMPOOL_THREADSAFE only) **/
+/* private structure */
+typedef struct BLI_mempool_local {
+	BLI_mempool *pool;
+	void *free;
+	unsigned int free_len;
+} BLI_mempool_local;
+
+void  BLI_mempool_local_init(BLI_mempool *pool, BLI_mempool_local *local) ATTR_NONNULL();
+void *BLI_mempool_local_alloc(BLI_mempool_local *local) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
+void *BLI_mempool_local_calloc(BLI_mempool_local *local) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
+void  BLI_mempool_local_free(BLI_mempool_local *local, void *addr) ATTR_NONNULL();
+void  BLI_mempool_local_flush(BLI_mempool_local *local) ATTR_NONNULL();
+
 void  BLI_mempool_iternew(BLI_mempool *pool, BLI_mempool_iter *iter) ATTR_NONNULL();
 void *BLI_mempool_iterstep(BLI_mempool_iter *iter) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
 
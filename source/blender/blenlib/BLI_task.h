@@ -113,6 +113,9 @@ ThreadMutex *BLI_task_pool_user_mutex(TaskPool *pool);
 /* Delayed push, use that to reduce thread overhead by accumulating
  * all new tasks into local queue first and pushing it to scheduler
  * from within a single mutex lock.
+ *
+ * High priority tasks are added to the front of the queue in push order
+ * (so the last one pushed is picked up first), low priority ones to the back.
  */
 void BLI_task_pool_delayed_push_begin(TaskPool *pool, int thread_id);
 void BLI_task_pool_delayed_push_end(TaskPool *pool, int thread_id);
@@ -797,6 +797,17 @@ static void split_leafs(BVHNode **leafs_array, const int nth[], const int partit
 	}
 }
 
+/**
+ * Half the surface area of the X/Y/Z bounds of \a bv, (callers must check the tree has these axes).
+ */
+static float bv_half_area(const float bv[6])
+{
+	const float dx = bv[1] - bv[0];
+	const float dy = bv[3] - bv[2];
+	const float dz = bv[5] - bv[4];
+	return dx * dy + dy * dz + dz * dx;
+}
+
 typedef struct BVHDivNodesData {
 	const BVHTree *tree;
 	BVHNode *branches_array;
@@ -1143,18 +1154,99 @@ bool BLI_bvhtree_update_node(BVHTree *tree, int index, const float co[3], const
 	return true;
 }
 
-/* call BLI_bvhtree_update_node() first for every node/point/triangle */
+typedef struct BVHUpdateTreeData {
+	BVHTree *tree;
+	BVHNode *branches_array;
+} BVHUpdateTreeData;
+
+static void bvhtree_update_tree_task_cb(
+        void *__restrict userdata,
+        const int j,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	BVHUpdateTreeData *data = userdata;
+	node_join(data->tree, &data->branches_array[j]);
+}
+
+/**
+ * Call #BLI_bvhtree_update_node() first for every node/point/triangle.
+ *
+ * \note #BLI_bvhtree_update_node may be called from multiple threads (for different indices).
+ */
 void BLI_bvhtree_update_tree(BVHTree *tree)
 {
-	/* Update bottom=>top
-	 * TRICKY: the way we build the tree all the childs have an index greater than the parent
-	 * This allows us todo a bottom up update by starting on the bigger numbered branch */
+	if (tree->totleaf <= KDOPBVH_THREAD_LEAF_THRESHOLD || tree->totbranch == 0) {
+		/* Update bottom=>top
+		 * TRICKY: the way we build the tree all the childs have an index greater than the parent
+		 * This allows us todo a bottom up update by starting on the bigger numbered branch */
+
+		BVHNode **root  = tree->nodes + tree->totleaf;
+		BVHNode **index = tree->nodes + tree->totleaf + tree->totbranch - 1;
+
+		for (; index >= root; index--)
+			node_join(tree, *index);
+	}
+	else {
+		/* Join the branches of each level of the implicit tree in parallel (deepest level first),
+		 * see #non_recursive_bvh_div_nodes for the layout. */
+		const int tree_type   = tree->tree_type;
+		const int tree_offset = 2 - tree->tree_type;
+		const int num_branches = tree->totbranch;
+		int level_first[32 + 1];
+		int levels_len = 0;
+		int i;
+
+		for (i = 1; i <= num_branches; i = i * tree_type + tree_offset) {
+			BLI_assert(levels_len < 32);
+			level_first[levels_len++] = i;
+		}
+		level_first[levels_len] = num_branches + 1;
+
+		BVHUpdateTreeData data = {
+			.tree = tree, .branches_array = tree->nodearray + (tree->totleaf - 1),
+		};
+
+		ParallelRangeSettings settings;
+		BLI_parallel_range_settings_defaults(&settings);
+
+		while (levels_len--) {
+			const int i_start = level_first[levels_len];
+			const int i_stop = min_ii(level_first[levels_len + 1], num_branches + 1);
+			settings.use_threading = (i_stop - i_start) > KDOPBVH_THREAD_LEAF_THRESHOLD / tree_type;
+			BLI_task_parallel_range(i_start, i_stop, &data, bvhtree_update_tree_task_cb, &settings);
+		}
+	}
+}
+
+/**
+ * The surface area of all branches relative to the surface area of the root,
+ * this is the surface area heuristic cost of traversing the tree (ignoring leafs).
+ *
+ * Refitting (#BLI_bvhtree_update_tree) after large deformations increases this,
+ * comparing it with the value after #BLI_bvhtree_balance can be used to decide to rebuild.
+ *
+ * \return Zero for trees without the X/Y/Z axes or empty trees.
+ */
+float BLI_bvhtree_calc_branch_area_ratio(const BVHTree *tree)
+{
+	const BVHNode *root;
+	float area_root, area_sum = 0.0f;
+
+	if (tree->start_axis != 0 || tree->totbranch == 0) {
+		return 0.0f;
+	}
+
+	root = tree->nodes[tree->totleaf];
+	area_root = bv_half_area(root->bv);
+	if (!(area_root > 0.0f)) {
+		return 0.0f;
+	}
 
-	BVHNode **root  = tree->nodes + tree->totleaf;
-	BVHNode **index = tree->nodes + tree->totleaf + tree->totbranch - 1;
+	for (int i = 0; i < tree->totbranch; i++) {
+		area_sum += bv_half_area(tree->nodes[tree->totleaf + i]->bv);
+	}
 
-	for (; index >= root; index--)
-		node_join(tree, *index);
+	return area_sum / area_root;
 }
 /**
  * Number of times #BLI_bvhtree_insert has been called.
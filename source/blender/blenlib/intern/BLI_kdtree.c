@@ -29,6 +29,7 @@
 
 #include "BLI_math.h"
 #include "BLI_kdtree.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "BLI_strict_flags.h"
 
@@ -61,6 +62,11 @@ struct KDTree {
 
 #define KD_NODE_UNSET ((uint)-1)
 
+/* Balance subtrees of at least this many nodes in parallel. */
+#define KD_THREAD_BALANCE_THRESHOLD 10000
+/* Levels partitioned before balancing the subtrees below them in parallel (up to 2^N tasks). */
+#define KD_THREAD_BALANCE_DEPTH 6
+
 /**
  * Creates or free a kdtree
  */
@@ -113,18 +119,17 @@ void BLI_kdtree_insert(KDTree *tree, int index, const float co[3])
 #endif
 }
 
-static uint kdtree_balance(KDTreeNode *nodes, uint totnode, uint axis, const uint ofs)
+/**
+ * Quicksort style sorting around the median, so nodes before it are smaller along \a axis
+ * and nodes after it are larger.
+ *
+ * \return The median.
+ */
+static uint kdtree_balance_partition(KDTreeNode *nodes, uint totnode, uint axis)
 {
-	KDTreeNode *node;
 	float co;
 	uint left, right, median, i, j;
 
-	if (totnode <= 0)
-		return KD_NODE_UNSET;
-	else if (totnode == 1)
-		return 0 + ofs;
-
-	/* quicksort style sorting around median */
 	left = 0;
 	right = totnode - 1;
 	median = totnode / 2;
@@ -151,6 +156,21 @@ static uint kdtree_balance(KDTreeNode *nodes, uint totnode, uint axis, const uin
 			left = i + 1;
 	}
 
+	return median;
+}
+
+static uint kdtree_balance(KDTreeNode *nodes, uint totnode, uint axis, const uint ofs)
+{
+	KDTreeNode *node;
+	uint median;
+
+	if (totnode <= 0)
+		return KD_NODE_UNSET;
+	else if (totnode == 1)
+		return 0 + ofs;
+
+	median = kdtree_balance_partition(nodes, totnode, axis);
+
 	/* set node and sort subnodes */
 	node = &nodes[median];
 	node->d = axis;
@@ -161,9 +181,98 @@ static uint kdtree_balance(KDTreeNode *nodes, uint totnode, uint axis, const uin
 	return median + ofs;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Parallel Balance
+ *
+ * The subtrees on either side of a median don't share any nodes,
+ * and the root of a subtree is always at its median (known before balancing it).
+ * So the first levels are partitioned on a single thread, then the subtrees below them
+ * are balanced in parallel, giving the same tree as #kdtree_balance.
+ * \{ */
+
+typedef struct KDTreeBalanceTask {
+	uint totnode;
+	uint axis;
+	uint ofs;
+} KDTreeBalanceTask;
+
+typedef struct KDTreeBalanceData {
+	KDTreeNode *nodes;
+	KDTreeBalanceTask tasks[1 << KD_THREAD_BALANCE_DEPTH];
+	int tasks_len;
+} KDTreeBalanceData;
+
+static uint kdtree_balance_deferred(
+        KDTreeBalanceData *data, uint totnode, uint axis, const uint ofs, const uint depth)
+{
+	KDTreeNode *nodes = data->nodes + ofs;
+	KDTreeNode *node;
+	uint median;
+
+	if (totnode <= 1) {
+		return kdtree_balance(nodes, totnode, axis, ofs);
+	}
+	else if (depth == 0 || totnode < KD_THREAD_BALANCE_THRESHOLD) {
+		KDTreeBalanceTask *task = &data->tasks[data->tasks_len++];
+		task->totnode = totnode;
+		task->axis = axis;
+		task->ofs = ofs;
+		/* Matches the median chosen by #kdtree_balance_partition. */
+		return (totnode / 2) + ofs;
+	}
+
+	median = kdtree_balance_partition(nodes, totnode, axis);
+
+	node = &nodes[median];
+	node->d = axis;
+	axis = (axis + 1) % 3;
+	node->left = kdtree_balance_deferred(data, median, axis, ofs, depth - 1);
+	node->right = kdtree_balance_deferred(data, (totnode - (median + 1)), axis, (median + 1) + ofs, depth - 1);
+
+	return median + ofs;
+}
+
+static void kdtree_balance_task_cb(
+        void *__restrict userdata,
+        const int i,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	KDTreeBalanceData *data = userdata;
+	const KDTreeBalanceTask *task = &data->tasks[i];
+	const uint root = kdtree_balance(data->nodes + task->ofs, task->totnode, task->axis, task->ofs);
+	BLI_assert(root == (task->totnode / 2) + task->ofs);
+	UNUSED_VARS_NDEBUG(root);
+}
+
+static uint kdtree_balance_parallel(KDTreeNode *nodes, uint totnode)
+{
+	KDTreeBalanceData *data = MEM_mallocN(sizeof(*data), __func__);
+	uint root;
+
+	data->nodes = nodes;
+	data->tasks_len = 0;
+
+	root = kdtree_balance_deferred(data, totnode, 0, 0, KD_THREAD_BALANCE_DEPTH);
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+	BLI_task_parallel_range(0, data->tasks_len, data, kdtree_balance_task_cb, &settings);
+
+	MEM_freeN(data);
+	return root;
+}
+
+/** \} */
+
 void BLI_kdtree_balance(KDTree *tree)
 {
-	tree->root = kdtree_balance(tree->nodes, tree->totnode, 0, 0);
+	if (tree->totnode >= KD_THREAD_BALANCE_THRESHOLD * 2) {
+		tree->root = kdtree_balance_parallel(tree->nodes, tree->totnode);
+	}
+	else {
+		tree->root = kdtree_balance(tree->nodes, tree->totnode, 0, 0);
+	}
 
 #ifdef DEBUG
 	tree->is_balanced = true;
@@ -804,3 +913,4 @@ int BLI_kdtree_calc_duplicates_fast(
 }
 
 /** \} */
+
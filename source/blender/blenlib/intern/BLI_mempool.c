@@ -36,6 +36,8 @@
  * - Freeing chunks.
  * - Iterating over allocated chunks
  *   (optionally when using the #BLI_MEMPOOL_ALLOW_ITER flag).
+ * - Allocating from multiple threads
+ *   (optionally when using the #BLI_MEMPOOL_THREADSAFE flag, see #BLI_mempool_local).
  */
 
 #include <string.h>
@@ -138,6 +140,10 @@ struct BLI_mempool {
 	BLI_freenode *free;         /* free element list. Interleaved into chunk datas. */
 	uint maxchunks;     /* use to know how many chunks to keep for BLI_mempool_clear */
 	uint totused;       /* number of elements currently in use */
+	/* Only for #BLI_MEMPOOL_THREADSAFE, spin lock protecting 'free'
+	 * ('totused' & 'chunk_tail' are updated atomically).
+	 * Not a #SpinLock since the mempool is also used by makesdna which doesn't link threading. */
+	uint32_t free_lock;
 #ifdef USE_TOTALLOC
 	uint totalloc;          /* number of elements allocated in total */
 #endif
@@ -207,6 +213,40 @@ static BLI_mempool_chunk *mempool_chunk_alloc(BLI_mempool *pool)
 	return mpchunk;
 }
 
+/**
+ * Link all elements of \a mpchunk into a list of free nodes (starting at #CHUNK_DATA).
+ *
+ * \return The last node of the list.
+ */
+static BLI_freenode *mempool_chunk_init_free(const BLI_mempool *pool, BLI_mempool_chunk *mpchunk)
+{
+	const uint esize = pool->esize;
+	BLI_freenode *curnode = CHUNK_DATA(mpchunk);
+	uint j;
+
+	/* loop through the allocated data, building the pointer structures */
+	j = pool->pchunk;
+	if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+		while (j--) {
+			curnode->next = NODE_STEP_NEXT(curnode);
+			curnode->freeword = FREEWORD;
+			curnode = curnode->next;
+		}
+	}
+	else {
+		while (j--) {
+			curnode->next = NODE_STEP_NEXT(curnode);
+			curnode = curnode->next;
+		}
+	}
+
+	/* terminate the list (rewind one) */
+	curnode = NODE_STEP_PREV(curnode);
+	curnode->next = NULL;
+
+	return curnode;
+}
+
 /**
  * Initialize a chunk and add into \a pool->chunks
  *
@@ -219,9 +259,7 @@ static BLI_mempool_chunk *mempool_chunk_alloc(BLI_mempool *pool)
 static BLI_freenode *mempool_chunk_add(BLI_mempool *pool, BLI_mempool_chunk *mpchunk,
                                        BLI_freenode *lasttail)
 {
-	const uint esize = pool->esize;
 	BLI_freenode *curnode = CHUNK_DATA(mpchunk);
-	uint j;
 
 	/* append */
 	if (pool->chunk_tail) {
@@ -239,26 +277,8 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool, BLI_mempool_chunk *mpc
 		pool->free = curnode;
 	}
 
-	/* loop through the allocated data, building the pointer structures */
-	j = pool->pchunk;
-	if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
-		while (j--) {
-			curnode->next = NODE_STEP_NEXT(curnode);
-			curnode->freeword = FREEWORD;
-			curnode = curnode->next;
-		}
-	}
-	else {
-		while (j--) {
-			curnode->next = NODE_STEP_NEXT(curnode);
-			curnode = curnode->next;
-		}
-	}
-
-	/* terminate the list (rewind one)
-	 * will be overwritten if 'curnode' gets passed in again as 'lasttail' */
-	curnode = NODE_STEP_PREV(curnode);
-	curnode->next = NULL;
+	/* will be overwritten if 'curnode' gets passed in again as 'lasttail' */
+	curnode = mempool_chunk_init_free(pool, mpchunk);
 
 #ifdef USE_TOTALLOC
 	pool->totalloc += pool->pchunk;
@@ -272,6 +292,93 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool, BLI_mempool_chunk *mpc
 	return curnode;
 }
 
+/**
+ * Allocate a new chunk for a #BLI_MEMPOOL_THREADSAFE pool, without locking.
+ *
+ * The chunk is appended to \a pool->chunks atomically, its elements are returned as a list
+ * of free nodes owned by the caller (counted as used, like elements taken by #BLI_mempool_local).
+ */
+static BLI_freenode *mempool_chunk_acquire_threadsafe(BLI_mempool *pool, BLI_freenode **r_tail)
+{
+	BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+	BLI_mempool_chunk *chunk_tail;
+
+	*r_tail = mempool_chunk_init_free(pool, mpchunk);
+	mpchunk->next = NULL;
+
+	do {
+		chunk_tail = pool->chunk_tail;
+	} while (atomic_cas_ptr((void **)&pool->chunk_tail, chunk_tail, mpchunk) != chunk_tail);
+
+	/* Only the thread which replaced the tail links it. */
+	if (chunk_tail) {
+		chunk_tail->next = mpchunk;
+	}
+	else {
+		pool->chunks = mpchunk;
+	}
+
+	atomic_add_and_fetch_u(&pool->totused, pool->pchunk);
+
+	return CHUNK_DATA(mpchunk);
+}
+
+BLI_INLINE void mempool_free_lock(BLI_mempool *pool)
+{
+	while (atomic_cas_uint32(&pool->free_lock, 0, 1) != 0) {
+		/* Wait until released before trying to take the lock again. */
+		while (*(volatile uint32_t *)&pool->free_lock) {
+			/* pass */
+		}
+	}
+}
+
+BLI_INLINE void mempool_free_unlock(BLI_mempool *pool)
+{
+	atomic_cas_uint32(&pool->free_lock, 1, 0);
+}
+
+/**
+ * Take up to \a len free nodes from a #BLI_MEMPOOL_THREADSAFE pool (counted as used).
+ *
+ * \return The list of free nodes, NULL when the pool has no free nodes.
+ */
+static BLI_freenode *mempool_free_take_threadsafe(BLI_mempool *pool, uint len, uint *r_len)
+{
+	BLI_freenode *head, *tail;
+	uint i = 0;
+
+	mempool_free_lock(pool);
+	head = tail = pool->free;
+	if (head) {
+		for (i = 1; i < len && tail->next; i++) {
+			tail = tail->next;
+		}
+		pool->free = tail->next;
+		tail->next = NULL;
+	}
+	mempool_free_unlock(pool);
+
+	if (i) {
+		atomic_add_and_fetch_u(&pool->totused, i);
+	}
+	*r_len = i;
+	return head;
+}
+
+/**
+ * Return a list of \a len free nodes to a #BLI_MEMPOOL_THREADSAFE pool.
+ */
+static void mempool_free_give_threadsafe(BLI_mempool *pool, BLI_freenode *head, BLI_freenode *tail, uint len)
+{
+	mempool_free_lock(pool);
+	tail->next = pool->free;
+	pool->free = head;
+	mempool_free_unlock(pool);
+
+	atomic_sub_and_fetch_u(&pool->totused, len);
+}
+
 static void mempool_chunk_free(BLI_mempool_chunk *mpchunk)
 {
 
@@ -336,6 +443,7 @@ BLI_mempool *BLI_mempool_create(uint esize, uint totelem,
 	pool->totalloc = 0;
 #endif
 	pool->totused = 0;
+	pool->free_lock = 0;
 
 	if (totelem) {
 		/* allocate the actual chunks */
@@ -352,10 +460,40 @@ BLI_mempool *BLI_mempool_create(uint esize, uint totelem,
 	return pool;
 }
 
+static void *mempool_alloc_threadsafe(BLI_mempool *pool)
+{
+	BLI_freenode *free_pop;
+	uint len;
+
+	free_pop = mempool_free_take_threadsafe(pool, 1, &len);
+	if (UNLIKELY(free_pop == NULL)) {
+		BLI_freenode *tail;
+		free_pop = mempool_chunk_acquire_threadsafe(pool, &tail);
+		/* Keep the first element, the rest is free. */
+		if (free_pop != tail) {
+			mempool_free_give_threadsafe(pool, free_pop->next, tail, pool->pchunk - 1);
+		}
+	}
+
+	if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+		free_pop->freeword = USEDWORD;
+	}
+
+#ifdef WITH_MEM_VALGRIND
+	VALGRIND_MEMPOOL_ALLOC(pool, free_pop, pool->esize);
+#endif
+
+	return (void *)free_pop;
+}
+
 void *BLI_mempool_alloc(BLI_mempool *pool)
 {
 	BLI_freenode *free_pop;
 
+	if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+		return mempool_alloc_threadsafe(pool);
+	}
+
 	if (UNLIKELY(pool->free == NULL)) {
 		/* need to allocate a new chunk */
 		BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
@@ -397,7 +535,9 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
 	BLI_freenode *newhead = addr;
 
 #ifndef NDEBUG
-	{
+	/* Chunks of thread-safe pools are appended without locking, another thread may have
+	 * replaced the tail but not linked its chunk yet, so the chunk list can't be checked. */
+	if ((pool->flag & BLI_MEMPOOL_THREADSAFE) == 0) {
 		BLI_mempool_chunk *chunk;
 		bool found = false;
 		for (chunk = pool->chunks; chunk; chunk = chunk->next) {
@@ -425,6 +565,15 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
 		newhead->freeword = FREEWORD;
 	}
 
+	if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+#ifdef WITH_MEM_VALGRIND
+		VALGRIND_MEMPOOL_FREE(pool, addr);
+#endif
+		/* Unused chunks are kept, other threads may be using free nodes from them. */
+		mempool_free_give_threadsafe(pool, newhead, newhead, 1);
+		return;
+	}
+
 	newhead->next = pool->free;
 	pool->free = newhead;
 
@@ -474,6 +623,50 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
 	}
 }
 
+/**
+ * Allocate \a elems_len elements at once.
+ *
+ * For #BLI_MEMPOOL_THREADSAFE pools this only locks once per chunk worth of elements.
+ */
+void BLI_mempool_alloc_n(BLI_mempool *pool, void **r_elems, uint elems_len)
+{
+	if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+		BLI_mempool_local local;
+		BLI_mempool_local_init(pool, &local);
+		for (uint i = 0; i < elems_len; i++) {
+			r_elems[i] = BLI_mempool_local_alloc(&local);
+		}
+		BLI_mempool_local_flush(&local);
+	}
+	else {
+		for (uint i = 0; i < elems_len; i++) {
+			r_elems[i] = BLI_mempool_alloc(pool);
+		}
+	}
+}
+
+/**
+ * Free \a elems_len elements at once.
+ *
+ * For #BLI_MEMPOOL_THREADSAFE pools this only locks once.
+ */
+void BLI_mempool_free_n(BLI_mempool *pool, void **elems, uint elems_len)
+{
+	if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+		BLI_mempool_local local;
+		BLI_mempool_local_init(pool, &local);
+		for (uint i = 0; i < elems_len; i++) {
+			BLI_mempool_local_free(&local, elems[i]);
+		}
+		BLI_mempool_local_flush(&local);
+	}
+	else {
+		for (uint i = 0; i < elems_len; i++) {
+			BLI_mempool_free(pool, elems[i]);
+		}
+	}
+}
+
 int BLI_mempool_len(BLI_mempool *pool)
 {
 	return (int)pool->totused;
@@ -554,6 +747,120 @@ void *BLI_mempool_as_arrayN(BLI_mempool *pool, const char *allocstr)
 	return data;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Thread Local Allocation
+ *
+ * A #BLI_mempool_local caches free elements of a #BLI_MEMPOOL_THREADSAFE pool,
+ * so a thread can allocate and free without touching the pool (or its lock) most of the time.
+ *
+ * Elements taken into the cache are counted as used by the pool until the cache is flushed.
+ * \{ */
+
+/**
+ * Initialize a cache, each thread must use its own.
+ */
+void BLI_mempool_local_init(BLI_mempool *pool, BLI_mempool_local *local)
+{
+	BLI_assert(pool->flag & BLI_MEMPOOL_THREADSAFE);
+
+	local->pool = pool;
+	local->free = NULL;
+	local->free_len = 0;
+}
+
+void *BLI_mempool_local_alloc(BLI_mempool_local *local)
+{
+	BLI_mempool *pool = local->pool;
+	BLI_freenode *free_pop = local->free;
+
+	if (UNLIKELY(free_pop == NULL)) {
+		/* Refill with as many elements as a chunk holds, from the pool or a new chunk. */
+		uint len;
+		free_pop = mempool_free_take_threadsafe(pool, pool->pchunk, &len);
+		if (free_pop == NULL) {
+			BLI_freenode *tail;
+			free_pop = mempool_chunk_acquire_threadsafe(pool, &tail);
+			len = pool->pchunk;
+		}
+		local->free_len = len;
+	}
+
+	local->free = free_pop->next;
+	local->free_len--;
+
+	if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+		free_pop->freeword = USEDWORD;
+	}
+
+#ifdef WITH_MEM_VALGRIND
+	VALGRIND_MEMPOOL_ALLOC(pool, free_pop, pool->esize);
+#endif
+
+	return (void *)free_pop;
+}
+
+void *BLI_mempool_local_calloc(BLI_mempool_local *local)
+{
+	void *retval = BLI_mempool_local_alloc(local);
+	memset(retval, 0, (size_t)local->pool->esize);
+	return retval;
+}
+
+/**
+ * Free an element into the cache, any element of the pool can be freed
+ * (not only those allocated from this cache).
+ */
+void BLI_mempool_local_free(BLI_mempool_local *local, void *addr)
+{
+	BLI_mempool *pool = local->pool;
+	BLI_freenode *newhead = addr;
+
+	if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+#ifndef NDEBUG
+		/* this will detect double free's */
+		BLI_assert(newhead->freeword != FREEWORD);
+#endif
+		newhead->freeword = FREEWORD;
+	}
+
+#ifdef WITH_MEM_VALGRIND
+	VALGRIND_MEMPOOL_FREE(pool, addr);
+#endif
+
+	newhead->next = local->free;
+	local->free = newhead;
+	local->free_len++;
+
+	/* Don't let a thread which mostly frees hold on to too much memory. */
+	if (UNLIKELY(local->free_len >= pool->pchunk * 2)) {
+		BLI_freenode *tail = newhead;
+		for (uint i = 1; i < pool->pchunk; i++) {
+			tail = tail->next;
+		}
+		local->free = tail->next;
+		local->free_len -= pool->pchunk;
+		mempool_free_give_threadsafe(pool, newhead, tail, pool->pchunk);
+	}
+}
+
+/**
+ * Return all cached elements to the pool, the cache may be used again afterwards.
+ */
+void BLI_mempool_local_flush(BLI_mempool_local *local)
+{
+	if (local->free) {
+		BLI_freenode *tail = local->free;
+		while (tail->next) {
+			tail = tail->next;
+		}
+		mempool_free_give_threadsafe(local->pool, local->free, tail, local->free_len);
+		local->free = NULL;
+		local->free_len = 0;
+	}
+}
+
+/** \} */
+
 /**
  * Initialize a new mempool iterator, \a BLI_MEMPOOL_ALLOW_ITER flag must be set.
  */
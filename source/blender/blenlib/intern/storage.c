@@ -173,6 +173,44 @@ size_t BLI_file_descriptor_size(int file)
 	return st.st_size;
 }
 
+/**
+ * Returns true when an opened file descriptor is known to be on a local file-system.
+ * Network and FUSE file-systems return false, as well as platforms where this can't be checked.
+ *
+ * Memory mapping files on these isn't safe: I/O errors are only reported by a SIGBUS signal.
+ */
+bool BLI_file_descriptor_is_local(int file)
+{
+#if defined(__linux__)
+	struct statfs disk;
+	if ((file < 0) || (fstatfs(file, &disk) == -1))
+		return false;
+	switch ((unsigned int)disk.f_type) {
+		case 0x6969:      /* NFS */
+		case 0x517B:      /* SMB */
+		case 0xFF534D42:  /* CIFS */
+		case 0xFE534D42:  /* SMB2 */
+		case 0x65735546:  /* FUSE */
+		case 0x73757245:  /* CODA */
+		case 0x5346414F:  /* AFS */
+		case 0x00C36400:  /* CEPH */
+		case 0x01021997:  /* 9P */
+		case 0x47504653:  /* GPFS */
+			return false;
+		default:
+			return true;
+	}
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__)
+	struct statfs disk;
+	if ((file < 0) || (fstatfs(file, &disk) == -1))
+		return false;
+	return (disk.f_flags & MNT_LOCAL) != 0;
+#else
+	UNUSED_VARS(file);
+	return false;
+#endif
+}
+
 /**
  * Returns the size of a file.
  */
@@ -90,6 +90,8 @@ typedef struct Task {
 	bool free_taskdata;
 	TaskFreeFunction freedata;
 	TaskPool *pool;
+	/* Priority the task was pushed with, respected by delayed and suspended pushes as well. */
+	TaskPriority priority;
 } Task;
 
 /* This is a per-thread storage of pre-allocated tasks.
@@ -592,7 +594,10 @@ static void task_scheduler_push_all(TaskScheduler *scheduler,
 	BLI_mutex_lock(&scheduler->queue_mutex);
 
 	for (int i = 0; i < num_tasks; i++) {
-		BLI_addhead(&scheduler->queue, tasks[i]);
+		if (tasks[i]->priority == TASK_PRIORITY_HIGH)
+			BLI_addhead(&scheduler->queue, tasks[i]);
+		else
+			BLI_addtail(&scheduler->queue, tasks[i]);
 	}
 
 	BLI_condition_notify_all(&scheduler->queue_cond);
@@ -783,6 +788,7 @@ static void task_pool_push(
 	task->free_taskdata = free_taskdata;
 	task->freedata = freedata;
 	task->pool = pool;
+	task->priority = priority;
 	/* For suspended pools we put everything yo a global queue first
 	 * and exit as soon as possible.
 	 *
@@ -790,7 +796,10 @@ static void task_pool_push(
 	 * activated by work_and_wait().
 	 */
 	if (pool->is_suspended) {
-		BLI_addhead(&pool->suspended_queue, task);
+		if (priority == TASK_PRIORITY_HIGH)
+			BLI_addhead(&pool->suspended_queue, task);
+		else
+			BLI_addtail(&pool->suspended_queue, task);
 		atomic_fetch_and_add_z(&pool->num_suspended, 1);
 		return;
 	}
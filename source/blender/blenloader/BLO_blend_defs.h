@@ -75,6 +75,69 @@ enum {
 	ENDB = BLEND_MAKE_ID('E', 'N', 'D', 'B'),
 };
 
+/**
+ * Compressed files (#G_FILE_COMPRESS) are written as independently compressed gzip members
+ * ("frames"), followed by a seek table so frames can be located without decompressing the file.
+ *
+ * The seek table is stored (without compression) in the last gzip member, its data follows #ENDB
+ * so it's ignored by readers unaware of it. The uncompressed contents of this member are:
+ *
+ * - An invalid BHead (code #ENDB, negative length) for readers which read past #ENDB.
+ * - For each frame: `uint32 compressed_size, uint32 uncompressed_size`.
+ * - #BlendSeekTableFooter, as a separate stored block, directly before the gzip trailer
+ *   so it can be found reading the end of the file.
+ *
+ * All values are little endian.
+ */
+#define BLEN_SEEKTABLE_MAGIC "BLENSEEK"
+
+typedef struct BlendSeekTableFooter {
+	unsigned int frames_num;
+	/** Size of the gzip member containing the seek table (in the compressed file). */
+	unsigned int member_size;
+	char magic[8];
+} BlendSeekTableFooter;
+
+/**
+ * Uncompressed files (not undo memfiles) store an index of their ID's after #ENDB, behind the same
+ * invalid BHead as the seek table, so linking can look up ID's, their dependencies and the #GLOB & #DNA1
+ * blocks without scanning the whole file. It's only read from memory mapped files, compressed files
+ * don't have it. Following the invalid BHead (aligned to 8 bytes):
+ *
+ * - #BlendLibraryIndexEntry for each ID written (local ID's, #ID_LI and #ID_ID blocks), in file order.
+ * - The dependencies of all entries, as `uint32` entry indices.
+ * - #BlendLibraryIndexFooter, at the very end of the file.
+ *
+ * Offsets are from the start of the file, values use the byte order of the file.
+ */
+#define BLEN_LIBRARY_INDEX_MAGIC "BLENLIDX"
+
+typedef struct BlendLibraryIndexEntry {
+	/** Offset of the ID's #BHead. */
+	uint64_t offset;
+	/** Size of all blocks written for this ID (its #BHead and the data following it). */
+	uint64_t size;
+	/** #BHead.old of the ID. */
+	uint64_t old;
+	/** Range in the dependency array: entries of the ID's this one uses. */
+	unsigned int deps_start, deps_num;
+	/** Entry of the library for #ID_ID blocks, otherwise -1. */
+	int lib;
+	/** The ID code (#ID_Type, not the #BHead.code). */
+	int idcode;
+	char name[66];  /* MAX_ID_NAME */
+	char _pad[6];
+} BlendLibraryIndexEntry;
+
+typedef struct BlendLibraryIndexFooter {
+	/** Offset of the first #BlendLibraryIndexEntry. */
+	uint64_t index_offset;
+	/** Offsets of the #DNA1 and #GLOB BHead's. */
+	uint64_t dna_offset, glob_offset;
+	unsigned int entries_num, deps_num;
+	char magic[8];
+} BlendLibraryIndexFooter;
+
 #define BLEN_THUMB_MEMSIZE_FILE(_x, _y) (sizeof(int) * (2 + (size_t)(_x) * (size_t)(_y)))
 
 #endif  /* __BLO_BLEND_DEFS_H__ */
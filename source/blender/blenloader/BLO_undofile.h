@@ -35,18 +35,30 @@
 
 struct Scene;
 
+struct MemFileBlob;
+
 typedef struct {
 	void *next, *prev;
-	const char *buf;
+	/**
+	 * The contents, stored once for all chunks with the same contents (in any #MemFile),
+	 * access using #BLO_memfile_chunk_data since it may be compressed.
+	 */
+	struct MemFileBlob *blob;
 	/** Size in bytes. */
 	unsigned int size;
-	/** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
+	/** When true, this chunk has the same contents as the chunk at the same position in the previous #MemFile. */
 	bool is_identical;
 } MemFileChunk;
 
 typedef struct MemFile {
 	ListBase chunks;
+	/**
+	 * Memory used by contents which older memfiles don't use (may be compressed),
+	 * so the sizes of all memfiles add up to the memory used by the contents of all of them.
+	 */
 	size_t size;
+	/** The chunks written for each ID (#MemFileSegment by ID pointer), so the next undo step can reuse them. */
+	struct GHash *id_segments;
 } MemFile;
 
 typedef struct MemFileUndoData {
@@ -59,10 +71,16 @@ typedef struct MemFileUndoData {
 extern void memfile_chunk_add(
         MemFile *memfile, const char *buf, unsigned int size,
         MemFileChunk **compchunk_step);
+extern void memfile_segment_add(
+        MemFile *memfile, const void *id, MemFileChunk *first, unsigned int chunks_num);
+extern bool memfile_segment_reuse(
+        MemFile *memfile, const MemFile *compare, const void *id,
+        const unsigned char *data, size_t data_len);
 
 /* exports */
 extern void BLO_memfile_free(MemFile *memfile);
 extern void BLO_memfile_merge(MemFile *first, MemFile *second);
+extern const char *BLO_memfile_chunk_data(const MemFileChunk *chunk, char *buf_tmp);
 
 /* utilities */
 extern struct Main *BLO_memfile_main_get(struct MemFile *memfile, struct Main *bmain, struct Scene **r_scene);
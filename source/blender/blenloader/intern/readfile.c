@@ -46,6 +46,7 @@
 #include "BLI_utildefines.h"
 #ifndef WIN32
 #  include <unistd.h> // for read close
+#  include <sys/mman.h> // for mmap munmap posix_madvise
 #else
 #  include <io.h> // for open close read
 #  include "winsock2.h"
@@ -112,11 +113,13 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_bitmap.h"
 #include "BLI_endian_switch.h"
 #include "BLI_blenlib.h"
 #include "BLI_math.h"
 #include "BLI_threads.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 
 #include "BLT_translation.h"
 
@@ -234,6 +237,12 @@
 /* use GHash for BHead name-based lookups (speeds up linking) */
 #define USE_GHASH_BHEAD
 
+/* Memory map uncompressed files, referencing BHead's and their data directly from the mapping
+ * (see #FD_FLAGS_FILE_MMAP). Not supported by mmap_win's MAP_PRIVATE emulation. */
+#ifndef WIN32
+#  define USE_MMAP_READ
+#endif
+
 /* Use GHash for restoring pointers by name */
 #define USE_GHASH_RESTORE_POINTER
 
@@ -267,6 +276,10 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname);
 static void direct_link_modifiers(FileData *fd, ListBase *lb);
 static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const char *name);
 static BHead *find_bhead_from_idname(FileData *fd, const char *idname);
+static BHead *library_index_global_bhead(FileData *fd, int code);
+#ifdef USE_GHASH_BHEAD
+static void library_index_idname_map_create(FileData *fd);
+#endif
 
 #ifdef USE_COLLECTION_COMPAT_28
 static void expand_scene_collection(FileData *fd, Main *mainvar, SceneCollection *sc);
@@ -586,9 +599,9 @@ void blo_split_main(ListBase *mainlist, Main *main)
 
 static void read_file_version(FileData *fd, Main *main)
 {
-	BHead *bhead;
+	BHead *bhead = library_index_global_bhead(fd, GLOB);
 
-	for (bhead= blo_firstbhead(fd); bhead; bhead= blo_nextbhead(fd, bhead)) {
+	for (bhead = bhead ? bhead : blo_firstbhead(fd); bhead; bhead= blo_nextbhead(fd, bhead)) {
 		if (bhead->code == GLOB) {
 			FileGlobal *fg= read_struct(fd, bhead, "Global");
 			if (fg) {
@@ -617,6 +630,11 @@ static void read_file_bhead_idname_map_create(FileData *fd)
 	int code_prev = ENDB;
 	unsigned int reserve = 0;
 
+	if (fd->library_index) {
+		library_index_idname_map_create(fd);
+		return;
+	}
+
 	for (bhead = blo_firstbhead(fd); bhead; bhead = blo_nextbhead(fd, bhead)) {
 		if (code_prev != bhead->code) {
 			code_prev = bhead->code;
@@ -858,11 +876,110 @@ static BHeadN *get_bhead(FileData *fd)
 	return(new_bhead);
 }
 
+/**
+ * Memory mapped files don't need conversion are read without copying their BHeadN's,
+ * the data of each block is used directly from the mapping (see #blo_bhead_data).
+ */
+BLI_INLINE bool fd_bhead_is_mapped(const FileData *fd)
+{
+	return ((fd->flags & FD_FLAGS_FILE_MMAP) &&
+	        (fd->flags & (FD_FLAGS_SWITCH_ENDIAN | FD_FLAGS_POINTSIZE_DIFFERS)) == 0);
+}
+
+BLI_INLINE BHeadMapped *bhead_mapped(const BHead *bhead)
+{
+	return (BHeadMapped *)POINTER_OFFSET(bhead, -offsetof(BHeadMapped, bhead));
+}
+
+/**
+ * \return The BHead at \a offset in the mapping or NULL when there is no (valid) BHead.
+ *
+ * BHead's in the file are only 4 bytes aligned (the file header is 12 bytes and block lengths
+ * are padded to 4), so #BHead.old can't be read in place. Each BHead is copied once,
+ * the same offset always gives the same BHead pointer.
+ */
+static BHead *bhead_from_mmap(FileData *fd, size_t offset)
+{
+	const size_t buffersize = (size_t)fd->buffersize;
+
+	if (offset + sizeof(BHead) > buffersize) {
+		return NULL;
+	}
+
+	BHeadMapped *bhead_map = BLI_ghash_lookup(fd->mmap_bhead_map, SET_UINT_IN_POINTER(offset));
+	if (bhead_map) {
+		return &bhead_map->bhead;
+	}
+
+	BHead bhead;
+	memcpy(&bhead, POINTER_OFFSET(fd->buffer, offset), sizeof(bhead));
+
+	/* make sure people are not trying to pass bad blend files */
+	if ((bhead.len < 0) || (offset + sizeof(BHead) + (size_t)bhead.len > buffersize)) {
+		return NULL;
+	}
+
+	bhead_map = BLI_mempool_alloc(fd->mmap_bhead_pool);
+	bhead_map->offset = offset;
+	bhead_map->bhead = bhead;
+	BLI_ghash_insert(fd->mmap_bhead_map, SET_UINT_IN_POINTER(offset), bhead_map);
+
+	return &bhead_map->bhead;
+}
+
+static BHead *blo_nextbhead_mmap(FileData *fd, BHead *thisblock)
+{
+	if (thisblock->code == ENDB) {
+		return NULL;
+	}
+	return bhead_from_mmap(fd, bhead_mapped(thisblock)->offset + sizeof(BHead) + (size_t)thisblock->len);
+}
+
+static int bhead_offset_cmp(const void *a, const void *b)
+{
+	const size_t offset_a = bhead_mapped(*(const BHead **)a)->offset;
+	const size_t offset_b = bhead_mapped(*(const BHead **)b)->offset;
+
+	return (offset_a < offset_b) ? -1 : ((offset_a > offset_b) ? 1 : 0);
+}
+
+static BHead *blo_prevbhead_mmap(FileData *fd, BHead *thisblock)
+{
+	/* There are no links to the previous BHead, lazily build an array of all BHead's (in file order). */
+	if (fd->mmap_bheads == NULL) {
+		BHead *bhead;
+		int tot = 0;
+
+		for (bhead = blo_firstbhead(fd); bhead; bhead = blo_nextbhead_mmap(fd, bhead)) {
+			tot++;
+		}
+
+		fd->mmap_bheads = MEM_malloc_arrayN(MAX2(tot, 1), sizeof(*fd->mmap_bheads), __func__);
+		fd->mmap_bheads_len = tot;
+
+		tot = 0;
+		for (bhead = blo_firstbhead(fd); bhead; bhead = blo_nextbhead_mmap(fd, bhead)) {
+			fd->mmap_bheads[tot++] = bhead;
+		}
+	}
+
+	BHead **bhead_p = bsearch(&thisblock, fd->mmap_bheads, fd->mmap_bheads_len, sizeof(*fd->mmap_bheads), bhead_offset_cmp);
+	if (bhead_p && (bhead_p != fd->mmap_bheads)) {
+		return *(bhead_p - 1);
+	}
+
+	return NULL;
+}
+
 BHead *blo_firstbhead(FileData *fd)
 {
 	BHeadN *new_bhead;
 	BHead *bhead = NULL;
 
+	if (fd_bhead_is_mapped(fd)) {
+		return bhead_from_mmap(fd, SIZEOFBLENDERHEADER);
+	}
+
 	/* Rewind the file
 	 * Read in a new block if necessary
 	 */
@@ -878,8 +995,12 @@ BHead *blo_firstbhead(FileData *fd)
 	return(bhead);
 }
 
-BHead *blo_prevbhead(FileData *UNUSED(fd), BHead *thisblock)
+BHead *blo_prevbhead(FileData *fd, BHead *thisblock)
 {
+	if (fd_bhead_is_mapped(fd)) {
+		return blo_prevbhead_mmap(fd, thisblock);
+	}
+
 	BHeadN *bheadn = (BHeadN *)POINTER_OFFSET(thisblock, -offsetof(BHeadN, bhead));
 	BHeadN *prev = bheadn->prev;
 
@@ -891,6 +1012,10 @@ BHead *blo_nextbhead(FileData *fd, BHead *thisblock)
 	BHeadN *new_bhead = NULL;
 	BHead *bhead = NULL;
 
+	if (fd_bhead_is_mapped(fd)) {
+		return thisblock ? blo_nextbhead_mmap(fd, thisblock) : NULL;
+	}
+
 	if (thisblock) {
 		/* bhead is actually a sub part of BHeadN
 		 * We calculate the BHeadN pointer from the BHead pointer below */
@@ -912,12 +1037,293 @@ BHead *blo_nextbhead(FileData *fd, BHead *thisblock)
 	return(bhead);
 }
 
+/**
+ * \return The data of the block, it follows \a bhead in the file.
+ */
+const void *blo_bhead_data(const FileData *fd, const BHead *bhead)
+{
+	if (fd_bhead_is_mapped(fd)) {
+		return POINTER_OFFSET(fd->buffer, bhead_mapped(bhead)->offset + sizeof(BHead));
+	}
+	return bhead + 1;
+}
+
 /* Warning! Caller's responsibility to ensure given bhead **is** and ID one! */
 const char *bhead_id_name(const FileData *fd, const BHead *bhead)
 {
-	return (const char *)POINTER_OFFSET(bhead, sizeof(*bhead) + fd->id_name_offs);
+	return (const char *)POINTER_OFFSET(blo_bhead_data(fd, bhead), fd->id_name_offs);
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Library Index
+ *
+ * Uses the index written after #ENDB (see: #BLEN_LIBRARY_INDEX_MAGIC) to find ID's and the
+ * #GLOB & #DNA1 blocks without scanning the file. Only used for memory mapped files which
+ * don't need conversion (see: #fd_bhead_is_mapped), so the index can be used in place.
+ *
+ * The index is only a hint: any BHead found through it is checked,
+ * on mismatch the index is discarded and we fall back to scanning.
+ * \{ */
+
+typedef struct LibraryIndex {
+	const BlendLibraryIndexEntry *entries;
+	const uint *deps;
+	uint entries_num, deps_num;
+	size_t dna_offset, glob_offset;
+	/** Entries sorted by #BlendLibraryIndexEntry.old (lazily initialized). */
+	const BlendLibraryIndexEntry **old_map;
+	/** Entries already prefetched (lazily initialized), see: #library_index_prefetch. */
+	BLI_bitmap *prefetched;
+} LibraryIndex;
+
+static void library_index_read(FileData *fd)
+{
+	const BlendLibraryIndexFooter *footer;
+	const size_t buffersize = (size_t)fd->buffersize;
+
+	BLI_assert(fd->library_index == NULL);
+
+	/* The footer is 8 byte aligned at the end of the file. */
+	if (!fd_bhead_is_mapped(fd) ||
+	    (buffersize < SIZEOFBLENDERHEADER + sizeof(*footer)) ||
+	    (buffersize % 8) != 0)
+	{
+		return;
+	}
+
+	footer = (const BlendLibraryIndexFooter *)POINTER_OFFSET(fd->buffer, buffersize - sizeof(*footer));
+	if (!STREQLEN(footer->magic, BLEN_LIBRARY_INDEX_MAGIC, sizeof(footer->magic))) {
+		return;
+	}
+
+	/* Make sure people are not trying to pass bad blend files. */
+	const uint64_t index_end = buffersize - sizeof(*footer);
+	const uint64_t index_offset = footer->index_offset;
+	if ((index_offset % 8) != 0 ||
+	    (index_offset < SIZEOFBLENDERHEADER) ||
+	    (index_offset > index_end) ||
+	    ((index_end - index_offset) / sizeof(BlendLibraryIndexEntry) < footer->entries_num) ||
+	    ((index_end - index_offset - footer->entries_num * sizeof(BlendLibraryIndexEntry)) / sizeof(uint) <
+	     footer->deps_num) ||
+	    (footer->dna_offset >= index_offset) ||
+	    (footer->glob_offset >= index_offset))
+	{
+		return;
+	}
+
+	LibraryIndex *index = MEM_callocN(sizeof(*index), __func__);
+	index->entries = (const BlendLibraryIndexEntry *)POINTER_OFFSET(fd->buffer, index_offset);
+	index->deps = (const uint *)(index->entries + footer->entries_num);
+	index->entries_num = footer->entries_num;
+	index->deps_num = footer->deps_num;
+	index->dna_offset = (size_t)footer->dna_offset;
+	index->glob_offset = (size_t)footer->glob_offset;
+
+	fd->library_index = index;
+}
+
+static void library_index_free(FileData *fd)
+{
+	LibraryIndex *index = fd->library_index;
+
+	MEM_SAFE_FREE(index->old_map);
+	MEM_SAFE_FREE(index->prefetched);
+	MEM_freeN(index);
+
+	fd->library_index = NULL;
+}
+
+/**
+ * Called when the index doesn't match the file, all look-ups fall back to scanning afterwards.
+ */
+static void library_index_discard(FileData *fd)
+{
+	printf("%s: invalid library index in '%s', ignoring\n", __func__, fd->relabase);
+
+	library_index_free(fd);
+
+#ifdef USE_GHASH_BHEAD
+	/* May have been created from the index. */
+	if (fd->bhead_idname_hash) {
+		BLI_ghash_free(fd->bhead_idname_hash, NULL, NULL);
+		fd->bhead_idname_hash = NULL;
+		read_file_bhead_idname_map_create(fd);
+	}
+#endif
+}
+
+/**
+ * \return The BHead of \a entry, or NULL when it doesn't match the index.
+ */
+static BHead *library_index_entry_bhead(FileData *fd, const BlendLibraryIndexEntry *entry)
+{
+	BHead *bhead = bhead_from_mmap(fd, (size_t)entry->offset);
+
+	if ((bhead == NULL) ||
+	    ((uint64_t)(uintptr_t)bhead->old != entry->old) ||
+	    ((size_t)bhead->len < (size_t)fd->id_name_offs + sizeof(entry->name)) ||
+	    !STREQLEN(bhead_id_name(fd, bhead), entry->name, sizeof(entry->name)))
+	{
+		return NULL;
+	}
+
+	return bhead;
+}
+
+/**
+ * \return The first BHead with \a code (#GLOB or #DNA1) found through the index,
+ * NULL when there is no index, callers scan from there (so a wrong offset is harmless).
+ */
+static BHead *library_index_global_bhead(FileData *fd, int code)
+{
+	const LibraryIndex *index = fd->library_index;
+
+	if (index) {
+		BHead *bhead = bhead_from_mmap(fd, (code == DNA1) ? index->dna_offset : index->glob_offset);
+		if (bhead && (bhead->code == code)) {
+			return bhead;
+		}
+	}
+
+	return NULL;
+}
+
+static int library_index_entry_old_cmp(const void *a, const void *b)
+{
+	const BlendLibraryIndexEntry *entry_a = *(const BlendLibraryIndexEntry **)a;
+	const BlendLibraryIndexEntry *entry_b = *(const BlendLibraryIndexEntry **)b;
+
+	return (entry_a->old < entry_b->old) ? -1 : ((entry_a->old > entry_b->old) ? 1 : 0);
+}
+
+static const BlendLibraryIndexEntry *library_index_find_old(FileData *fd, const void *old)
+{
+	LibraryIndex *index = fd->library_index;
+
+	if (index->old_map == NULL) {
+		index->old_map = MEM_malloc_arrayN(MAX2(index->entries_num, 1), sizeof(*index->old_map), __func__);
+		for (uint i = 0; i < index->entries_num; i++) {
+			index->old_map[i] = &index->entries[i];
+		}
+		qsort(index->old_map, index->entries_num, sizeof(*index->old_map), library_index_entry_old_cmp);
+	}
+
+	const BlendLibraryIndexEntry entry_key = {.old = (uint64_t)(uintptr_t)old};
+	const BlendLibraryIndexEntry *entry_key_p = &entry_key;
+	const BlendLibraryIndexEntry **entry_p = bsearch(
+	        &entry_key_p, index->old_map, index->entries_num, sizeof(*index->old_map), library_index_entry_old_cmp);
+
+	return entry_p ? *entry_p : NULL;
+}
+
+#ifdef USE_GHASH_BHEAD
+/**
+ * Fill #FileData.bhead_idname_hash from the index. While the index is used, the values
+ * are BHead offsets in the mapping, checked on look-up (see: #library_index_idname_check).
+ */
+static void library_index_idname_map_create(FileData *fd)
+{
+	const LibraryIndex *index = fd->library_index;
+
+	BLI_assert(fd->bhead_idname_hash == NULL);
+
+	fd->bhead_idname_hash = BLI_ghash_str_new_ex(__func__, index->entries_num);
+
+	for (uint i = 0; i < index->entries_num; i++) {
+		const BlendLibraryIndexEntry *entry = &index->entries[i];
+		const short idcode = (short)entry->idcode;
+
+		if ((entry->lib == -1) &&
+		    BKE_idcode_is_valid(idcode) && BKE_idcode_is_linkable(idcode) &&
+		    (entry->name[sizeof(entry->name) - 1] == '\0') &&
+		    (entry->offset < (uint64_t)fd->buffersize))
+		{
+			BLI_ghash_insert(fd->bhead_idname_hash, (void *)entry->name, SET_UINT_IN_POINTER(entry->offset));
+		}
+	}
+}
+
+/**
+ * Check the BHead found from the index by name, on mismatch the index is discarded.
+ *
+ * \param value: Value of \a idname in #FileData.bhead_idname_hash.
+ * \return The BHead or the result of scanning the file.
+ */
+static BHead *library_index_idname_check(FileData *fd, void *value, const char *idname)
+{
+	BHead *bhead = value;
+
+	if (value && fd->library_index) {
+		bhead = bhead_from_mmap(fd, (size_t)GET_UINT_FROM_POINTER(value));
+		if ((bhead == NULL) ||
+		    ((size_t)bhead->len < (size_t)fd->id_name_offs + MAX_ID_NAME) ||
+		    !STREQ(bhead_id_name(fd, bhead), idname))
+		{
+			library_index_discard(fd);
+			bhead = BLI_ghash_lookup(fd->bhead_idname_hash, idname);
+		}
+	}
+
+	return bhead;
+}
+#endif
+
+/**
+ * Ask the OS to read in the blocks of the ID at \a bhead and all ID's it (indirectly) uses,
+ * so they're loaded in bulk instead of faulting in page by page while reading.
+ */
+static void library_index_prefetch(FileData *fd, BHead *bhead)
+{
+#ifdef USE_MMAP_READ
+	LibraryIndex *index = fd->library_index;
+	const BlendLibraryIndexEntry *entry;
+
+	if ((index == NULL) || (entry = library_index_find_old(fd, bhead->old)) == NULL) {
+		return;
+	}
+
+	if (index->prefetched == NULL) {
+		index->prefetched = BLI_BITMAP_NEW(MAX2(index->entries_num, 1), __func__);
+	}
+
+	const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	uint *stack = MEM_malloc_arrayN(index->entries_num + 1, sizeof(*stack), __func__);
+	uint stack_len = 0;
+
+	stack[stack_len++] = (uint)(entry - index->entries);
+	BLI_BITMAP_ENABLE(index->prefetched, stack[0]);
+
+	while (stack_len) {
+		entry = &index->entries[stack[--stack_len]];
+
+		if ((entry->offset < (uint64_t)fd->buffersize) && (entry->size <= (uint64_t)fd->buffersize - entry->offset)) {
+			const size_t offset = (size_t)entry->offset;
+			const size_t offset_page = offset - (offset % page_size);
+			posix_madvise((void *)(fd->buffer + offset_page), (offset - offset_page) + (size_t)entry->size,
+			              POSIX_MADV_WILLNEED);
+		}
+
+		if ((entry->deps_start > index->deps_num) || (entry->deps_num > index->deps_num - entry->deps_start)) {
+			continue;
+		}
+
+		for (uint i = 0; i < entry->deps_num; i++) {
+			const uint dep = index->deps[entry->deps_start + i];
+			if ((dep < index->entries_num) && !BLI_BITMAP_TEST(index->prefetched, dep)) {
+				BLI_BITMAP_ENABLE(index->prefetched, dep);
+				stack[stack_len++] = dep;
+			}
+		}
+	}
+
+	MEM_freeN(stack);
+#else
+	UNUSED_VARS(fd, bhead);
+#endif
+}
+
+/** \} */
+
 static void decode_blender_header(FileData *fd)
 {
 	char header[SIZEOFBLENDERHEADER], num[4];
@@ -966,13 +1372,16 @@ static void decode_blender_header(FileData *fd)
  */
 static bool read_file_dna(FileData *fd, const char **r_error_message)
 {
-	BHead *bhead;
+	BHead *bhead = library_index_global_bhead(fd, DNA1);
 
-	for (bhead = blo_firstbhead(fd); bhead; bhead = blo_nextbhead(fd, bhead)) {
+	for (bhead = bhead ? bhead : blo_firstbhead(fd); bhead; bhead = blo_nextbhead(fd, bhead)) {
 		if (bhead->code == DNA1) {
 			const bool do_endian_swap = (fd->flags & FD_FLAGS_SWITCH_ENDIAN) != 0;
 
-			fd->filesdna = DNA_sdna_from_data(&bhead[1], bhead->len, do_endian_swap, true, r_error_message);
+			/* The mapping is kept until the file-data is freed, no need to copy. */
+			const bool data_alloc = !fd_bhead_is_mapped(fd);
+			fd->filesdna = DNA_sdna_from_data(
+			        blo_bhead_data(fd, bhead), bhead->len, do_endian_swap, data_alloc, r_error_message);
 			if (fd->filesdna) {
 				fd->compflags = DNA_struct_get_compareflags(fd->filesdna, fd->memsdna);
 				/* used to retrieve ID names from (bhead+1) */
@@ -1001,7 +1410,7 @@ static int *read_file_thumbnail(FileData *fd)
 	for (bhead = blo_firstbhead(fd); bhead; bhead = blo_nextbhead(fd, bhead)) {
 		if (bhead->code == TEST) {
 			const bool do_endian_swap = (fd->flags & FD_FLAGS_SWITCH_ENDIAN) != 0;
-			int *data = (int *)(bhead + 1);
+			int *data = (int *)blo_bhead_data(fd, bhead);
 
 			if (bhead->len < (2 * sizeof(int))) {
 				break;
@@ -1059,6 +1468,23 @@ static int fd_read_from_memory(FileData *filedata, void *buffer, unsigned int si
 	return (readsize);
 }
 
+/**
+ * Chunks may be compressed, keep the last one decompressed since reading is mostly sequential.
+ */
+static const char *fd_memfile_chunk_data(FileData *filedata, const MemFileChunk *chunk)
+{
+	if (filedata->memfile_chunk != chunk) {
+		if (filedata->memfile_chunk_buf_len < chunk->size) {
+			MEM_SAFE_FREE(filedata->memfile_chunk_buf);
+			filedata->memfile_chunk_buf = MEM_mallocN(chunk->size, __func__);
+			filedata->memfile_chunk_buf_len = chunk->size;
+		}
+		filedata->memfile_chunk_data = BLO_memfile_chunk_data(chunk, filedata->memfile_chunk_buf);
+		filedata->memfile_chunk = chunk;
+	}
+	return filedata->memfile_chunk_data;
+}
+
 static int fd_read_from_memfile(FileData *filedata, void *buffer, unsigned int size)
 {
 	static unsigned int seek = (1<<30);	/* the current position */
@@ -1106,7 +1532,7 @@ static int fd_read_from_memfile(FileData *filedata, void *buffer, unsigned int s
 			if (chunkoffset+readsize > chunk->size)
 				readsize= chunk->size-chunkoffset;
 
-			memcpy(POINTER_OFFSET(buffer, totread), chunk->buf + chunkoffset, readsize);
+			memcpy(POINTER_OFFSET(buffer, totread), fd_memfile_chunk_data(filedata, chunk) + chunkoffset, readsize);
 			totread += readsize;
 			filedata->seek += readsize;
 			seek += readsize;
@@ -1118,6 +1544,275 @@ static int fd_read_from_memfile(FileData *filedata, void *buffer, unsigned int s
 	return 0;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Seekable Compressed File Reading
+ *
+ * Compressed files written with a seek table (see #BLEN_SEEKTABLE_MAGIC)
+ * are read a batch of frames at a time, decompressing frames in parallel.
+ * Reading at any offset only decompresses the frames containing it.
+ * \{ */
+
+/* Number of frames decompressed at once. */
+#define ZLIB_FRAME_READ_BATCH 16
+
+typedef struct ZlibFrameReader {
+	int frames_num;
+	/** Offset of each frame in the file & uncompressed stream (both have `frames_num + 1` items). */
+	int64_t *offset_compressed;
+	int64_t *offset_uncompressed;
+
+	/** Decompressed data of frames `[batch_frame, batch_frame + batch_frames_num)`. */
+	uchar *buf;
+	size_t buf_alloc;
+	uchar *buf_compressed;
+	size_t buf_compressed_alloc;
+
+	int batch_frame;
+	int batch_frames_num;
+} ZlibFrameReader;
+
+typedef struct ZlibFrameReadData {
+	const ZlibFrameReader *zr;
+	bool error[ZLIB_FRAME_READ_BATCH];
+} ZlibFrameReadData;
+
+static void zlib_frame_reader_free(ZlibFrameReader *zr)
+{
+	MEM_SAFE_FREE(zr->offset_compressed);
+	MEM_SAFE_FREE(zr->offset_uncompressed);
+	MEM_SAFE_FREE(zr->buf);
+	MEM_SAFE_FREE(zr->buf_compressed);
+	MEM_freeN(zr);
+}
+
+/**
+ * \return A reader when \a filedes is a compressed file with a valid seek table, otherwise NULL.
+ */
+static ZlibFrameReader *zlib_frame_reader_open(int filedes)
+{
+	struct {
+		BlendSeekTableFooter footer;
+		/* gzip trailer. */
+		uint crc, isize;
+	} tail;
+	uchar magic[2];
+
+	if ((read(filedes, magic, sizeof(magic)) != sizeof(magic)) ||
+	    (magic[0] != 0x1f || magic[1] != 0x8b))
+	{
+		return NULL;
+	}
+
+	BLI_STATIC_ASSERT(sizeof(tail) == sizeof(BlendSeekTableFooter) + 8, "Unexpected padding");
+	const int64_t tail_offset = lseek(filedes, -(int64_t)sizeof(tail), SEEK_END);
+	if ((tail_offset <= 0) ||
+	    (read(filedes, &tail, sizeof(tail)) != sizeof(tail)) ||
+	    (memcmp(tail.footer.magic, BLEN_SEEKTABLE_MAGIC, sizeof(tail.footer.magic)) != 0))
+	{
+		return NULL;
+	}
+
+	if (ENDIAN_ORDER == B_ENDIAN) {
+		BLI_endian_switch_uint32(&tail.footer.frames_num);
+		BLI_endian_switch_uint32(&tail.footer.member_size);
+	}
+
+	/* Validate the frame count before computing any sizes from it, so they can't overflow. */
+	if ((tail.footer.frames_num == 0) ||
+	    (tail.footer.frames_num > INT_MAX / 2) ||
+	    (tail.footer.frames_num > tail.footer.member_size / (2 * sizeof(uint))) ||
+	    (tail.footer.member_size < sizeof(tail)))
+	{
+		return NULL;
+	}
+
+	const int64_t file_size = tail_offset + (int64_t)sizeof(tail);
+	const int64_t member_offset = file_size - tail.footer.member_size;
+	const uint table_len = tail.footer.frames_num * 2;
+	/* Skip the terminator preceding the seek table, see: #ww_zlib_seek_table_write. */
+	const uint terminator_size = 2 * sizeof(int);
+	const uint64_t member_data_size =
+	        (uint64_t)terminator_size + (uint64_t)table_len * sizeof(uint) + sizeof(BlendSeekTableFooter);
+	if ((member_offset <= 0) || (tail.footer.member_size < member_data_size) ||
+	    (lseek(filedes, member_offset, SEEK_SET) == -1))
+	{
+		return NULL;
+	}
+
+	/* Decompress the member containing the seek table. */
+	uchar *member = MEM_mallocN(tail.footer.member_size, __func__);
+	uint *member_data = MEM_mallocN((size_t)member_data_size, __func__);
+	const uint *seek_table = POINTER_OFFSET(member_data, terminator_size);
+	bool ok = false;
+
+	if (read(filedes, member, tail.footer.member_size) == tail.footer.member_size) {
+		z_stream strm = {NULL};
+		if (inflateInit2(&strm, 16 + MAX_WBITS) == Z_OK) {
+			strm.next_in = member;
+			strm.avail_in = tail.footer.member_size;
+			strm.next_out = (Bytef *)member_data;
+			strm.avail_out = (uInt)member_data_size;
+			ok = (inflate(&strm, Z_FINISH) == Z_STREAM_END) && (strm.total_out == member_data_size);
+			inflateEnd(&strm);
+		}
+	}
+	MEM_freeN(member);
+
+	if (ok == false) {
+		MEM_freeN(member_data);
+		return NULL;
+	}
+
+	if (ENDIAN_ORDER == B_ENDIAN) {
+		BLI_endian_switch_uint32_array((uint *)seek_table, (int)table_len);
+	}
+
+	ZlibFrameReader *zr = MEM_callocN(sizeof(*zr), __func__);
+	zr->frames_num = (int)tail.footer.frames_num;
+	zr->offset_compressed = MEM_mallocN(sizeof(int64_t) * (zr->frames_num + 1), __func__);
+	zr->offset_uncompressed = MEM_mallocN(sizeof(int64_t) * (zr->frames_num + 1), __func__);
+	zr->offset_compressed[0] = 0;
+	zr->offset_uncompressed[0] = 0;
+	for (int i = 0; i < zr->frames_num; i++) {
+		zr->offset_compressed[i + 1] = zr->offset_compressed[i] + seek_table[i * 2];
+		zr->offset_uncompressed[i + 1] = zr->offset_uncompressed[i] + seek_table[i * 2 + 1];
+	}
+	MEM_freeN(member_data);
+
+	/* The frames must exactly fill the file up to the seek table. */
+	if (zr->offset_compressed[zr->frames_num] != member_offset) {
+		zlib_frame_reader_free(zr);
+		return NULL;
+	}
+
+	return zr;
+}
+
+static void zlib_frame_decompress_cb(
+        void *__restrict userdata,
+        const int iter,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	ZlibFrameReadData *data = userdata;
+	const ZlibFrameReader *zr = data->zr;
+	const int frame = zr->batch_frame + iter;
+	z_stream strm = {NULL};
+
+	data->error[iter] = true;
+
+	if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK) {
+		return;
+	}
+
+	const int64_t offset_compressed = zr->offset_compressed[frame] - zr->offset_compressed[zr->batch_frame];
+	const int64_t offset_uncompressed = zr->offset_uncompressed[frame] - zr->offset_uncompressed[zr->batch_frame];
+	const uint len_uncompressed = (uint)(zr->offset_uncompressed[frame + 1] - zr->offset_uncompressed[frame]);
+
+	strm.next_in = zr->buf_compressed + offset_compressed;
+	strm.avail_in = (uint)(zr->offset_compressed[frame + 1] - zr->offset_compressed[frame]);
+	strm.next_out = zr->buf + offset_uncompressed;
+	strm.avail_out = len_uncompressed;
+
+	if ((inflate(&strm, Z_FINISH) == Z_STREAM_END) && (strm.total_out == len_uncompressed)) {
+		data->error[iter] = false;
+	}
+
+	inflateEnd(&strm);
+}
+
+/**
+ * Decompress the batch of frames starting with the frame which contains \a offset.
+ */
+static bool zlib_frame_reader_load(ZlibFrameReader *zr, int filedes, int64_t offset)
+{
+	/* Binary search for the frame containing the offset. */
+	int frame_min = 0, frame_max = zr->frames_num;
+	if (offset < 0 || offset >= zr->offset_uncompressed[zr->frames_num]) {
+		return false;
+	}
+	while (frame_max - frame_min > 1) {
+		const int frame_mid = (frame_min + frame_max) / 2;
+		if (zr->offset_uncompressed[frame_mid] <= offset) {
+			frame_min = frame_mid;
+		}
+		else {
+			frame_max = frame_mid;
+		}
+	}
+
+	const int frame = frame_min;
+	const int frames_num = MIN2(ZLIB_FRAME_READ_BATCH, zr->frames_num - frame);
+	const size_t len_compressed = (size_t)(zr->offset_compressed[frame + frames_num] - zr->offset_compressed[frame]);
+	const size_t len_uncompressed = (size_t)(zr->offset_uncompressed[frame + frames_num] - zr->offset_uncompressed[frame]);
+
+	/* Invalidate in case of errors. */
+	zr->batch_frames_num = 0;
+
+	if (len_compressed > zr->buf_compressed_alloc) {
+		MEM_SAFE_FREE(zr->buf_compressed);
+		zr->buf_compressed = MEM_mallocN(len_compressed, __func__);
+		zr->buf_compressed_alloc = len_compressed;
+	}
+	if (len_uncompressed > zr->buf_alloc) {
+		MEM_SAFE_FREE(zr->buf);
+		zr->buf = MEM_mallocN(len_uncompressed, __func__);
+		zr->buf_alloc = len_uncompressed;
+	}
+
+	if ((lseek(filedes, zr->offset_compressed[frame], SEEK_SET) == -1) ||
+	    (read(filedes, zr->buf_compressed, len_compressed) != len_compressed))
+	{
+		return false;
+	}
+
+	zr->batch_frame = frame;
+
+	ZlibFrameReadData data = {.zr = zr};
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.use_threading = (frames_num > 1);
+	settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+	BLI_task_parallel_range(0, frames_num, &data, zlib_frame_decompress_cb, &settings);
+
+	for (int i = 0; i < frames_num; i++) {
+		if (data.error[i]) {
+			return false;
+		}
+	}
+
+	zr->batch_frames_num = frames_num;
+	return true;
+}
+
+static int fd_read_zlib_frames_from_file(FileData *filedata, void *buffer, unsigned int size)
+{
+	ZlibFrameReader *zr = filedata->zlib_frames;
+	unsigned int totread = 0;
+
+	while (totread < size) {
+		const int64_t seek = filedata->seek;
+		int64_t batch_start = zr->offset_uncompressed[zr->batch_frame];
+		int64_t batch_end = zr->offset_uncompressed[zr->batch_frame + zr->batch_frames_num];
+
+		if (seek < batch_start || seek >= batch_end) {
+			if (!zlib_frame_reader_load(zr, filedata->filedes, seek)) {
+				break;
+			}
+			batch_start = zr->offset_uncompressed[zr->batch_frame];
+			batch_end = zr->offset_uncompressed[zr->batch_frame + zr->batch_frames_num];
+		}
+
+		const unsigned int readsize = (unsigned int)MIN2((int64_t)(size - totread), batch_end - seek);
+		memcpy(POINTER_OFFSET(buffer, totread), zr->buf + (seek - batch_start), readsize);
+		totread += readsize;
+		filedata->seek += readsize;
+	}
+
+	return totread;
+}
+
+/** \} */
+
 static FileData *filedata_new(void)
 {
 	FileData *fd = MEM_callocN(sizeof(FileData), "FileData");
@@ -1140,6 +1835,7 @@ static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
 
 	if (fd->flags & FD_FLAGS_FILE_OK) {
 		const char *error_message = NULL;
+		library_index_read(fd);
 		if (read_file_dna(fd, &error_message) == false) {
 			BKE_reportf(reports, RPT_ERROR,
 			            "Failed to read blend file '%s': %s",
@@ -1157,24 +1853,116 @@ static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
 	return fd;
 }
 
-/* cannot be called with relative paths anymore! */
-/* on each new library added, it now checks for the current FileData and expands relativeness */
-FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
+#ifdef USE_MMAP_READ
+/**
+ * Map uncompressed files into memory, the file can be closed afterwards.
+ *
+ * The mapping is private and writable: reading may modify BHead's in place,
+ * these changes are never written back to the file.
+ *
+ * Read errors of mapped files raise SIGBUS instead of failing a read() call, so only files on
+ * local file-systems are mapped, others (network shares of asset libraries...) are read.
+ * Files truncated after mapping them would also fault, Blender saves to a temporary file
+ * and renames it so files it writes are never truncated while mapped.
+ */
+static FileData *blo_filedata_from_file_mmap(int file)
+{
+	char header[SIZEOFBLENDERHEADER];
+
+	if ((lseek(file, 0, SEEK_SET) == -1) ||
+	    (read(file, header, sizeof(header)) != sizeof(header)) ||
+	    !STREQLEN(header, "BLENDER", 7))
+	{
+		return NULL;
+	}
+
+	if (!BLI_file_descriptor_is_local(file)) {
+		return NULL;
+	}
+
+	/* #FileData.buffersize is an int, larger files are read using regular file access. */
+	const size_t size = BLI_file_descriptor_size(file);
+	if ((size == (size_t)-1) || (size < SIZEOFBLENDERHEADER) || (size > INT_MAX)) {
+		return NULL;
+	}
+
+	void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	if (mem == MAP_FAILED) {
+		return NULL;
+	}
+
+	FileData *fd = filedata_new();
+	fd->buffer = mem;
+	fd->buffersize = (int)size;
+	fd->read = fd_read_from_memory;
+	fd->flags |= FD_FLAGS_FILE_MMAP;
+	fd->mmap_bhead_map = BLI_ghash_int_new(__func__);
+	fd->mmap_bhead_pool = BLI_mempool_create(sizeof(BHeadMapped), 0, 512, BLI_MEMPOOL_NOP);
+
+	close(file);
+
+	return fd;
+}
+#endif
+
+/**
+ * Open a file for reading, using the seek table of compressed files
+ * or a memory mapping for uncompressed files when available.
+ */
+static FileData *blo_filedata_from_file_open(const char *filepath)
 {
+	FileData *fd;
+
+	errno = 0;
+	const int file = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+	if (file == -1) {
+		return NULL;
+	}
+
+	ZlibFrameReader *zr = zlib_frame_reader_open(file);
+	if (zr != NULL) {
+		fd = filedata_new();
+		fd->filedes = file;
+		fd->zlib_frames = zr;
+		fd->read = fd_read_zlib_frames_from_file;
+		return fd;
+	}
+
+#ifdef USE_MMAP_READ
+	fd = blo_filedata_from_file_mmap(file);
+	if (fd != NULL) {
+		return fd;
+	}
+#endif
+	close(file);
+
+	/* Compressed files written without a seek table (or files which can't be mapped). */
 	gzFile gzfile;
 	errno = 0;
 	gzfile = BLI_gzopen(filepath, "rb");
 
-	if (gzfile == (gzFile)Z_NULL) {
+	if (gzfile != (gzFile)Z_NULL) {
+		fd = filedata_new();
+		fd->gzfiledes = gzfile;
+		fd->read = fd_read_gzip_from_file;
+		return fd;
+	}
+
+	return NULL;
+}
+
+/* cannot be called with relative paths anymore! */
+/* on each new library added, it now checks for the current FileData and expands relativeness */
+FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
+{
+	FileData *fd = blo_filedata_from_file_open(filepath);
+
+	if (fd == NULL) {
 		BKE_reportf(reports, RPT_WARNING, "Unable to open '%s': %s",
 		            filepath, errno ? strerror(errno) : TIP_("unknown error reading file"));
 		return NULL;
 	}
 	else {
-		FileData *fd = filedata_new();
-		fd->gzfiledes = gzfile;
-		fd->read = fd_read_gzip_from_file;
-
 		/* needed for library_append and read_libraries */
 		BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
 
@@ -1188,15 +1976,9 @@ FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
  */
 static FileData *blo_openblenderfile_minimal(const char *filepath)
 {
-	gzFile gzfile;
-	errno = 0;
-	gzfile = BLI_gzopen(filepath, "rb");
-
-	if (gzfile != (gzFile)Z_NULL) {
-		FileData *fd = filedata_new();
-		fd->gzfiledes = gzfile;
-		fd->read = fd_read_gzip_from_file;
+	FileData *fd = blo_filedata_from_file_open(filepath);
 
+	if (fd != NULL) {
 		decode_blender_header(fd);
 
 		if (fd->flags & FD_FLAGS_FILE_OK) {
@@ -1217,19 +1999,30 @@ static int fd_read_gzip_from_memory(FileData *filedata, void *buffer, unsigned i
 	filedata->strm.avail_out = size;
 
 	// Inflate another chunk.
-	err = inflate (&filedata->strm, Z_SYNC_FLUSH);
-
-	if (err == Z_STREAM_END) {
-		return 0;
-	}
-	else if (err != Z_OK) {
-		printf("fd_read_gzip_from_memory: zlib error\n");
-		return 0;
+	while (filedata->strm.avail_out != 0) {
+		err = inflate(&filedata->strm, Z_SYNC_FLUSH);
+
+		if (err == Z_STREAM_END) {
+			/* Compressed files may consist of multiple gzip members (see: BLEN_SEEKTABLE_MAGIC),
+			 * like `gzread`, ignore trailing data that isn't gzip. */
+			if ((filedata->strm.avail_in >= 2) &&
+			    (filedata->strm.next_in[0] == 0x1f && filedata->strm.next_in[1] == 0x8b))
+			{
+				inflateReset(&filedata->strm);
+				continue;
+			}
+			break;
+		}
+		else if (err != Z_OK) {
+			printf("fd_read_gzip_from_memory: zlib error\n");
+			return 0;
+		}
 	}
 
-	filedata->seek += size;
+	const int readsize = (int)(size - filedata->strm.avail_out);
+	filedata->seek += readsize;
 
-	return (size);
+	return (readsize);
 }
 
 static int fd_read_gzip_from_memory_init(FileData *fd)
@@ -1307,22 +2100,44 @@ void blo_freefiledata(FileData *fd)
 			gzclose(fd->gzfiledes);
 		}
 
+		if (fd->zlib_frames != NULL) {
+			zlib_frame_reader_free(fd->zlib_frames);
+		}
+
 		if (fd->strm.next_in) {
 			if (inflateEnd(&fd->strm) != Z_OK) {
 				printf("close gzip stream error\n");
 			}
 		}
 
-		if (fd->buffer && !(fd->flags & FD_FLAGS_NOT_MY_BUFFER)) {
-			MEM_freeN((void *)fd->buffer);
-			fd->buffer = NULL;
-		}
-
 		// Free all BHeadN data blocks
 		BLI_freelistN(&fd->listbase);
 
 		if (fd->filesdna)
 			DNA_sdna_free(fd->filesdna);
+
+		if (fd->library_index)
+			library_index_free(fd);
+
+		/* After freeing the SDNA, which may reference the mapping. */
+		if (fd->buffer && (fd->flags & FD_FLAGS_FILE_MMAP)) {
+#ifdef USE_MMAP_READ
+			if (munmap((void *)fd->buffer, (size_t)fd->buffersize) != 0) {
+				printf("%s: couldn't unmap file %s\n", __func__, fd->relabase);
+			}
+#endif
+			fd->buffer = NULL;
+		}
+		else if (fd->buffer && !(fd->flags & FD_FLAGS_NOT_MY_BUFFER)) {
+			MEM_freeN((void *)fd->buffer);
+			fd->buffer = NULL;
+		}
+		MEM_SAFE_FREE(fd->mmap_bheads);
+		if (fd->mmap_bhead_map) {
+			BLI_ghash_free(fd->mmap_bhead_map, NULL, NULL);
+			BLI_mempool_destroy(fd->mmap_bhead_pool);
+		}
+		MEM_SAFE_FREE(fd->memfile_chunk_buf);
 		if (fd->compflags)
 			MEM_freeN((void *)fd->compflags);
 
@@ -1945,6 +2760,7 @@ static void switch_endian_structs(const struct SDNA *filesdna, BHead *bhead)
 	int blocksize, nblocks;
 	char *data;
 
+	/* Never a mapped BHead, these are converted when reading (see: #fd_bhead_is_mapped). */
 	data = (char *)(bhead+1);
 	blocksize = filesdna->typelens[ filesdna->structs[bhead->SDNAnr][0] ];
 
@@ -1966,13 +2782,23 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
 			switch_endian_structs(fd->filesdna, bh);
 
 		if (fd->compflags[bh->SDNAnr] != SDNA_CMP_REMOVED) {
+			const void *data = blo_bhead_data(fd, bh);
 			if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
-				temp = DNA_struct_reconstruct(fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, (bh+1));
+				if (fd_bhead_is_mapped(fd)) {
+					/* Reconstruction reads members in place, mapped data is only 4 bytes aligned. */
+					void *data_aligned = MEM_mallocN(bh->len, __func__);
+					memcpy(data_aligned, data, bh->len);
+					temp = DNA_struct_reconstruct(fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, data_aligned);
+					MEM_freeN(data_aligned);
+				}
+				else {
+					temp = DNA_struct_reconstruct(fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, data);
+				}
 			}
 			else {
 				/* SDNA_CMP_EQUAL */
 				temp = MEM_mallocN(bh->len, blockname);
-				memcpy(temp, (bh+1), bh->len);
+				memcpy(temp, data, bh->len);
 			}
 		}
 	}
@@ -4693,7 +5519,7 @@ static void direct_link_customdata(FileData *fd, CustomData *data, int count)
 		if (layer->flag & CD_FLAG_EXTERNAL)
 			layer->flag &= ~CD_FLAG_IN_MEMORY;
 
-		layer->flag &= ~CD_FLAG_NOFREE;
+		layer->flag &= ~(CD_FLAG_NOFREE | CD_FLAG_SHARED);
 
 		if (CustomData_verify_versions(data, i)) {
 			layer->data = newdataadr(fd, layer->data);
@@ -9122,6 +9948,21 @@ static BHead *find_previous_lib(FileData *fd, BHead *bhead)
 	if (fd->memfile)
 		return NULL;
 
+	if (fd->library_index) {
+		const LibraryIndex *index = fd->library_index;
+		const BlendLibraryIndexEntry *entry = library_index_find_old(fd, bhead->old);
+
+		if (entry && (entry->lib >= 0) && ((uint)entry->lib < index->entries_num) &&
+		    (library_index_entry_bhead(fd, entry) == bhead))
+		{
+			BHead *bheadlib = library_index_entry_bhead(fd, &index->entries[entry->lib]);
+			if (bheadlib && (bheadlib->code == ID_LI) && (index->entries[entry->lib].offset < entry->offset)) {
+				return bheadlib;
+			}
+		}
+		library_index_discard(fd);
+	}
+
 	for (; bhead; bhead = blo_prevbhead(fd, bhead)) {
 		if (bhead->code == ID_LI)
 			break;
@@ -9140,6 +9981,18 @@ static BHead *find_bhead(FileData *fd, void *old)
 	if (!old)
 		return NULL;
 
+	if (fd->library_index) {
+		/* Only ID's are indexed, other blocks are found by the search below. */
+		const BlendLibraryIndexEntry *entry = library_index_find_old(fd, old);
+		if (entry) {
+			BHead *bhead = library_index_entry_bhead(fd, entry);
+			if (bhead) {
+				return bhead;
+			}
+			library_index_discard(fd);
+		}
+	}
+
 	if (fd->bheadmap == NULL)
 		sort_bhead_old_map(fd);
 
@@ -9168,7 +10021,7 @@ static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const
 	*((short *)idname_full) = idcode;
 	BLI_strncpy(idname_full + 2, name, sizeof(idname_full) - 2);
 
-	return BLI_ghash_lookup(fd->bhead_idname_hash, idname_full);
+	return library_index_idname_check(fd, BLI_ghash_lookup(fd->bhead_idname_hash, idname_full), idname_full);
 
 #else
 	BHead *bhead;
@@ -9192,7 +10045,7 @@ static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const
 static BHead *find_bhead_from_idname(FileData *fd, const char *idname)
 {
 #ifdef USE_GHASH_BHEAD
-	return BLI_ghash_lookup(fd->bhead_idname_hash, idname);
+	return library_index_idname_check(fd, BLI_ghash_lookup(fd->bhead_idname_hash, idname), idname);
 #else
 	return find_bhead_from_code_name(fd, GS(idname), idname + 2);
 #endif
@@ -10389,6 +11242,7 @@ static ID *link_named_part(
 		id = is_yet_read(fd, mainl, bhead);
 		if (id == NULL) {
 			/* not read yet */
+			library_index_prefetch(fd, bhead);
 			read_libblock(fd, mainl, bhead, force_indirect ? LIB_TAG_TESTIND : LIB_TAG_TESTEXT, &id);
 
 			if (id) {
@@ -10561,6 +11415,7 @@ static void link_id_part(ReportList *reports, FileData *fd, Main *mainvar, ID *i
 	if (bhead) {
 		id->tag |= LIB_TAG_NEED_EXPAND;
 		// printf("read lib block %s\n", id->name);
+		library_index_prefetch(fd, bhead);
 		read_libblock(fd, mainvar, bhead, id->tag, r_id);
 	}
 	else {
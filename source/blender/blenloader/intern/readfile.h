@@ -39,6 +39,8 @@
 #include "DNA_windowmanager_types.h"  /* for ReportType */
 
 struct OldNewMap;
+struct ZlibFrameReader;
+struct LibraryIndex;
 struct MemFile;
 struct ReportList;
 struct Object;
@@ -57,12 +59,25 @@ typedef struct FileData {
 
 	// variables needed for reading from memory / stream
 	const char *buffer;
+	// aligned copies of the BHead's of a memory mapped file (BHeadMapped), by offset in the file
+	struct GHash *mmap_bhead_map;
+	struct BLI_mempool *mmap_bhead_pool;
+	// BHead's of a memory mapped file in file order (see: blo_prevbhead), lazily initialized
+	struct BHead **mmap_bheads;
+	int mmap_bheads_len;
 	// variables needed for reading from memfile (undo)
 	struct MemFile *memfile;
+	// the last chunk read from the memfile, its data may be decompressed into memfile_chunk_buf
+	const void *memfile_chunk;
+	const char *memfile_chunk_data;
+	char *memfile_chunk_buf;
+	unsigned int memfile_chunk_buf_len;
 
 	// variables needed for reading from file
 	int filedes;
 	gzFile gzfiledes;
+	/* Compressed file with a seek table (see: BLEN_SEEKTABLE_MAGIC). */
+	struct ZlibFrameReader *zlib_frames;
 
 	// now only in use for library appending
 	char relabase[FILE_MAX];
@@ -100,6 +115,9 @@ typedef struct FileData {
 	/* see: USE_GHASH_BHEAD */
 	struct GHash *bhead_idname_hash;
 
+	/* Index of ID's stored after ENDB (see: BLEN_LIBRARY_INDEX_MAGIC), NULL when not used. */
+	struct LibraryIndex *library_index;
+
 	ListBase *mainlist;
 	ListBase *old_mainlist;  /* Used for undo. */
 
@@ -115,6 +133,12 @@ typedef struct BHeadN {
 	struct BHead bhead;
 } BHeadN;
 
+/* BHead of a memory mapped file, its data stays in the mapping (see: blo_bhead_data) */
+typedef struct BHeadMapped {
+	size_t offset;
+	struct BHead bhead;
+} BHeadMapped;
+
 /* FileData->flags */
 enum {
 	FD_FLAGS_SWITCH_ENDIAN         = 1 << 0,
@@ -123,6 +147,8 @@ enum {
 	FD_FLAGS_FILE_OK               = 1 << 3,
 	FD_FLAGS_NOT_MY_BUFFER         = 1 << 4,
 	FD_FLAGS_NOT_MY_LIBMAP         = 1 << 5,  /* XXX Unused in practice (checked once but never set). */
+	/** #FileData.buffer is a memory mapped file, BHead's are used directly from it when possible. */
+	FD_FLAGS_FILE_MMAP             = 1 << 6,
 };
 
 #define SIZEOFBLENDERHEADER 12
@@ -157,6 +183,7 @@ BHead *blo_firstbhead(FileData *fd);
 BHead *blo_nextbhead(FileData *fd, BHead *thisblock);
 BHead *blo_prevbhead(FileData *fd, BHead *thisblock);
 
+const void *blo_bhead_data(const FileData *fd, const BHead *bhead);
 const char *bhead_id_name(const FileData *fd, const BHead *bhead);
 
 /* do versions stuff */
@@ -49,6 +49,8 @@
 #include "DNA_listBase.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
 
 #include "BLO_undofile.h"
 #include "BLO_readfile.h"
@@ -60,40 +62,234 @@
 
 /* **************** support for memory-write, for undo buffers *************** */
 
+/* -------------------------------------------------------------------- */
+/** \name Chunk Storage
+ *
+ * Chunk contents are stored once (looked up by their hash) and shared by all undo steps using them,
+ * so unchanged data is de-duplicated even when it moved since the previous undo step.
+ *
+ * \note Only accessed when writing & freeing undo steps, from the main thread.
+ * \{ */
+
+/* Compress the stored contents with LZO, when it saves enough memory. */
+#ifdef WITH_LZO
+#  define USE_MEMFILE_COMPRESS
+#endif
+
+#ifdef USE_MEMFILE_COMPRESS
+#  ifdef WITH_SYSTEM_LZO
+#    include <lzo/lzo1x.h>
+#  else
+#    include "minilzo.h"
+#  endif
+#  define LZO_OUT_LEN(size)     ((size) + (size) / 16 + 64 + 3)
+/* Smaller chunks are not worth compressing. */
+#  define MEMFILE_COMPRESS_MIN_SIZE 1024
+#endif
+
+typedef struct MemFileBlob {
+	/** Contents, compressed when #MemFileBlob.size_compressed is set. */
+	char *buf;
+	unsigned int size;
+	unsigned int size_compressed;
+	unsigned int hash;
+	/** Number of #MemFileChunk's using this blob. */
+	unsigned int users;
+	/** The memfile which has this blob in its #MemFile.size, the oldest one still using it. */
+	MemFile *owner;
+} MemFileBlob;
+
+static struct {
+	/** All #MemFileBlob's in use, freed when empty. */
+	GSet *blobs;
+	/** Temporary buffers to decompress blobs for comparison. */
+	char *buf_tmp[2];
+	unsigned int buf_tmp_len[2];
+#ifdef USE_MEMFILE_COMPRESS
+	void *lzo_wrkmem;
+	unsigned char *buf_compress;
+	unsigned int buf_compress_len;
+#endif
+} g_memfile_store = {NULL};
+
+static char *memfile_store_buf_tmp(int index, unsigned int size)
+{
+	if (g_memfile_store.buf_tmp_len[index] < size) {
+		MEM_SAFE_FREE(g_memfile_store.buf_tmp[index]);
+		g_memfile_store.buf_tmp[index] = MEM_mallocN(size, __func__);
+		g_memfile_store.buf_tmp_len[index] = size;
+	}
+	return g_memfile_store.buf_tmp[index];
+}
+
+static const char *memfile_blob_data(const MemFileBlob *blob, char *buf_tmp)
+{
+#ifdef USE_MEMFILE_COMPRESS
+	if (blob->size_compressed) {
+		lzo_uint out_len = blob->size;
+		const int r = lzo1x_decompress_safe(
+		        (const unsigned char *)blob->buf, blob->size_compressed,
+		        (unsigned char *)buf_tmp, &out_len, NULL);
+		BLI_assert((r == LZO_E_OK) && (out_len == blob->size));
+		UNUSED_VARS_NDEBUG(r);
+		return buf_tmp;
+	}
+#else
+	UNUSED_VARS(buf_tmp);
+#endif
+	return blob->buf;
+}
+
+static unsigned int memfile_blob_hash(const void *key)
+{
+	const MemFileBlob *blob = key;
+	return blob->hash;
+}
+
+static bool memfile_blob_cmp(const void *a, const void *b)
+{
+	const MemFileBlob *blob_a = a, *blob_b = b;
+
+	if ((blob_a->hash != blob_b->hash) || (blob_a->size != blob_b->size)) {
+		return true;
+	}
+
+	const char *buf_a = blob_a->size_compressed ? memfile_store_buf_tmp(0, blob_a->size) : NULL;
+	const char *buf_b = blob_b->size_compressed ? memfile_store_buf_tmp(1, blob_b->size) : NULL;
+
+	return (memcmp(memfile_blob_data(blob_a, (char *)buf_a),
+	               memfile_blob_data(blob_b, (char *)buf_b),
+	               blob_a->size) != 0);
+}
+
+/**
+ * \return A new blob storing a copy of \a buf (with no users).
+ */
+static MemFileBlob *memfile_blob_new(const char *buf, unsigned int size, unsigned int hash)
+{
+	MemFileBlob *blob = MEM_mallocN(sizeof(*blob), "MemFileBlob");
+	blob->size = size;
+	blob->size_compressed = 0;
+	blob->hash = hash;
+	blob->users = 0;
+	blob->owner = NULL;
+
+#ifdef USE_MEMFILE_COMPRESS
+	if (size >= MEMFILE_COMPRESS_MIN_SIZE) {
+		const unsigned int out_len_max = LZO_OUT_LEN(size);
+		if (g_memfile_store.lzo_wrkmem == NULL) {
+			g_memfile_store.lzo_wrkmem = MEM_mallocN(LZO1X_MEM_COMPRESS, __func__);
+		}
+		if (g_memfile_store.buf_compress_len < out_len_max) {
+			MEM_SAFE_FREE(g_memfile_store.buf_compress);
+			g_memfile_store.buf_compress = MEM_mallocN(out_len_max, __func__);
+			g_memfile_store.buf_compress_len = out_len_max;
+		}
+
+		lzo_uint out_len = out_len_max;
+		const int r = lzo1x_1_compress(
+		        (const unsigned char *)buf, size, g_memfile_store.buf_compress, &out_len, g_memfile_store.lzo_wrkmem);
+
+		/* Only keep compressed contents when it saves at least 1/8th. */
+		if ((r == LZO_E_OK) && (out_len < size - (size / 8))) {
+			blob->size_compressed = (unsigned int)out_len;
+			blob->buf = MEM_mallocN(blob->size_compressed, "Chunk buffer");
+			memcpy(blob->buf, g_memfile_store.buf_compress, blob->size_compressed);
+			return blob;
+		}
+	}
+#endif
+
+	blob->buf = MEM_mallocN(size, "Chunk buffer");
+	memcpy(blob->buf, buf, size);
+	return blob;
+}
+
+static void memfile_store_free(void)
+{
+	BLI_gset_free(g_memfile_store.blobs, NULL);
+	g_memfile_store.blobs = NULL;
+
+	for (int i = 0; i < 2; i++) {
+		MEM_SAFE_FREE(g_memfile_store.buf_tmp[i]);
+		g_memfile_store.buf_tmp_len[i] = 0;
+	}
+#ifdef USE_MEMFILE_COMPRESS
+	MEM_SAFE_FREE(g_memfile_store.lzo_wrkmem);
+	MEM_SAFE_FREE(g_memfile_store.buf_compress);
+	g_memfile_store.buf_compress_len = 0;
+#endif
+}
+
+static void memfile_blob_user_remove(MemFileBlob *blob)
+{
+	BLI_assert(blob->users != 0);
+	if (--blob->users == 0) {
+		BLI_gset_remove(g_memfile_store.blobs, blob, NULL);
+		MEM_freeN(blob->buf);
+		MEM_freeN(blob);
+
+		/* Don't keep the store (and its buffers) around without undo steps. */
+		if (BLI_gset_len(g_memfile_store.blobs) == 0) {
+			memfile_store_free();
+		}
+	}
+}
+
+static size_t memfile_blob_size_stored(const MemFileBlob *blob)
+{
+	return blob->size_compressed ? blob->size_compressed : blob->size;
+}
+
+/**
+ * \return the contents of \a chunk, decompressed into \a buf_tmp (at least #MemFileChunk.size bytes)
+ * when it's stored compressed.
+ */
+const char *BLO_memfile_chunk_data(const MemFileChunk *chunk, char *buf_tmp)
+{
+	return memfile_blob_data(chunk->blob, buf_tmp);
+}
+
+/** \} */
+
 /* not memfile itself */
 void BLO_memfile_free(MemFile *memfile)
 {
 	MemFileChunk *chunk;
 
 	while ((chunk = BLI_pophead(&memfile->chunks))) {
-		if (chunk->is_identical == false) {
-			MEM_freeN((void *)chunk->buf);
-		}
+		memfile_blob_user_remove(chunk->blob);
 		MEM_freeN(chunk);
 	}
 	memfile->size = 0;
+
+	if (memfile->id_segments) {
+		BLI_ghash_free(memfile->id_segments, NULL, MEM_freeN);
+		memfile->id_segments = NULL;
+	}
 }
 
 /* to keep list of memfiles consistent, 'first' is always first in list */
 /* result is that 'first' is being freed */
 void BLO_memfile_merge(MemFile *first, MemFile *second)
 {
-	MemFileChunk *fc, *sc;
+	/* Contents are reference counted, those still used by 'second' (or later memfiles) are kept. */
+	BLO_memfile_free(first);
 
-	fc = first->chunks.first;
-	sc = second->chunks.first;
-	while (fc || sc) {
-		if (fc && sc) {
-			if (sc->is_identical) {
-				sc->is_identical = false;
-				fc->is_identical = true;
-			}
-		}
-		if (fc) fc = fc->next;
-		if (sc) sc = sc->next;
+	if (g_memfile_store.blobs == NULL) {
+		return;
 	}
 
-	BLO_memfile_free(first);
+	/* Contents 'first' accounted for are now used by later memfiles only,
+	 * 'second' is the oldest of them, so its size includes them from now on. */
+	GSetIterator gs_iter;
+	GSET_ITER (gs_iter, g_memfile_store.blobs) {
+		MemFileBlob *blob = BLI_gsetIterator_getKey(&gs_iter);
+		if (blob->owner == first) {
+			blob->owner = second;
+			second->size += memfile_blob_size_stored(blob);
+		}
+	}
 }
 
 void memfile_chunk_add(
@@ -102,31 +298,124 @@ void memfile_chunk_add(
 {
 	MemFileChunk *curchunk = MEM_mallocN(sizeof(MemFileChunk), "MemFileChunk");
 	curchunk->size = size;
-	curchunk->buf = NULL;
 	curchunk->is_identical = false;
 	BLI_addtail(&memfile->chunks, curchunk);
 
-	/* we compare compchunk with buf */
+	if (g_memfile_store.blobs == NULL) {
+		g_memfile_store.blobs = BLI_gset_new(memfile_blob_hash, memfile_blob_cmp, __func__);
+	}
+
+	/* Look up the contents by hash, not only at the same position as the previous undo step,
+	 * so data that moved (e.g. after adding an ID) is still shared. */
+	MemFileBlob blob_key = {
+		.buf = (char *)buf,
+		.size = size,
+		.hash = BLI_hash_mm2((const unsigned char *)buf, size, 0),
+	};
+	MemFileBlob *blob = BLI_gset_lookup(g_memfile_store.blobs, &blob_key);
+
+	if (blob == NULL) {
+		blob = memfile_blob_new(buf, size, blob_key.hash);
+		BLI_gset_insert(g_memfile_store.blobs, blob);
+		blob->owner = memfile;
+		memfile->size += memfile_blob_size_stored(blob);
+	}
+	blob->users++;
+	curchunk->blob = blob;
+
 	if (*compchunk_step != NULL) {
 		MemFileChunk *compchunk = *compchunk_step;
-		if (compchunk->size == curchunk->size) {
-			if (memcmp(compchunk->buf, buf, size) == 0) {
-				curchunk->buf = compchunk->buf;
-				curchunk->is_identical = true;
-			}
-		}
+		curchunk->is_identical = (compchunk->blob == blob);
 		*compchunk_step = compchunk->next;
 	}
+}
+
+/* -------------------------------------------------------------------- */
+/** \name ID Segments
+ *
+ * The chunks written for an ID, so an unchanged ID can reuse them in the next undo step
+ * without being written again.
+ * \{ */
+
+typedef struct MemFileSegment {
+	MemFileChunk *first;
+	unsigned int chunks_num;
+} MemFileSegment;
+
+/**
+ * Store that \a chunks_num chunks starting at \a first contain \a id.
+ */
+void memfile_segment_add(MemFile *memfile, const void *id, MemFileChunk *first, unsigned int chunks_num)
+{
+	if (memfile->id_segments == NULL) {
+		memfile->id_segments = BLI_ghash_ptr_new(__func__);
+	}
+
+	MemFileSegment *segment = MEM_mallocN(sizeof(*segment), __func__);
+	segment->first = first;
+	segment->chunks_num = chunks_num;
+	BLI_ghash_insert(memfile->id_segments, (void *)id, segment);
+}
+
+/**
+ * Check the chunks of \a segment contain exactly \a data.
+ */
+static bool memfile_segment_equals(const MemFileSegment *segment, const unsigned char *data, size_t data_len)
+{
+	const MemFileChunk *chunk = segment->first;
+	size_t offset = 0;
 
-	/* not equal... */
-	if (curchunk->buf == NULL) {
-		char *buf_new = MEM_mallocN(size, "Chunk buffer");
-		memcpy(buf_new, buf, size);
-		curchunk->buf = buf_new;
-		memfile->size += size;
+	for (unsigned int i = 0; i < segment->chunks_num; i++, chunk = chunk->next) {
+		if ((size_t)chunk->size > data_len - offset) {
+			return false;
+		}
+		char *buf_tmp = chunk->blob->size_compressed ? memfile_store_buf_tmp(0, chunk->size) : NULL;
+		if (memcmp(BLO_memfile_chunk_data(chunk, buf_tmp), &data[offset], chunk->size) != 0) {
+			return false;
+		}
+		offset += chunk->size;
 	}
+
+	return (offset == data_len);
 }
 
+/**
+ * Add the chunks \a compare stores for \a id to \a memfile, sharing their contents,
+ * when they contain exactly \a data (the ID as written now).
+ *
+ * \return false when \a compare has no chunks for \a id or the ID changed since.
+ */
+bool memfile_segment_reuse(
+        MemFile *memfile, const MemFile *compare, const void *id,
+        const unsigned char *data, size_t data_len)
+{
+	const MemFileSegment *segment = compare->id_segments ? BLI_ghash_lookup(compare->id_segments, id) : NULL;
+
+	if ((segment == NULL) || !memfile_segment_equals(segment, data, data_len)) {
+		return false;
+	}
+
+	MemFileChunk *chunk_first = NULL;
+	const MemFileChunk *chunk = segment->first;
+	for (unsigned int i = 0; i < segment->chunks_num; i++, chunk = chunk->next) {
+		MemFileChunk *curchunk = MEM_mallocN(sizeof(MemFileChunk), "MemFileChunk");
+		curchunk->blob = chunk->blob;
+		curchunk->size = chunk->size;
+		curchunk->is_identical = true;
+		curchunk->blob->users++;
+		BLI_addtail(&memfile->chunks, curchunk);
+
+		if (chunk_first == NULL) {
+			chunk_first = curchunk;
+		}
+	}
+
+	memfile_segment_add(memfile, id, chunk_first, segment->chunks_num);
+	return true;
+}
+
+/** \} */
+
 struct Main *BLO_memfile_main_get(struct MemFile *memfile, struct Main *oldmain, struct Scene **r_scene)
 {
 	struct Main *bmain_undo = NULL;
@@ -177,12 +466,21 @@ bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename)
 		return false;
 	}
 
+	char *buf_tmp = NULL;
+	unsigned int buf_tmp_len = 0;
+
 	for (chunk = memfile->chunks.first; chunk; chunk = chunk->next) {
-		if ((size_t)write(file, chunk->buf, chunk->size) != chunk->size) {
+		if (buf_tmp_len < chunk->size) {
+			MEM_SAFE_FREE(buf_tmp);
+			buf_tmp = MEM_mallocN(chunk->size, __func__);
+			buf_tmp_len = chunk->size;
+		}
+		if ((size_t)write(file, BLO_memfile_chunk_data(chunk, buf_tmp), chunk->size) != chunk->size) {
 			break;
 		}
 	}
 
+	MEM_SAFE_FREE(buf_tmp);
 	close(file);
 
 	if (chunk) {
@@ -157,8 +157,10 @@
 #include "MEM_guardedalloc.h" // MEM_freeN
 #include "BLI_bitmap.h"
 #include "BLI_blenlib.h"
+#include "BLI_endian_switch.h"
 #include "BLI_linklist.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 
 #include "BKE_action.h"
 #include "BKE_blender_version.h"
@@ -172,6 +174,7 @@
 #include "BKE_layer.h"
 #include "BKE_library.h" // for  set_listbasepointers
 #include "BKE_library_override.h"
+#include "BKE_library_query.h"
 #include "BKE_main.h"
 #include "BKE_node.h"
 #include "BKE_report.h"
@@ -207,8 +210,11 @@
 #define MYWRITE_BUFFER_SIZE (MEM_SIZE_OPTIMAL(1 << 17))  /* 128kb */
 #define MYWRITE_MAX_CHUNK   (MEM_SIZE_OPTIMAL(1 << 15))  /* ~32kb */
 
-/** Use if we want to store how many bytes have been written to the file. */
-// #define USE_WRITE_DATA_LEN
+/** Use if we want to store how many bytes have been written to the file (needed for the library index). */
+#define USE_WRITE_DATA_LEN
+
+/** Write each ID to its own memfile segment for undo (in parallel), reusing segments of unchanged ID's. */
+#define USE_MEMFILE_ID_SEGMENTS
 
 /* -------------------------------------------------------------------- */
 /** \name Internal Write Wrapper's (Abstracts Compression)
@@ -226,10 +232,13 @@ struct WriteWrap {
 	bool   (*close)(WriteWrap *ww);
 	size_t (*write)(WriteWrap *ww, const char *data, size_t data_len);
 
+	/* The library index is only read from uncompressed (memory mapped) files. */
+	bool use_library_index;
+
 	/* internal */
 	union {
 		int file_handle;
-		gzFile gz_handle;
+		struct ZlibFrameWrap *zlib_frames;
 	} _user_data;
 };
 
@@ -261,18 +270,220 @@ static size_t ww_write_none(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
-/* zlib */
+/* zlib (seekable frames) */
+
+/**
+ * Compressed files are written as a sequence of independent gzip members ("frames"),
+ * followed by a seek table, see #BLEN_SEEKTABLE_MAGIC.
+ *
+ * Concatenated gzip members are still a single valid gzip stream and the trailing seek table
+ * is ignored by `gzread`, so these files can be read by any version that reads compressed files.
+ *
+ * Frames are independent so they can be compressed (and decompressed) in parallel,
+ * #ZLIB_FRAME_BATCH frames are buffered and compressed at once before being written out.
+ */
+
+#define ZLIB_FRAME_SIZE MYWRITE_BUFFER_SIZE
+#define ZLIB_FRAME_BATCH 16
+/* Matches the "wb1" mode previously used with `gzopen`, favor speed over size. */
+#define ZLIB_FRAME_LEVEL 1
+
+typedef struct ZlibFrame {
+	uchar *buf_in;
+	uint   buf_in_len;
+	uchar *buf_out;
+	uint   buf_out_len;
+	bool   error;
+} ZlibFrame;
+
+typedef struct ZlibFrameWrap {
+	int file_handle;
+
+	ZlibFrame frames[ZLIB_FRAME_BATCH];
+	/** Number of frames in #ZlibFrameWrap.frames that are filled (the next one may be partially filled). */
+	int frames_used;
+
+	/** Pairs of (compressed, uncompressed) sizes for every frame written. */
+	uint *seek_table;
+	uint  seek_table_len;
+	uint  seek_table_alloc;
+
+	bool error;
+} ZlibFrameWrap;
+
 #define FILE_HANDLE(ww) \
-	(ww)->_user_data.gz_handle
+	(ww)->_user_data.zlib_frames
+
+static void ww_zlib_frame_compress_cb(
+        void *__restrict userdata,
+        const int iter,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	ZlibFrame *frame = &((ZlibFrame *)userdata)[iter];
+	z_stream strm = {NULL};
+
+	frame->error = true;
+
+	if (deflateInit2(&strm, ZLIB_FRAME_LEVEL, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		return;
+	}
+
+	const uint buf_out_size = (uint)deflateBound(&strm, frame->buf_in_len);
+	if (frame->buf_out == NULL) {
+		/* Frames are all the same size, allocate for the largest possible input. */
+		frame->buf_out = MEM_mallocN(MAX2(buf_out_size, (uint)deflateBound(&strm, ZLIB_FRAME_SIZE)), __func__);
+	}
+
+	strm.next_in = frame->buf_in;
+	strm.avail_in = frame->buf_in_len;
+	strm.next_out = frame->buf_out;
+	strm.avail_out = buf_out_size;
+
+	if (deflate(&strm, Z_FINISH) == Z_STREAM_END) {
+		frame->buf_out_len = (uint)strm.total_out;
+		frame->error = false;
+	}
+
+	deflateEnd(&strm);
+}
+
+/**
+ * Compress and write all frames currently in the batch.
+ */
+static bool ww_zlib_frames_flush(ZlibFrameWrap *zw)
+{
+	const int frames_num = (zw->frames_used < ZLIB_FRAME_BATCH && zw->frames[zw->frames_used].buf_in_len) ?
+	                       zw->frames_used + 1 : zw->frames_used;
+
+	if (frames_num == 0) {
+		return true;
+	}
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.use_threading = (frames_num > 1);
+	settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+	BLI_task_parallel_range(0, frames_num, zw->frames, ww_zlib_frame_compress_cb, &settings);
+
+	for (int i = 0; i < frames_num; i++) {
+		ZlibFrame *frame = &zw->frames[i];
+		if (frame->error ||
+		    (write(zw->file_handle, frame->buf_out, frame->buf_out_len) != frame->buf_out_len))
+		{
+			return false;
+		}
+
+		if (zw->seek_table_len + 2 > zw->seek_table_alloc) {
+			zw->seek_table_alloc = MAX2(zw->seek_table_alloc * 2, 2 * ZLIB_FRAME_BATCH);
+			zw->seek_table = MEM_reallocN(zw->seek_table, sizeof(*zw->seek_table) * zw->seek_table_alloc);
+		}
+		zw->seek_table[zw->seek_table_len++] = frame->buf_out_len;
+		zw->seek_table[zw->seek_table_len++] = frame->buf_in_len;
+
+		frame->buf_in_len = 0;
+	}
+
+	zw->frames_used = 0;
+	return true;
+}
+
+static uchar *ww_zlib_stored_block(uchar *p, const void *data, uint data_len, bool is_final)
+{
+	/* BFINAL bit, BTYPE of zero for stored (uncompressed) data. */
+	p[0] = is_final ? 1 : 0;
+	p[1] = (uchar)(data_len & 0xff);
+	p[2] = (uchar)((data_len >> 8) & 0xff);
+	p[3] = (uchar)(~data_len & 0xff);
+	p[4] = (uchar)((~data_len >> 8) & 0xff);
+	memcpy(p + 5, data, data_len);
+	return p + 5 + data_len;
+}
+
+static uchar *ww_zlib_uint32_le(uchar *p, uint value)
+{
+	p[0] = (uchar)(value & 0xff);
+	p[1] = (uchar)((value >> 8) & 0xff);
+	p[2] = (uchar)((value >> 16) & 0xff);
+	p[3] = (uchar)((value >> 24) & 0xff);
+	return p + 4;
+}
+
+/**
+ * Write the seek table as a final gzip member of stored (uncompressed) blocks,
+ * the footer gets a block of its own so it's located directly before the gzip trailer.
+ *
+ * The table is preceded by an invalid BHead, so readers which keep reading after #ENDB
+ * (rather than stopping at it) don't interpret the seek table as a block.
+ */
+static bool ww_zlib_seek_table_write(ZlibFrameWrap *zw)
+{
+	/* Stored blocks hold at most 64kb. */
+	const uint block_size_max = 0xffff;
+	const uint table_size = sizeof(*zw->seek_table) * zw->seek_table_len;
+	const uint table_blocks_num = (table_size + block_size_max - 1) / block_size_max;
+	/* Readers that continue reading BHead's after #ENDB stop at a negative length. */
+	const int terminator[2] = {ENDB, -1};
+	const uint member_size =
+	        10 +                                             /* gzip header */
+	        5 + sizeof(terminator) +                         /* terminator */
+	        (table_blocks_num * 5) + table_size +            /* seek table */
+	        5 + sizeof(BlendSeekTableFooter) +               /* footer */
+	        8;                                               /* gzip trailer */
+
+	BlendSeekTableFooter footer = {
+		.frames_num = zw->seek_table_len / 2,
+		.member_size = member_size,
+	};
+	memcpy(footer.magic, BLEN_SEEKTABLE_MAGIC, sizeof(footer.magic));
+
+	if (ENDIAN_ORDER == B_ENDIAN) {
+		if (zw->seek_table_len) {
+			BLI_endian_switch_uint32_array(zw->seek_table, zw->seek_table_len);
+		}
+		BLI_endian_switch_uint32(&footer.frames_num);
+		BLI_endian_switch_uint32(&footer.member_size);
+	}
+
+	uLong crc = crc32(0L, Z_NULL, 0);
+	crc = crc32(crc, (const Bytef *)terminator, sizeof(terminator));
+	crc = crc32(crc, (const Bytef *)zw->seek_table, table_size);
+	crc = crc32(crc, (const Bytef *)&footer, sizeof(footer));
+
+	/* Magic, deflate, no flags, no time-stamp, no extra flags, unknown OS. */
+	const uchar gzip_header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+	uchar *member = MEM_mallocN(member_size, __func__);
+	uchar *p = member;
+
+	memcpy(p, gzip_header, sizeof(gzip_header));
+	p += sizeof(gzip_header);
+	p = ww_zlib_stored_block(p, terminator, sizeof(terminator), false);
+	for (uint offset = 0; offset < table_size; offset += block_size_max) {
+		p = ww_zlib_stored_block(
+		        p, (const uchar *)zw->seek_table + offset, MIN2(block_size_max, table_size - offset), false);
+	}
+	p = ww_zlib_stored_block(p, &footer, sizeof(footer), true);
+	p = ww_zlib_uint32_le(p, (uint)crc);
+	p = ww_zlib_uint32_le(p, (uint)sizeof(terminator) + table_size + (uint)sizeof(footer));
+	BLI_assert(p == member + member_size);
+
+	const bool ok = (write(zw->file_handle, member, member_size) == member_size);
+	MEM_freeN(member);
+	return ok;
+}
 
 static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 {
-	gzFile file;
+	int file;
 
-	file = BLI_gzopen(filepath, "wb1");
+	file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
 
-	if (file != Z_NULL) {
-		FILE_HANDLE(ww) = file;
+	if (file != -1) {
+		ZlibFrameWrap *zw = MEM_callocN(sizeof(*zw), __func__);
+		zw->file_handle = file;
+		for (int i = 0; i < ZLIB_FRAME_BATCH; i++) {
+			zw->frames[i].buf_in = MEM_mallocN(ZLIB_FRAME_SIZE, __func__);
+		}
+		FILE_HANDLE(ww) = zw;
 		return true;
 	}
 	else {
@@ -281,11 +492,54 @@ static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 }
 static bool ww_close_zlib(WriteWrap *ww)
 {
-	return (gzclose(FILE_HANDLE(ww)) == Z_OK);
+	ZlibFrameWrap *zw = FILE_HANDLE(ww);
+	bool ok = (zw->error == false);
+
+	if (ok) {
+		ok = ww_zlib_frames_flush(zw) && ww_zlib_seek_table_write(zw);
+	}
+	if (close(zw->file_handle) == -1) {
+		ok = false;
+	}
+
+	for (int i = 0; i < ZLIB_FRAME_BATCH; i++) {
+		MEM_freeN(zw->frames[i].buf_in);
+		MEM_SAFE_FREE(zw->frames[i].buf_out);
+	}
+	MEM_SAFE_FREE(zw->seek_table);
+	MEM_freeN(zw);
+	FILE_HANDLE(ww) = NULL;
+
+	return ok;
 }
 static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 {
-	return gzwrite(FILE_HANDLE(ww), buf, buf_len);
+	ZlibFrameWrap *zw = FILE_HANDLE(ww);
+	size_t buf_offset = 0;
+
+	if (zw->error) {
+		return 0;
+	}
+
+	while (buf_offset < buf_len) {
+		ZlibFrame *frame = &zw->frames[zw->frames_used];
+		const uint len = (uint)MIN2(buf_len - buf_offset, (size_t)(ZLIB_FRAME_SIZE - frame->buf_in_len));
+
+		memcpy(frame->buf_in + frame->buf_in_len, buf + buf_offset, len);
+		frame->buf_in_len += len;
+		buf_offset += len;
+
+		if (frame->buf_in_len == ZLIB_FRAME_SIZE) {
+			if (++zw->frames_used == ZLIB_FRAME_BATCH) {
+				if (!ww_zlib_frames_flush(zw)) {
+					zw->error = true;
+					return 0;
+				}
+			}
+		}
+	}
+
+	return buf_len;
 }
 #undef FILE_HANDLE
 
@@ -308,6 +562,7 @@ static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
 			r_ww->open  = ww_open_none;
 			r_ww->close = ww_close_none;
 			r_ww->write = ww_write_none;
+			r_ww->use_library_index = true;
 			break;
 		}
 	}
@@ -344,6 +599,26 @@ typedef struct {
 	} mem;
 	/** When true, write to #WriteData.current, could also call 'is_undo'. */
 	bool use_memfile;
+	/**
+	 * When true, collect the data in #WriteData.segment instead of adding it to #WriteData.current
+	 * (used to write ID's for undo in parallel, see: #write_undo_id_segments).
+	 */
+	bool use_segment;
+	struct {
+		uchar *data;
+		size_t data_len, data_alloc;
+	} segment;
+
+	/** Write the library index, see #WriteWrap.use_library_index. */
+	bool use_library_index;
+	/** Library index, written after #ENDB (not used for undo), see: #BLEN_LIBRARY_INDEX_MAGIC. */
+	struct {
+		BlendLibraryIndexEntry *entries;
+		/** The ID of each entry, only valid while writing. */
+		ID **ids;
+		uint entries_len, entries_alloc;
+		size_t dna_offset, glob_offset;
+	} index;
 
 	/**
 	 * Wrap writing, so we can use zlib or
@@ -377,7 +652,15 @@ static void writedata_do_write(WriteData *wd, const void *mem, int memlen)
 	}
 
 	/* memory based save */
-	if (wd->use_memfile) {
+	if (wd->use_segment) {
+		if (wd->segment.data_len + (size_t)memlen > wd->segment.data_alloc) {
+			wd->segment.data_alloc = MAX2(wd->segment.data_alloc * 2, wd->segment.data_len + (size_t)memlen);
+			wd->segment.data = MEM_reallocN(wd->segment.data, wd->segment.data_alloc);
+		}
+		memcpy(&wd->segment.data[wd->segment.data_len], mem, (size_t)memlen);
+		wd->segment.data_len += (size_t)memlen;
+	}
+	else if (wd->use_memfile) {
 		memfile_chunk_add(wd->mem.current, mem, memlen, &wd->mem.compare_chunk);
 	}
 	else {
@@ -389,6 +672,9 @@ static void writedata_do_write(WriteData *wd, const void *mem, int memlen)
 
 static void writedata_free(WriteData *wd)
 {
+	MEM_SAFE_FREE(wd->index.entries);
+	MEM_SAFE_FREE(wd->index.ids);
+	MEM_SAFE_FREE(wd->segment.data);
 	MEM_freeN(wd->buf);
 	MEM_freeN(wd);
 }
@@ -477,6 +763,9 @@ static WriteData *mywrite_begin(WriteWrap *ww, MemFile *compare, MemFile *curren
 		wd->mem.compare_chunk = compare ? compare->chunks.first : NULL;
 		wd->use_memfile = true;
 	}
+	else if (ww != NULL) {
+		wd->use_library_index = ww->use_library_index;
+	}
 
 	return wd;
 }
@@ -502,6 +791,150 @@ static bool mywrite_end(WriteData *wd)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Library Index
+ *
+ * Records where each ID is written and which ID's it uses,
+ * so linking doesn't need to scan the whole file, see: #BLEN_LIBRARY_INDEX_MAGIC.
+ * \{ */
+
+/**
+ * Add an entry for \a id, written starting at \a offset (nothing is added when the ID wasn't written).
+ */
+static void write_library_index_add(WriteData *wd, ID *id, int lib, size_t offset)
+{
+	if (!wd->use_library_index || (wd->write_len == offset)) {
+		return;
+	}
+
+	if (wd->index.entries_len == wd->index.entries_alloc) {
+		wd->index.entries_alloc = wd->index.entries_alloc ? wd->index.entries_alloc * 2 : 256;
+		wd->index.entries = MEM_reallocN(wd->index.entries, sizeof(*wd->index.entries) * wd->index.entries_alloc);
+		wd->index.ids = MEM_reallocN(wd->index.ids, sizeof(*wd->index.ids) * wd->index.entries_alloc);
+	}
+
+	BlendLibraryIndexEntry *entry = &wd->index.entries[wd->index.entries_len];
+	memset(entry, 0, sizeof(*entry));
+	entry->offset = offset;
+	entry->size = wd->write_len - offset;
+	entry->old = (uint64_t)(uintptr_t)id;
+	entry->lib = lib;
+	entry->idcode = GS(id->name);
+	BLI_strncpy(entry->name, id->name, sizeof(entry->name));
+
+	wd->index.ids[wd->index.entries_len++] = id;
+}
+
+typedef struct LibraryIndexDepsData {
+	/** ID pointer to entry index. */
+	GHash *id_map;
+	uint *deps;
+	uint deps_len, deps_alloc;
+} LibraryIndexDepsData;
+
+static int write_library_index_deps_cb(void *user_data, ID *id_self, ID **id_pointer, int cb_flag)
+{
+	LibraryIndexDepsData *data = user_data;
+	ID *id = *id_pointer;
+
+	if ((id == NULL) || (id == id_self) || (cb_flag & IDWALK_CB_LOOPBACK)) {
+		return IDWALK_RET_NOP;
+	}
+
+	void **entry_index_p = BLI_ghash_lookup_p(data->id_map, id);
+	if (entry_index_p) {
+		if (data->deps_len == data->deps_alloc) {
+			data->deps_alloc = data->deps_alloc ? data->deps_alloc * 2 : 1024;
+			data->deps = MEM_reallocN(data->deps, sizeof(*data->deps) * data->deps_alloc);
+		}
+		data->deps[data->deps_len++] = GET_UINT_FROM_POINTER(*entry_index_p);
+	}
+
+	return IDWALK_RET_NOP;
+}
+
+static int uint_cmp(const void *a, const void *b)
+{
+	const uint ua = *(const uint *)a, ub = *(const uint *)b;
+	return (ua < ub) ? -1 : ((ua > ub) ? 1 : 0);
+}
+
+/**
+ * Write the index (after #ENDB), must be called before the main is joined again.
+ */
+static void write_library_index(WriteData *wd, Main *mainvar)
+{
+	static const char pad[8] = {0};
+	const uint entries_len = wd->index.entries_len;
+	LibraryIndexDepsData data = {NULL};
+	BlendLibraryIndexFooter footer;
+	uint i;
+
+	data.id_map = BLI_ghash_ptr_new_ex(__func__, entries_len);
+	for (i = 0; i < entries_len; i++) {
+		BLI_ghash_insert(data.id_map, wd->index.ids[i], SET_UINT_IN_POINTER(i));
+	}
+
+	for (i = 0; i < entries_len; i++) {
+		BlendLibraryIndexEntry *entry = &wd->index.entries[i];
+		const uint deps_start = data.deps_len;
+
+		/* Linked (#ID_ID) entries and libraries have no dependencies in this file. */
+		if ((entry->lib == -1) && (entry->idcode != ID_LI)) {
+			BKE_library_foreach_ID_link(mainvar, wd->index.ids[i], write_library_index_deps_cb, &data, IDWALK_READONLY);
+		}
+
+		/* Remove duplicates. */
+		uint deps_num = data.deps_len - deps_start;
+		if (deps_num > 1) {
+			uint *deps = &data.deps[deps_start];
+			uint j, k;
+			qsort(deps, deps_num, sizeof(*deps), uint_cmp);
+			for (j = 1, k = 1; j < deps_num; j++) {
+				if (deps[j] != deps[k - 1]) {
+					deps[k++] = deps[j];
+				}
+			}
+			deps_num = k;
+			data.deps_len = deps_start + deps_num;
+		}
+
+		entry->deps_start = deps_start;
+		entry->deps_num = deps_num;
+	}
+
+	BLI_ghash_free(data.id_map, NULL, NULL);
+
+	/* Readers that continue reading BHead's after #ENDB stop at a negative length. */
+	const int terminator[2] = {ENDB, -1};
+	mywrite(wd, terminator, sizeof(terminator));
+	if (wd->write_len % 8) {
+		mywrite(wd, pad, (int)(8 - wd->write_len % 8));
+	}
+
+	memset(&footer, 0, sizeof(footer));
+	footer.index_offset = wd->write_len;
+	footer.dna_offset = wd->index.dna_offset;
+	footer.glob_offset = wd->index.glob_offset;
+	footer.entries_num = entries_len;
+	footer.deps_num = data.deps_len;
+	memcpy(footer.magic, BLEN_LIBRARY_INDEX_MAGIC, sizeof(footer.magic));
+
+	if (entries_len) {
+		mywrite(wd, wd->index.entries, (int)(sizeof(*wd->index.entries) * entries_len));
+	}
+	if (data.deps_len) {
+		mywrite(wd, data.deps, (int)(sizeof(*data.deps) * data.deps_len));
+		MEM_freeN(data.deps);
+	}
+	if (wd->write_len % 8) {
+		mywrite(wd, pad, (int)(8 - wd->write_len % 8));
+	}
+	mywrite(wd, &footer, sizeof(footer));
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Generic DNA File Writing
  * \{ */
@@ -3713,6 +4146,7 @@ static void write_libraries(WriteData *wd, Main *main)
 		if (found_one) {
 			/* Not overridable. */
 
+			const size_t lib_offset = wd->write_len;
 			writestruct(wd, ID_LI, Library, 1, main->curlib);
 			write_iddata(wd, &main->curlib->id);
 
@@ -3725,6 +4159,9 @@ static void write_libraries(WriteData *wd, Main *main)
 				}
 			}
 
+			write_library_index_add(wd, &main->curlib->id, -1, lib_offset);
+			const int lib_index = (int)wd->index.entries_len - 1;
+
 			while (a--) {
 				for (id = lbarray[a]->first; id; id = id->next) {
 					if (id->us > 0 && (id->tag & LIB_TAG_EXTERN)) {
@@ -3733,7 +4170,9 @@ static void write_libraries(WriteData *wd, Main *main)
 							       "but is flagged as directly linked", id->name, main->curlib->filepath);
 							BLI_assert(0);
 						}
+						const size_t offset = wd->write_len;
 						writestruct(wd, ID_ID, ID, 1, id);
+						write_library_index_add(wd, id, lib_index, offset);
 					}
 				}
 			}
@@ -3743,6 +4182,246 @@ static void write_libraries(WriteData *wd, Main *main)
 	mywrite_flush(wd);
 }
 
+/* Write an ID (other than libraries) and its data. */
+static void write_id(WriteData *wd, ID *id)
+{
+	switch ((ID_Type)GS(id->name)) {
+		case ID_WM:
+			write_windowmanager(wd, (wmWindowManager *)id);
+			break;
+		case ID_WS:
+			write_workspace(wd, (WorkSpace *)id);
+			break;
+		case ID_SCR:
+			write_screen(wd, (bScreen *)id);
+			break;
+		case ID_MC:
+			write_movieclip(wd, (MovieClip *)id);
+			break;
+		case ID_MSK:
+			write_mask(wd, (Mask *)id);
+			break;
+		case ID_SCE:
+			write_scene(wd, (Scene *)id);
+			break;
+		case ID_CU:
+			write_curve(wd, (Curve *)id);
+			break;
+		case ID_MB:
+			write_mball(wd, (MetaBall *)id);
+			break;
+		case ID_IM:
+			write_image(wd, (Image *)id);
+			break;
+		case ID_CA:
+			write_camera(wd, (Camera *)id);
+			break;
+		case ID_LA:
+			write_lamp(wd, (Lamp *)id);
+			break;
+		case ID_LT:
+			write_lattice(wd, (Lattice *)id);
+			break;
+		case ID_VF:
+			write_vfont(wd, (VFont *)id);
+			break;
+		case ID_KE:
+			write_key(wd, (Key *)id);
+			break;
+		case ID_WO:
+			write_world(wd, (World *)id);
+			break;
+		case ID_TXT:
+			write_text(wd, (Text *)id);
+			break;
+		case ID_SPK:
+			write_speaker(wd, (Speaker *)id);
+			break;
+		case ID_LP:
+			write_probe(wd, (LightProbe *)id);
+			break;
+		case ID_SO:
+			write_sound(wd, (bSound *)id);
+			break;
+		case ID_GR:
+			write_collection(wd, (Collection *)id);
+			break;
+		case ID_AR:
+			write_armature(wd, (bArmature *)id);
+			break;
+		case ID_AC:
+			write_action(wd, (bAction *)id);
+			break;
+		case ID_OB:
+			write_object(wd, (Object *)id);
+			break;
+		case ID_MA:
+			write_material(wd, (Material *)id);
+			break;
+		case ID_TE:
+			write_texture(wd, (Tex *)id);
+			break;
+		case ID_ME:
+			write_mesh(wd, (Mesh *)id);
+			break;
+		case ID_PA:
+			write_particlesettings(wd, (ParticleSettings *)id);
+			break;
+		case ID_NT:
+			write_nodetree(wd, (bNodeTree *)id);
+			break;
+		case ID_BR:
+			write_brush(wd, (Brush *)id);
+			break;
+		case ID_PAL:
+			write_palette(wd, (Palette *)id);
+			break;
+		case ID_PC:
+			write_paintcurve(wd, (PaintCurve *)id);
+			break;
+		case ID_GD:
+			write_gpencil(wd, (bGPdata *)id);
+			break;
+		case ID_LS:
+			write_linestyle(wd, (FreestyleLineStyle *)id);
+			break;
+		case ID_CF:
+			write_cachefile(wd, (CacheFile *)id);
+			break;
+		case ID_LI:
+			/* Do nothing, handled separately - and should never be reached. */
+			BLI_assert(0);
+			break;
+		case ID_IP:
+			/* Do nothing, deprecated. */
+			break;
+		default:
+			/* Should never be reached. */
+			BLI_assert(0);
+			break;
+	}
+}
+
+#ifdef USE_MEMFILE_ID_SEGMENTS
+/* -------------------------------------------------------------------- */
+/** \name Undo ID Segments
+ *
+ * For undo, each ID is written to its own segment of the memfile, in parallel.
+ * ID's written exactly as in the previous undo step reuse its segment.
+ * \{ */
+
+typedef struct UndoIDSegment {
+	ID *id;
+	/** Written data. */
+	uchar *data;
+	size_t data_len;
+} UndoIDSegment;
+
+/* UI data is written from the main thread only. */
+static bool write_undo_id_use_threading(const ID *id)
+{
+	return !ELEM(GS(id->name), ID_WM, ID_WS, ID_SCR);
+}
+
+static void write_undo_id_segment(UndoIDSegment *segment)
+{
+	WriteData *wd = writedata_new(NULL);
+	wd->use_memfile = true;
+	wd->use_segment = true;
+
+	write_id(wd, segment->id);
+	mywrite_flush(wd);
+
+	segment->data = wd->segment.data;
+	segment->data_len = wd->segment.data_len;
+	wd->segment.data = NULL;
+	writedata_free(wd);
+}
+
+static void write_undo_id_segment_cb(
+        void *__restrict userdata,
+        const int index,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	UndoIDSegment *segment = &((UndoIDSegment *)userdata)[index];
+
+	if (write_undo_id_use_threading(segment->id)) {
+		write_undo_id_segment(segment);
+	}
+}
+
+/**
+ * Write all local ID's to \a current, in the same order as #write_file_handle writes them to files.
+ */
+static void write_undo_id_segments(WriteData *wd, Main *mainvar, MemFile *compare, MemFile *current)
+{
+	ListBase *lbarray[MAX_LIBARRAY];
+	int a, segments_len = 0;
+	ID *id;
+
+	a = set_listbasepointers(mainvar, lbarray);
+	while (a--) {
+		segments_len += BLI_listbase_count(lbarray[a]);
+	}
+
+	UndoIDSegment *segments = MEM_calloc_arrayN(MAX2(segments_len, 1), sizeof(*segments), __func__);
+	UndoIDSegment *segment = segments;
+
+	a = set_listbasepointers(mainvar, lbarray);
+	while (a--) {
+		id = lbarray[a]->first;
+		if (id && GS(id->name) == ID_LI) {
+			continue;  /* Libraries are handled separately. */
+		}
+		for (; id; id = id->next, segment++) {
+			segment->id = id;
+		}
+	}
+	segments_len = (int)(segment - segments);
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+	settings.use_threading = (segments_len > 1);
+	BLI_task_parallel_range(0, segments_len, segments, write_undo_id_segment_cb, &settings);
+
+	/* Data written so far is not part of any segment. */
+	mywrite_flush(wd);
+
+	for (int i = 0; i < segments_len; i++) {
+		segment = &segments[i];
+		id = segment->id;
+
+		if (segment->data == NULL) {
+			/* Written from the main thread. */
+			write_undo_id_segment(segment);
+		}
+
+		/* Only reuse the previous undo step's chunks when the ID didn't change at all,
+		 * edits aren't reliably tagged (in-place edits from Python, operators, drivers...). */
+		if (compare && memfile_segment_reuse(current, compare, id, segment->data, segment->data_len)) {
+			MEM_SAFE_FREE(segment->data);
+			continue;
+		}
+
+		MemFileChunk *chunk_last = current->chunks.last;
+		uint chunks_num = 0;
+		for (size_t offset = 0; offset < segment->data_len; offset += MYWRITE_BUFFER_SIZE, chunks_num++) {
+			MemFileChunk *compchunk_step = NULL;
+			const uint len = (uint)MIN2((size_t)MYWRITE_BUFFER_SIZE, segment->data_len - offset);
+			memfile_chunk_add(current, (const char *)&segment->data[offset], len, &compchunk_step);
+		}
+		memfile_segment_add(current, id, chunk_last ? chunk_last->next : current->chunks.first, chunks_num);
+
+		MEM_SAFE_FREE(segment->data);
+	}
+
+	MEM_freeN(segments);
+}
+
+/** \} */
+#endif  /* USE_MEMFILE_ID_SEGMENTS */
+
 /* context is usually defined by WM, two cases where no WM is available:
  * - for forward compatibility, curscreen has to be saved
  * - for undofile, curscene needs to be saved */
@@ -3844,6 +4523,7 @@ static bool write_file_handle(
 
 	write_renderinfo(wd, mainvar);
 	write_thumb(wd, thumb);
+	wd->index.glob_offset = wd->write_len;
 	write_global(wd, write_flags, mainvar);
 
 	/* The windowmanager and screen often change,
@@ -3852,153 +4532,57 @@ static bool write_file_handle(
 
 	OverrideStaticStorage *override_storage = wd->use_memfile ? NULL : BKE_override_static_operations_store_initialize();
 
-	/* This outer loop allows to save first datablocks from real mainvar, then the temp ones from override process,
-	 * if needed, without duplicating whole code. */
-	Main *bmain = mainvar;
-	do {
-		ListBase *lbarray[MAX_LIBARRAY];
-		int a = set_listbasepointers(bmain, lbarray);
-		while (a--) {
-			ID *id = lbarray[a]->first;
-
-			if (id && GS(id->name) == ID_LI) {
-				continue;  /* Libraries are handled separately below. */
-			}
+#ifdef USE_MEMFILE_ID_SEGMENTS
+	if (wd->use_memfile) {
+		write_undo_id_segments(wd, mainvar, compare, current);
+	}
+	else
+#endif
+	{
+		/* This outer loop allows to save first datablocks from real mainvar, then the temp ones from override process,
+		 * if needed, without duplicating whole code. */
+		Main *bmain = mainvar;
+		do {
+			ListBase *lbarray[MAX_LIBARRAY];
+			int a = set_listbasepointers(bmain, lbarray);
+			while (a--) {
+				ID *id = lbarray[a]->first;
 
-			for (; id; id = id->next) {
-				/* We should never attempt to write non-regular IDs (i.e. all kind of temp/runtime ones). */
-				BLI_assert((id->tag & (LIB_TAG_NO_MAIN | LIB_TAG_NO_USER_REFCOUNT | LIB_TAG_NOT_ALLOCATED)) == 0);
+				if (id && GS(id->name) == ID_LI) {
+					continue;  /* Libraries are handled separately below. */
+				}
 
-				const bool do_override = !ELEM(override_storage, NULL, bmain) && id->override_static;
+				for (; id; id = id->next) {
+					/* We should never attempt to write non-regular IDs (i.e. all kind of temp/runtime ones). */
+					BLI_assert((id->tag & (LIB_TAG_NO_MAIN | LIB_TAG_NO_USER_REFCOUNT | LIB_TAG_NOT_ALLOCATED)) == 0);
 
-				if (do_override) {
-					BKE_override_static_operations_store_start(bmain, override_storage, id);
-				}
+					const bool do_override = !ELEM(override_storage, NULL, bmain) && id->override_static;
 
-				switch ((ID_Type)GS(id->name)) {
-					case ID_WM:
-						write_windowmanager(wd, (wmWindowManager *)id);
-						break;
-					case ID_WS:
-						write_workspace(wd, (WorkSpace *)id);
-						break;
-					case ID_SCR:
-						write_screen(wd, (bScreen *)id);
-						break;
-					case ID_MC:
-						write_movieclip(wd, (MovieClip *)id);
-						break;
-					case ID_MSK:
-						write_mask(wd, (Mask *)id);
-						break;
-					case ID_SCE:
-						write_scene(wd, (Scene *)id);
-						break;
-					case ID_CU:
-						write_curve(wd, (Curve *)id);
-						break;
-					case ID_MB:
-						write_mball(wd, (MetaBall *)id);
-						break;
-					case ID_IM:
-						write_image(wd, (Image *)id);
-						break;
-					case ID_CA:
-						write_camera(wd, (Camera *)id);
-						break;
-					case ID_LA:
-						write_lamp(wd, (Lamp *)id);
-						break;
-					case ID_LT:
-						write_lattice(wd, (Lattice *)id);
-						break;
-					case ID_VF:
-						write_vfont(wd, (VFont *)id);
-						break;
-					case ID_KE:
-						write_key(wd, (Key *)id);
-						break;
-					case ID_WO:
-						write_world(wd, (World *)id);
-						break;
-					case ID_TXT:
-						write_text(wd, (Text *)id);
-						break;
-					case ID_SPK:
-						write_speaker(wd, (Speaker *)id);
-						break;
-					case ID_LP:
-						write_probe(wd, (LightProbe *)id);
-						break;
-					case ID_SO:
-						write_sound(wd, (bSound *)id);
-						break;
-					case ID_GR:
-						write_collection(wd, (Collection *)id);
-						break;
-					case ID_AR:
-						write_armature(wd, (bArmature *)id);
-						break;
-					case ID_AC:
-						write_action(wd, (bAction *)id);
-						break;
-					case ID_OB:
-						write_object(wd, (Object *)id);
-						break;
-					case ID_MA:
-						write_material(wd, (Material *)id);
-						break;
-					case ID_TE:
-						write_texture(wd, (Tex *)id);
-						break;
-					case ID_ME:
-						write_mesh(wd, (Mesh *)id);
-						break;
-					case ID_PA:
-						write_particlesettings(wd, (ParticleSettings *)id);
-						break;
-					case ID_NT:
-						write_nodetree(wd, (bNodeTree *)id);
-						break;
-					case ID_BR:
-						write_brush(wd, (Brush *)id);
-						break;
-					case ID_PAL:
-						write_palette(wd, (Palette *)id);
-						break;
-					case ID_PC:
-						write_paintcurve(wd, (PaintCurve *)id);
-						break;
-					case ID_GD:
-						write_gpencil(wd, (bGPdata *)id);
-						break;
-					case ID_LS:
-						write_linestyle(wd, (FreestyleLineStyle *)id);
-						break;
-					case ID_CF:
-						write_cachefile(wd, (CacheFile *)id);
-						break;
-					case ID_LI:
-						/* Do nothing, handled below - and should never be reached. */
-						BLI_assert(0);
-						break;
-					case ID_IP:
-						/* Do nothing, deprecated. */
-						break;
-					default:
-						/* Should never be reached. */
-						BLI_assert(0);
-						break;
-				}
+					if (do_override) {
+						BKE_override_static_operations_store_start(bmain, override_storage, id);
+					}
+
+					const size_t offset = wd->write_len;
+
+					write_id(wd, id);
+
+					write_library_index_add(wd, id, -1, offset);
 
-				if (do_override) {
-					BKE_override_static_operations_store_end(override_storage, id);
+					if (wd->use_memfile) {
+						/* Start a new chunk for each ID, so its chunks don't depend on the size of ID's before it
+						 * (and can be shared with the previous undo step when it didn't change). */
+						mywrite_flush(wd);
+					}
+
+					if (do_override) {
+						BKE_override_static_operations_store_end(override_storage, id);
+					}
 				}
-			}
 
-			mywrite_flush(wd);
-		}
-	} while ((bmain != override_storage) && (bmain = override_storage));
+				mywrite_flush(wd);
+			}
+		} while ((bmain != override_storage) && (bmain = override_storage));
+	}
 
 	if (override_storage) {
 		BKE_override_static_operations_store_finalize(override_storage);
@@ -4019,6 +4603,7 @@ static bool write_file_handle(
 	 *
 	 * Note that we *borrow* the pointer to 'DNAstr',
 	 * so writing each time uses the same address and doesn't cause unnecessary undo overhead. */
+	wd->index.dna_offset = wd->write_len;
 	writedata(wd, DNA1, wd->sdna->datalen, wd->sdna->data);
 
 #ifdef USE_NODE_COMPAT_CUSTOMNODES
@@ -4037,6 +4622,10 @@ static bool write_file_handle(
 	bhead.code = ENDB;
 	mywrite(wd, &bhead, sizeof(BHead));
 
+	if (wd->use_library_index) {
+		write_library_index(wd, mainvar);
+	}
+
 	blo_join_main(&mainlist);
 
 	return mywrite_end(wd);
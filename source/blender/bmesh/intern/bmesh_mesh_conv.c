@@ -938,7 +938,7 @@ void BM_mesh_bm_to_me(
 		if (ofs) MEM_freeN(ofs);
 	}
 
-	if (oldverts) MEM_freeN(oldverts);
+	if (oldverts) CustomData_free_layer_data(CD_MVERT, oldverts, ototvert);
 
 	/* topology could be changed, ensure mdisps are ok */
 	multires_topology_changed(me);
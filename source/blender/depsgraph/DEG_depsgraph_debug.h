@@ -72,6 +72,23 @@ void DEG_debug_stats_gnuplot(const struct Depsgraph *graph,
                              const char *label,
                              const char *output_filename);
 
+/* ************************************************ */
+/* Evaluation Timeline */
+
+/* Record start/end time and thread of every evaluated operation, until
+ * recording is ended. Restarts recording when already recording.
+ */
+void DEG_debug_timeline_begin(struct Depsgraph *graph);
+void DEG_debug_timeline_end(struct Depsgraph *graph);
+
+/* Write timeline recorded so far as Chrome trace event JSON. */
+void DEG_debug_timeline_trace_json(const struct Depsgraph *graph, FILE *stream);
+
+/* Record all graphs, the trace is written to the file on exit
+ * (see DEG_free_node_types()).
+ */
+void DEG_debug_timeline_trace_file_set(const char *filepath);
+
 /* ************************************************ */
 
 /* Compare two dependency graphs. */
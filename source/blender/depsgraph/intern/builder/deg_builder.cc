@@ -35,6 +35,7 @@
 #include "DNA_ID.h"
 
 #include "BLI_stack.h"
+#include "BLI_task.h"
 
 extern "C" {
 #include "BKE_animsys.h"
@@ -110,40 +111,79 @@ void deg_graph_build_flush_visibility(Depsgraph *graph)
 	BLI_stack_free(stack);
 }
 
+void deg_graph_build_finalize_id_node_func(
+        void *__restrict data_v,
+        const int i,
+        const ParallelRangeTLS *__restrict /*tls*/)
+{
+	Depsgraph *graph = (Depsgraph *)data_v;
+	IDDepsNode *id_node = graph->id_nodes[i];
+	id_node->finalize_build(graph);
+}
+
+void deg_graph_build_tag_id_node(Main *bmain,
+                                 Depsgraph *graph,
+                                 IDDepsNode *id_node)
+{
+	ID *id = id_node->id_orig;
+	int flag = 0;
+	if ((id->recalc & ID_RECALC_ALL)) {
+		AnimData *adt = BKE_animdata_from_id(id);
+		if (adt != NULL && (adt->recalc & ADT_RECALC_ANIM) != 0) {
+			flag |= DEG_TAG_TIME;
+		}
+	}
+	if (!deg_copy_on_write_is_expanded(id_node->id_cow)) {
+		flag |= DEG_TAG_COPY_ON_WRITE;
+		/* This means ID is being added to the dependency graph first
+		 * time, which is similar to "ob-visible-change"
+		 */
+		if (GS(id->name) == ID_OB) {
+			flag |= OB_RECALC_OB | OB_RECALC_DATA;
+		}
+	}
+	if (flag != 0) {
+		DEG_graph_id_tag_update(bmain,
+		                        (::Depsgraph *)graph,
+		                        id_node->id_orig,
+		                        flag);
+	}
+}
+
 }  // namespace
 
 void deg_graph_build_finalize(Main *bmain, Depsgraph *graph)
 {
 	/* Make sure dependencies of visible ID datablocks are visible. */
 	deg_graph_build_flush_visibility(graph);
+	/* Finalizing only touches components of the ID node itself. */
+	const int num_id_nodes = graph->id_nodes.size();
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.min_iter_per_thread = 1024;
+	BLI_task_parallel_range(0, num_id_nodes,
+	                        graph,
+	                        deg_graph_build_finalize_id_node_func,
+	                        &settings);
 	/* Re-tag IDs for update if it was tagged before the relations
 	 * update tag.
 	 */
 	foreach (IDDepsNode *id_node, graph->id_nodes) {
-		ID *id = id_node->id_orig;
+		deg_graph_build_tag_id_node(bmain, graph, id_node);
+	}
+}
+
+void deg_graph_build_finalize_ids(Main *bmain,
+                                  Depsgraph *graph,
+                                  const vector<IDDepsNode *>& id_nodes)
+{
+	/* Re-built IDs might have new dependencies, visibility is flushed over
+	 * the whole graph, which is cheap compared to building it.
+	 */
+	deg_graph_build_flush_visibility(graph);
+	foreach (IDDepsNode *id_node, id_nodes) {
 		id_node->finalize_build(graph);
-		int flag = 0;
-		if ((id->recalc & ID_RECALC_ALL)) {
-			AnimData *adt = BKE_animdata_from_id(id);
-			if (adt != NULL && (adt->recalc & ADT_RECALC_ANIM) != 0) {
-				flag |= DEG_TAG_TIME;
-			}
-		}
-		if (!deg_copy_on_write_is_expanded(id_node->id_cow)) {
-			flag |= DEG_TAG_COPY_ON_WRITE;
-			/* This means ID is being added to the dependency graph first
-			 * time, which is similar to "ob-visible-change"
-			 */
-			if (GS(id->name) == ID_OB) {
-				flag |= OB_RECALC_OB | OB_RECALC_DATA;
-			}
-		}
-		if (flag != 0) {
-			DEG_graph_id_tag_update(bmain,
-			                        (::Depsgraph *)graph,
-			                        id_node->id_orig,
-			                        flag);
-		}
+		deg_graph_build_tag_id_node(bmain, graph, id_node);
 	}
 }
 
@@ -30,12 +30,22 @@
 
 #pragma once
 
+#include "intern/depsgraph_types.h"
+
 struct Main;
 
 namespace DEG {
 
 struct Depsgraph;
+struct IDDepsNode;
 
 void deg_graph_build_finalize(struct Main *bmain, struct Depsgraph *graph);
 
+/* Same as above, but only finalizes nodes of the given IDs, which were
+ * re-built in an existing graph.
+ */
+void deg_graph_build_finalize_ids(struct Main *bmain,
+                                  struct Depsgraph *graph,
+                                  const vector<IDDepsNode *>& id_nodes);
+
 }  // namespace DEG
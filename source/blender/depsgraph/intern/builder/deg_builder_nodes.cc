@@ -376,6 +376,48 @@ void DepsgraphNodeBuilder::begin_build()
 	BLI_gset_clear(graph_->entry_tags, NULL);
 }
 
+void DepsgraphNodeBuilder::begin_build_ids(const vector<IDDepsNode *>& id_nodes)
+{
+	/* Store existing copy-on-write versions of datablocks and entry tags,
+	 * same as begin_build() does for all the IDs.
+	 */
+	id_info_hash_ = BLI_ghash_ptr_new("Depsgraph id hash");
+	foreach (IDDepsNode *id_node, id_nodes) {
+		IDInfo *id_info = (IDInfo *)MEM_mallocN(
+		        sizeof(IDInfo), "depsgraph id info");
+		id_info->id_cow = NULL;
+		if (deg_copy_on_write_is_expanded(id_node->id_cow) &&
+		    id_node->id_orig != id_node->id_cow)
+		{
+			id_info->id_cow = id_node->id_cow;
+			/* Take ownership, so the datablock is not freed with the node. */
+			id_node->id_cow = NULL;
+		}
+		id_info->is_visible = id_node->is_visible;
+		BLI_ghash_insert(id_info_hash_, id_node->id_orig, id_info);
+
+		GHASH_FOREACH_BEGIN(ComponentDepsNode *, comp_node, id_node->components)
+		{
+			foreach (OperationDepsNode *op_node, comp_node->operations) {
+				if (!BLI_gset_haskey(graph_->entry_tags, op_node)) {
+					continue;
+				}
+				SavedEntryTag entry_tag;
+				entry_tag.id_orig = id_node->id_orig;
+				entry_tag.component_type = comp_node->type;
+				entry_tag.opcode = op_node->opcode;
+				saved_entry_tags_.push_back(entry_tag);
+			}
+		}
+		GHASH_FOREACH_END();
+	}
+
+	graph_->remove_id_nodes(id_nodes);
+	foreach (IDDepsNode *id_node, graph_->id_nodes) {
+		built_map_.tagBuild(id_node->id_orig);
+	}
+}
+
 void DepsgraphNodeBuilder::end_build()
 {
 	foreach (const SavedEntryTag& entry_tag, saved_entry_tags_) {
@@ -102,6 +102,11 @@ struct DepsgraphNodeBuilder {
 	}
 
 	void begin_build();
+	/* Similar to above, but only nodes of the given IDs are removed from the
+	 * graph to be built again. Nodes of all other IDs are kept in the graph
+	 * and are considered built.
+	 */
+	void begin_build_ids(const vector<IDDepsNode *>& id_nodes);
 	void end_build();
 
 	IDDepsNode *add_id_node(ID *id);
@@ -163,6 +168,14 @@ struct DepsgraphNodeBuilder {
 	void build_view_layer(Scene *scene,
 	                      ViewLayer *view_layer,
 	                      eDepsNode_LinkedState_Type linked_state);
+	/* Build single object of the view layer, used when nodes of the object
+	 * were removed by begin_build_ids().
+	 */
+	void build_view_layer_object(Scene *scene,
+	                             ViewLayer *view_layer,
+	                             Object *object,
+	                             eDepsNode_LinkedState_Type linked_state,
+	                             bool is_visible);
 	void build_collection(Collection *collection);
 	void build_object(int base_index,
 	                  Object *object,
@@ -166,4 +166,26 @@ void DepsgraphNodeBuilder::build_view_layer(
 	}
 }
 
+void DepsgraphNodeBuilder::build_view_layer_object(
+        Scene *scene,
+        ViewLayer *view_layer,
+        Object *object,
+        eDepsNode_LinkedState_Type linked_state,
+        bool is_visible)
+{
+	view_layer_index_ = BLI_findindex(&scene->view_layers, view_layer);
+	BLI_assert(view_layer_index_ != -1);
+	/* Setup currently building context. */
+	scene_ = scene;
+	view_layer_ = view_layer;
+	/* Objects which are not based in the view layer are linked indirectly,
+	 * and don't flush base flags.
+	 */
+	Base *base = BKE_view_layer_base_find(view_layer, object);
+	const int base_index = (base != NULL)
+	        ? BLI_findindex(&view_layer->object_bases, base)
+	        : -1;
+	build_object(base_index, object, linked_state, is_visible);
+}
+
 }  // namespace DEG
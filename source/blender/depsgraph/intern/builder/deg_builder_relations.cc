@@ -40,6 +40,7 @@
 
 #include "BLI_utildefines.h"
 #include "BLI_blenlib.h"
+#include "BLI_task.h"
 
 extern "C" {
 #include "DNA_action_types.h"
@@ -396,6 +397,20 @@ void DepsgraphRelationBuilder::begin_build()
 {
 }
 
+void DepsgraphRelationBuilder::begin_build_ids(const vector<IDDepsNode *>& id_nodes)
+{
+	GSet *build_ids = BLI_gset_ptr_new(__func__);
+	foreach (IDDepsNode *id_node, id_nodes) {
+		BLI_gset_add(build_ids, id_node->id_orig);
+	}
+	foreach (IDDepsNode *id_node, graph_->id_nodes) {
+		if (!BLI_gset_haskey(build_ids, id_node->id_orig)) {
+			built_map_.tagBuild(id_node->id_orig);
+		}
+	}
+	BLI_gset_free(build_ids, NULL);
+}
+
 void DepsgraphRelationBuilder::build_id(ID *id)
 {
 	if (id == NULL) {
@@ -2237,10 +2252,69 @@ void DepsgraphRelationBuilder::build_speaker(Speaker *speaker)
 	build_animdata(&speaker->id);
 }
 
+namespace {
+
+struct CopyOnWriteRelationsData {
+	DepsgraphRelationBuilder *builder;
+	Depsgraph *graph;
+	vector<DepsgraphRelationBuilder::StagedRelation> *relations;
+};
+
+void build_copy_on_write_relations_func(
+        void *__restrict data_v,
+        const int i,
+        const ParallelRangeTLS *__restrict /*tls*/)
+{
+	CopyOnWriteRelationsData *data = (CopyOnWriteRelationsData *)data_v;
+	data->builder->build_copy_on_write_relations(data->graph->id_nodes[i],
+	                                             &data->relations[i]);
+}
+
+}  /* namespace */
+
+/* Relations are only looked up while ID nodes are being traversed, so this
+ * pass runs in parallel. The graph itself is only modified afterwards, in the
+ * order of ID nodes, which gives the same graph as a serial traversal.
+ */
 void DepsgraphRelationBuilder::build_copy_on_write_relations()
 {
-	foreach (IDDepsNode *id_node, graph_->id_nodes) {
-		build_copy_on_write_relations(id_node);
+	const int num_id_nodes = graph_->id_nodes.size();
+	vector<StagedRelation> *relations = new vector<StagedRelation>[num_id_nodes];
+	CopyOnWriteRelationsData data;
+	data.builder = this;
+	data.graph = graph_;
+	data.relations = relations;
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.min_iter_per_thread = 1024;
+	BLI_task_parallel_range(0, num_id_nodes,
+	                        &data,
+	                        build_copy_on_write_relations_func,
+	                        &settings);
+	for (int i = 0; i < num_id_nodes; ++i) {
+		add_staged_relations(relations[i]);
+	}
+	delete [] relations;
+}
+
+void DepsgraphRelationBuilder::build_copy_on_write_relations(
+        const vector<IDDepsNode *>& id_nodes)
+{
+	vector<StagedRelation> relations;
+	foreach (IDDepsNode *id_node, id_nodes) {
+		build_copy_on_write_relations(id_node, &relations);
+	}
+	add_staged_relations(relations);
+}
+
+void DepsgraphRelationBuilder::add_staged_relations(
+        const vector<StagedRelation>& relations)
+{
+	foreach (const StagedRelation& staged, relations) {
+		DepsRelation *rel = graph_->add_new_relation(staged.from,
+		                                             staged.to,
+		                                             staged.description);
+		rel->flag |= staged.flag;
 	}
 }
 
@@ -2279,7 +2353,9 @@ void DepsgraphRelationBuilder::build_nested_shapekey(ID *owner, Key *key)
 	build_nested_datablock(owner, &key->id);
 }
 
-void DepsgraphRelationBuilder::build_copy_on_write_relations(IDDepsNode *id_node)
+void DepsgraphRelationBuilder::build_copy_on_write_relations(
+        IDDepsNode *id_node,
+        vector<StagedRelation> *r_relations)
 {
 	ID *id_orig = id_node->id_orig;
 	const ID_Type id_type = GS(id_orig->name);
@@ -2338,9 +2414,8 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDDepsNode *id_node
 		 */
 		OperationDepsNode *op_entry = comp_node->get_entry_operation();
 		if (op_entry != NULL) {
-			DepsRelation *rel = graph_->add_new_relation(
-			        op_cow, op_entry, "CoW Dependency");
-			rel->flag |= rel_flag;
+			StagedRelation rel = {op_cow, op_entry, "CoW Dependency", rel_flag};
+			r_relations->push_back(rel);
 		}
 		/* All dangling operations should also be executed after copy-on-write. */
 		GHASH_FOREACH_BEGIN(OperationDepsNode *, op_node, comp_node->operations_map)
@@ -2349,9 +2424,8 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDDepsNode *id_node
 				continue;
 			}
 			if (op_node->inlinks.size() == 0) {
-				DepsRelation *rel = graph_->add_new_relation(
-				        op_cow, op_node, "CoW Dependency");
-				rel->flag |= rel_flag;
+				StagedRelation rel = {op_cow, op_node, "CoW Dependency", rel_flag};
+				r_relations->push_back(rel);
 			}
 			else {
 				bool has_same_comp_dependency = false;
@@ -2367,9 +2441,8 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDDepsNode *id_node
 					}
 				}
 				if (!has_same_comp_dependency) {
-					DepsRelation *rel = graph_->add_new_relation(
-					        op_cow, op_node, "CoW Dependency");
-					rel->flag |= rel_flag;
+					StagedRelation rel = {op_cow, op_node, "CoW Dependency", rel_flag};
+					r_relations->push_back(rel);
 				}
 			}
 		}
@@ -2394,7 +2467,11 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDDepsNode *id_node
 			OperationKey data_copy_on_write_key(object_data_id,
 			                                    DEG_NODE_TYPE_COPY_ON_WRITE,
 			                                    DEG_OPCODE_COPY_ON_WRITE);
-			add_relation(data_copy_on_write_key, copy_on_write_key, "Eval Order");
+			OperationDepsNode *op_data_cow = get_node(data_copy_on_write_key);
+			if (op_data_cow != NULL) {
+				StagedRelation rel = {op_data_cow, op_cow, "Eval Order", 0};
+				r_relations->push_back(rel);
+			}
 		}
 		else {
 			BLI_assert(object->type == OB_EMPTY);
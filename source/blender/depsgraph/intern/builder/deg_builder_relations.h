@@ -181,6 +181,10 @@ struct DepsgraphRelationBuilder
 	DepsgraphRelationBuilder(Main *bmain, Depsgraph *graph);
 
 	void begin_build();
+	/* Only relations of the given IDs are to be built, relations of all other
+	 * IDs are kept in the graph and are considered built.
+	 */
+	void begin_build_ids(const vector<IDDepsNode *>& id_nodes);
 
 	template <typename KeyFrom, typename KeyTo>
 	DepsRelation *add_relation(const KeyFrom& key_from,
@@ -203,6 +207,12 @@ struct DepsgraphRelationBuilder
 	void build_id(ID *id);
 	void build_layer_collections(ListBase *lb);
 	void build_view_layer(Scene *scene, ViewLayer *view_layer);
+	/* Build relations of single object of the view layer, used for objects
+	 * which nodes were built by DepsgraphNodeBuilder::build_view_layer_object().
+	 */
+	void build_view_layer_object(Scene *scene,
+	                             ViewLayer *view_layer,
+	                             Object *object);
 	void build_collection(Object *object, Collection *collection);
 	void build_object(Base *base, Object *object);
 	void build_object_flags(Base *base, Object *object);
@@ -281,8 +291,24 @@ struct DepsgraphRelationBuilder
 	                              EffectorWeights *eff,
 	                              bool add_absorption, const char *name);
 
+	/* Relation found by a pass which runs in parallel over ID nodes, it is
+	 * added to the graph once the pass is over.
+	 */
+	struct StagedRelation {
+		OperationDepsNode *from;
+		OperationDepsNode *to;
+		const char *description;
+		int flag;
+	};
+
 	void build_copy_on_write_relations();
-	void build_copy_on_write_relations(IDDepsNode *id_node);
+	void build_copy_on_write_relations(const vector<IDDepsNode *>& id_nodes);
+	void build_copy_on_write_relations(IDDepsNode *id_node,
+	                                   vector<StagedRelation> *r_relations);
+	/* Flush custom data masks of operations of the given IDs and of the
+	 * components they depend on, which is where their builders request masks.
+	 */
+	void flush_customdata_masks(const vector<IDDepsNode *>& id_nodes);
 
 	template <typename KeyType>
 	OperationDepsNode *find_operation_node(const KeyType &key);
@@ -307,6 +333,11 @@ protected:
 	                                     const char *description,
 	                                     bool check_unique = false);
 
+	void add_staged_relations(const vector<StagedRelation>& relations);
+
+	/* Flush custom data masks requested from operations to their objects. */
+	void flush_customdata_masks();
+
 	template <typename KeyType>
 	DepsNodeHandle create_node_handle(const KeyType& key,
 	                                  const char *default_name = "");
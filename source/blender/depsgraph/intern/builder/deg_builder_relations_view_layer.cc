@@ -127,15 +127,7 @@ void DepsgraphRelationBuilder::build_view_layer(Scene *scene, ViewLayer *view_la
 	LISTBASE_FOREACH (MovieClip *, clip, &bmain_->movieclip) {
 		build_movieclip(clip);
 	}
-	/* TODO(sergey): Do this flush on CoW object? */
-	foreach (OperationDepsNode *node, graph_->operations) {
-		IDDepsNode *id_node = node->owner->owner;
-		ID *id = id_node->id_orig;
-		if (GS(id->name) == ID_OB) {
-			Object *object = (Object *)id;
-			object->customdata_mask |= node->customdata_mask;
-		}
-	}
+	flush_customdata_masks();
 	/* Build all set scenes. */
 	if (scene->set != NULL) {
 		ViewLayer *set_view_layer = BKE_view_layer_default_render(scene->set);
@@ -143,4 +135,56 @@ void DepsgraphRelationBuilder::build_view_layer(Scene *scene, ViewLayer *view_la
 	}
 }
 
+void DepsgraphRelationBuilder::build_view_layer_object(Scene *scene,
+                                                       ViewLayer *view_layer,
+                                                       Object *object)
+{
+	/* Setup currently building context. */
+	scene_ = scene;
+	build_object(BKE_view_layer_base_find(view_layer, object), object);
+}
+
+static void flush_operation_customdata_mask(OperationDepsNode *node)
+{
+	IDDepsNode *id_node = node->owner->owner;
+	ID *id = id_node->id_orig;
+	if (GS(id->name) == ID_OB) {
+		Object *object = (Object *)id;
+		object->customdata_mask |= node->customdata_mask;
+	}
+}
+
+void DepsgraphRelationBuilder::flush_customdata_masks()
+{
+	/* TODO(sergey): Do this flush on CoW object? */
+	foreach (OperationDepsNode *node, graph_->operations) {
+		flush_operation_customdata_mask(node);
+	}
+}
+
+void DepsgraphRelationBuilder::flush_customdata_masks(
+        const vector<IDDepsNode *>& id_nodes)
+{
+	foreach (IDDepsNode *id_node, id_nodes) {
+		GHASH_FOREACH_BEGIN(ComponentDepsNode *, comp_node, id_node->components)
+		{
+			foreach (OperationDepsNode *node, comp_node->operations) {
+				flush_operation_customdata_mask(node);
+				foreach (DepsRelation *rel, node->inlinks) {
+					if (rel->from->type != DEG_NODE_TYPE_OPERATION) {
+						continue;
+					}
+					OperationDepsNode *node_from = (OperationDepsNode *)rel->from;
+					foreach (OperationDepsNode *node_dep,
+					         node_from->owner->operations)
+					{
+						flush_operation_customdata_mask(node_dep);
+					}
+				}
+			}
+		}
+		GHASH_FOREACH_END();
+	}
+}
+
 }  // namespace DEG
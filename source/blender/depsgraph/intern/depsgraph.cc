@@ -60,6 +60,7 @@ extern "C" {
 #include "DEG_depsgraph_debug.h"
 
 #include "intern/eval/deg_eval_copy_on_write.h"
+#include "intern/eval/deg_eval_timeline.h"
 
 #include "intern/nodes/deg_node.h"
 #include "intern/nodes/deg_node_component.h"
@@ -93,11 +94,14 @@ Depsgraph::Depsgraph(Scene *scene,
     mode(mode),
     ctime(BKE_scene_frame_get(scene)),
     scene_cow(NULL),
-    is_active(false)
+    is_active(false),
+    timeline(NULL),
+    trace_timeline(NULL)
 {
 	BLI_spin_init(&lock);
 	id_hash = BLI_ghash_ptr_new("Depsgraph id hash");
 	entry_tags = BLI_gset_ptr_new("Depsgraph entry_tags");
+	relations_tagged_ids = BLI_gset_ptr_new("Depsgraph relations tagged ids");
 	debug_flags = G.debug;
 	memset(id_type_updated, 0, sizeof(id_type_updated));
 	memset(physics_relations, 0, sizeof(physics_relations));
@@ -108,9 +112,13 @@ Depsgraph::~Depsgraph()
 	clear_id_nodes();
 	BLI_ghash_free(id_hash, NULL, NULL);
 	BLI_gset_free(entry_tags, NULL);
+	BLI_gset_free(relations_tagged_ids, NULL);
 	if (time_source != NULL) {
 		OBJECT_GUARDED_DELETE(time_source, TimeSourceDepsNode);
 	}
+	if (timeline != NULL) {
+		OBJECT_GUARDED_DELETE(timeline, DepsgraphTimeline);
+	}
 	BLI_spin_end(&lock);
 }
 
@@ -365,6 +373,69 @@ void Depsgraph::clear_id_nodes()
 	deg_clear_physics_relations(this);
 }
 
+static bool is_removed_id_node_operation(GSet *id_nodes_remove,
+                                         const DepsNode *node)
+{
+	if (node->type != DEG_NODE_TYPE_OPERATION) {
+		return false;
+	}
+	const OperationDepsNode *op_node = (const OperationDepsNode *)node;
+	return BLI_gset_haskey(id_nodes_remove, op_node->owner->owner);
+}
+
+void Depsgraph::remove_id_nodes(const IDDepsNodes& id_nodes_remove)
+{
+	GSet *id_nodes_set = BLI_gset_ptr_new(__func__);
+	foreach (IDDepsNode *id_node, id_nodes_remove) {
+		BLI_gset_add(id_nodes_set, id_node);
+	}
+	/* Relations between operations of the removed IDs are freed together
+	 * with the nodes, relations to other nodes are to be unlinked from them.
+	 */
+	foreach (IDDepsNode *id_node, id_nodes_remove) {
+		GHASH_FOREACH_BEGIN(ComponentDepsNode *, comp_node, id_node->components)
+		{
+			BLI_assert(comp_node->operations_map == NULL);
+			foreach (OperationDepsNode *op_node, comp_node->operations) {
+				const DepsNode::Relations inlinks = op_node->inlinks;
+				foreach (DepsRelation *rel, inlinks) {
+					if (!is_removed_id_node_operation(id_nodes_set, rel->from)) {
+						rel->unlink();
+						OBJECT_GUARDED_DELETE(rel, DepsRelation);
+					}
+				}
+				const DepsNode::Relations outlinks = op_node->outlinks;
+				foreach (DepsRelation *rel, outlinks) {
+					if (!is_removed_id_node_operation(id_nodes_set, rel->to)) {
+						rel->unlink();
+						OBJECT_GUARDED_DELETE(rel, DepsRelation);
+					}
+				}
+				BLI_gset_remove(entry_tags, op_node, NULL);
+			}
+		}
+		GHASH_FOREACH_END();
+	}
+	operations.erase(
+	        std::remove_if(operations.begin(), operations.end(),
+	                       [id_nodes_set](OperationDepsNode *op_node) {
+	                           return BLI_gset_haskey(id_nodes_set,
+	                                                  op_node->owner->owner);
+	                       }),
+	        operations.end());
+	id_nodes.erase(
+	        std::remove_if(id_nodes.begin(), id_nodes.end(),
+	                       [id_nodes_set](IDDepsNode *id_node) {
+	                           return BLI_gset_haskey(id_nodes_set, id_node);
+	                       }),
+	        id_nodes.end());
+	foreach (IDDepsNode *id_node, id_nodes_remove) {
+		BLI_ghash_remove(id_hash, id_node->id_orig, NULL, NULL);
+		OBJECT_GUARDED_DELETE(id_node, IDDepsNode);
+	}
+	BLI_gset_free(id_nodes_set, NULL);
+}
+
 /* Add new relationship between two nodes. */
 DepsRelation *Depsgraph::add_new_relation(OperationDepsNode *from,
                                           OperationDepsNode *to,
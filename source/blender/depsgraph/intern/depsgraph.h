@@ -65,6 +65,7 @@ struct TimeSourceDepsNode;
 struct IDDepsNode;
 struct ComponentDepsNode;
 struct OperationDepsNode;
+struct DepsgraphTimeline;
 
 /* *************************** */
 /* Relationships Between Nodes */
@@ -132,6 +133,11 @@ struct Depsgraph {
 	IDDepsNode *add_id_node(ID *id, ID *id_cow_hint = NULL);
 	void clear_id_nodes();
 	void clear_id_nodes_conditional(const std::function <bool (ID_Type id_type)>& filter);
+	/* Remove nodes of the given IDs, together with relations to and from
+	 * nodes of other IDs. Copy-on-write datablocks are freed unless the caller
+	 * took ownership of them.
+	 */
+	void remove_id_nodes(const IDDepsNodes& id_nodes_remove);
 
 	/* Add new relationship between two nodes. */
 	DepsRelation *add_new_relation(OperationDepsNode *from,
@@ -182,6 +188,11 @@ struct Depsgraph {
 	/* Indicates whether relations needs to be updated. */
 	bool need_update;
 
+	/* IDs which relations needs to be updated, when only relations of some
+	 * IDs were tagged (see DEG_id_tag_relations_update()).
+	 */
+	GSet *relations_tagged_ids;
+
 	/* Indicates which ID types were updated. */
 	char id_type_updated[MAX_LIBARRAY];
 
@@ -228,6 +239,11 @@ struct Depsgraph {
 	int debug_flags;
 	string debug_name;
 
+	/* Timeline of evaluations, recorded when requested (NULL otherwise). */
+	DepsgraphTimeline *timeline;
+	/* Timeline of this graph in the global trace, owned by the trace. */
+	DepsgraphTimeline *trace_timeline;
+
 	/* Cached list of colliders/effectors for collections and the scene
 	 * created along with relations, for fast lookup during evaluation. */
 	GHash *physics_relations[DEG_PHYSICS_RELATIONS_NUM];
@@ -41,6 +41,8 @@
 
 extern "C" {
 #include "DNA_cachefile_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_force_types.h"
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
 
@@ -194,8 +196,9 @@ void DEG_graph_build_from_view_layer(Depsgraph *graph,
                                       Scene *scene,
                                       ViewLayer *view_layer)
 {
-	double start_time = 0.0;
-	if (G.debug & G_DEBUG_DEPSGRAPH_BUILD) {
+	const bool do_time = (G.debug & G_DEBUG_DEPSGRAPH_BUILD) != 0;
+	double start_time = 0.0, nodes_time = 0.0, relations_time = 0.0;
+	if (do_time) {
 		start_time = PIL_check_seconds_timer();
 	}
 	DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
@@ -210,6 +213,9 @@ void DEG_graph_build_from_view_layer(Depsgraph *graph,
 	                               view_layer,
 	                               DEG::DEG_ID_LINKED_DIRECTLY);
 	node_builder.end_build();
+	if (do_time) {
+		nodes_time = PIL_check_seconds_timer();
+	}
 	/* Hook up relationships between operations - to determine evaluation
 	 * order.
 	 */
@@ -227,6 +233,9 @@ void DEG_graph_build_from_view_layer(Depsgraph *graph,
 	if (G.debug_value == 799) {
 		DEG::deg_graph_transitive_reduction(deg_graph);
 	}
+	if (do_time) {
+		relations_time = PIL_check_seconds_timer();
+	}
 	/* Store pointers to commonly used valuated datablocks. */
 	deg_graph->scene_cow = (Scene *)deg_graph->get_cow_id(&deg_graph->scene->id);
 	/* Flush visibility layer and re-schedule nodes for update. */
@@ -240,10 +249,16 @@ void DEG_graph_build_from_view_layer(Depsgraph *graph,
 #endif
 	/* Relations are up to date. */
 	deg_graph->need_update = false;
+	BLI_gset_clear(deg_graph->relations_tagged_ids, NULL);
 	/* Finish statistics. */
-	if (G.debug & G_DEBUG_DEPSGRAPH_BUILD) {
-		printf("Depsgraph built in %f seconds.\n",
-		       PIL_check_seconds_timer() - start_time);
+	if (do_time) {
+		const double end_time = PIL_check_seconds_timer();
+		printf("Depsgraph built in %f seconds "
+		       "(nodes %f, relations %f, finalize %f).\n",
+		       end_time - start_time,
+		       nodes_time - start_time,
+		       relations_time - nodes_time,
+		       end_time - relations_time);
 	}
 }
 
@@ -268,7 +283,279 @@ void DEG_graph_tag_relations_update(Depsgraph *graph)
 	}
 }
 
-/* Create or update relations in the specified graph. */
+namespace DEG {
+
+namespace {
+
+/* Relation from an operation of a re-built ID to an operation of another ID.
+ * Builders add relations to the operations of the ID they are building, so
+ * those relations are not added again when only the re-built ID is built.
+ */
+struct SavedOutlink {
+	ID *id_orig;
+	eDepsNode_Type component_type;
+	string component_name;
+	eDepsOperation_Code opcode;
+	string name;
+	OperationDepsNode *to;
+	const char *description;
+	int flag;
+};
+
+/* State of re-built ID which is set by builders of other IDs. */
+struct SavedIDState {
+	ID *id_orig;
+	eDepsNode_LinkedState_Type linked_state;
+	bool is_visible;
+	int eval_flags;
+	uint64_t customdata_mask;
+};
+
+/* Only objects which are not involved into any of the relations which are
+ * built from outside of the object itself can be re-built: rigid body world,
+ * proxies, armatures and shared physics relations are handled by full build.
+ */
+bool deg_graph_id_relations_update_supported(const Depsgraph *graph,
+                                             const IDDepsNode *id_node)
+{
+	if (GS(id_node->id_orig->name) != ID_OB) {
+		return false;
+	}
+	if (id_node->linked_state == DEG_ID_LINKED_VIA_SET) {
+		return false;
+	}
+	const Object *object = (const Object *)id_node->id_orig;
+	if (object->type == OB_ARMATURE ||
+	    object->proxy != NULL ||
+	    object->proxy_from != NULL ||
+	    object->proxy_group != NULL)
+	{
+		return false;
+	}
+	if (object->rigidbody_object != NULL ||
+	    object->rigidbody_constraint != NULL ||
+	    object->soft != NULL ||
+	    object->particlesystem.first != NULL ||
+	    (object->pd != NULL && object->pd->forcefield != 0))
+	{
+		return false;
+	}
+	LISTBASE_FOREACH (ModifierData *, md, &object->modifiers) {
+		if (ELEM(md->type,
+		         eModifierType_Collision,
+		         eModifierType_Cloth,
+		         eModifierType_Smoke,
+		         eModifierType_DynamicPaint,
+		         eModifierType_Fluidsim,
+		         eModifierType_Softbody,
+		         eModifierType_ParticleSystem))
+		{
+			return false;
+		}
+	}
+	/* Physics relations of other objects might still use this one. */
+	if (deg_physics_relations_has_object(graph, object)) {
+		return false;
+	}
+	return true;
+}
+
+void deg_graph_save_id_outlinks(const vector<IDDepsNode *>& id_nodes,
+                                vector<SavedOutlink> *r_outlinks)
+{
+	GSet *id_nodes_set = BLI_gset_ptr_new(__func__);
+	foreach (IDDepsNode *id_node, id_nodes) {
+		BLI_gset_add(id_nodes_set, id_node);
+	}
+	foreach (IDDepsNode *id_node, id_nodes) {
+		GHashIterator gh_iter;
+		GHASH_ITER (gh_iter, id_node->components) {
+			/* Components are found by the name of their key, which differs
+			 * from the node name for components without sub-data.
+			 */
+			const IDDepsNode::ComponentIDKey *comp_key =
+			        (const IDDepsNode::ComponentIDKey *)BLI_ghashIterator_getKey(&gh_iter);
+			ComponentDepsNode *comp_node =
+			        (ComponentDepsNode *)BLI_ghashIterator_getValue(&gh_iter);
+			foreach (OperationDepsNode *op_node, comp_node->operations) {
+				foreach (DepsRelation *rel, op_node->outlinks) {
+					BLI_assert(rel->to->type == DEG_NODE_TYPE_OPERATION);
+					OperationDepsNode *op_to = (OperationDepsNode *)rel->to;
+					if (BLI_gset_haskey(id_nodes_set, op_to->owner->owner)) {
+						/* Relation is re-built together with its ID. */
+						continue;
+					}
+					SavedOutlink outlink;
+					outlink.id_orig = id_node->id_orig;
+					outlink.component_type = comp_key->type;
+					outlink.component_name = comp_key->name;
+					outlink.opcode = op_node->opcode;
+					outlink.name = op_node->name;
+					outlink.to = op_to;
+					outlink.description = rel->name;
+					outlink.flag = rel->flag;
+					r_outlinks->push_back(outlink);
+				}
+			}
+		}
+	}
+	BLI_gset_free(id_nodes_set, NULL);
+}
+
+bool deg_graph_restore_id_outlinks(Depsgraph *graph,
+                                   const vector<SavedOutlink>& outlinks)
+{
+	foreach (const SavedOutlink& outlink, outlinks) {
+		IDDepsNode *id_node = graph->find_id_node(outlink.id_orig);
+		ComponentDepsNode *comp_node = (id_node != NULL)
+		        ? id_node->find_component(outlink.component_type,
+		                                  outlink.component_name.c_str())
+		        : NULL;
+		OperationDepsNode *op_node = (comp_node != NULL)
+		        ? comp_node->find_operation(outlink.opcode,
+		                                    outlink.name.c_str(),
+		                                    -1)
+		        : NULL;
+		if (op_node == NULL) {
+			/* Operation used by other IDs is gone, their relations are to be
+			 * built again.
+			 */
+			return false;
+		}
+		/* Relations are restored as they were, builders might have added the
+		 * same relation more than once.
+		 */
+		DepsRelation *rel = graph->add_new_relation(op_node,
+		                                            outlink.to,
+		                                            outlink.description,
+		                                            false);
+		rel->flag |= outlink.flag;
+	}
+	return true;
+}
+
+/* Re-build nodes and relations of IDs tagged for relations update, keeping
+ * the rest of the graph and copy-on-write datablocks of all IDs.
+ *
+ * Returns false when it is not possible, the graph is to be fully re-built
+ * then.
+ */
+bool deg_graph_build_tagged_ids(Depsgraph *graph,
+                                Main *bmain,
+                                Scene *scene,
+                                ViewLayer *view_layer)
+{
+	const bool do_time = (G.debug & G_DEBUG_DEPSGRAPH_BUILD) != 0;
+	const double start_time = do_time ? PIL_check_seconds_timer() : 0.0;
+	vector<IDDepsNode *> id_nodes;
+	GSET_FOREACH_BEGIN(ID *, id, graph->relations_tagged_ids)
+	{
+		IDDepsNode *id_node = graph->find_id_node(id);
+		if (id_node == NULL) {
+			continue;
+		}
+		if (!deg_graph_id_relations_update_supported(graph, id_node)) {
+			return false;
+		}
+		id_nodes.push_back(id_node);
+	}
+	GSET_FOREACH_END();
+	BLI_gset_clear(graph->relations_tagged_ids, NULL);
+	if (id_nodes.size() == 0) {
+		return true;
+	}
+	/* Save state which other IDs have set on the IDs being re-built. */
+	vector<SavedOutlink> outlinks;
+	deg_graph_save_id_outlinks(id_nodes, &outlinks);
+	vector<SavedIDState> id_states;
+	foreach (IDDepsNode *id_node, id_nodes) {
+		SavedIDState id_state;
+		id_state.id_orig = id_node->id_orig;
+		id_state.linked_state = id_node->linked_state;
+		id_state.is_visible = id_node->is_visible;
+		id_state.eval_flags = id_node->eval_flags;
+		id_state.customdata_mask = ((Object *)id_node->id_orig)->customdata_mask;
+		id_states.push_back(id_state);
+	}
+	const int num_kept_id_nodes = graph->id_nodes.size() - id_nodes.size();
+	/* Build nodes of the tagged IDs. */
+	DepsgraphNodeBuilder node_builder(bmain, graph);
+	node_builder.begin_build_ids(id_nodes);
+	foreach (const SavedIDState& id_state, id_states) {
+		node_builder.build_view_layer_object(scene,
+		                                     view_layer,
+		                                     (Object *)id_state.id_orig,
+		                                     id_state.linked_state,
+		                                     id_state.is_visible);
+	}
+	node_builder.end_build();
+	/* Nodes of the re-built IDs and of the IDs which were added to the graph
+	 * by them are at the end.
+	 */
+	id_nodes.assign(graph->id_nodes.begin() + num_kept_id_nodes,
+	                graph->id_nodes.end());
+	/* Build relations of the tagged IDs. */
+	DepsgraphRelationBuilder relation_builder(bmain, graph);
+	relation_builder.begin_build_ids(id_nodes);
+	foreach (const SavedIDState& id_state, id_states) {
+		Object *object = (Object *)id_state.id_orig;
+		relation_builder.build_view_layer_object(scene, view_layer, object);
+		graph->find_id_node(&object->id)->eval_flags |= id_state.eval_flags;
+		object->customdata_mask |= id_state.customdata_mask;
+	}
+	if (!deg_graph_restore_id_outlinks(graph, outlinks)) {
+		return false;
+	}
+	relation_builder.build_copy_on_write_relations(id_nodes);
+	const double relations_time = do_time ? PIL_check_seconds_timer() : 0.0;
+	/* Cycles and visibility are solved over the whole graph, same as after
+	 * a full build. These are linear passes over operations, which is cheap
+	 * compared to running the builders of all IDs.
+	 *
+	 * Changed relations might have solved cycles.
+	 */
+	foreach (OperationDepsNode *op_node, graph->operations) {
+		foreach (DepsRelation *rel, op_node->inlinks) {
+			rel->flag &= ~DEPSREL_FLAG_CYCLIC;
+		}
+	}
+	deg_graph_detect_cycles(graph);
+	if (G.debug_value == 799) {
+		deg_graph_transitive_reduction(graph);
+	}
+	deg_graph_build_finalize_ids(bmain, graph, id_nodes);
+	/* Operations of the components are only listed once they are finalized. */
+	relation_builder.flush_customdata_masks(id_nodes);
+	/* Copy-on-write datablocks are kept, make sure they get new settings. */
+	foreach (const SavedIDState& id_state, id_states) {
+		DEG_graph_id_tag_update(bmain,
+		                        (::Depsgraph *)graph,
+		                        id_state.id_orig,
+		                        DEG_TAG_COPY_ON_WRITE);
+	}
+	DEG_graph_on_visible_update(bmain, (::Depsgraph *)graph);
+	if (do_time) {
+		const double end_time = PIL_check_seconds_timer();
+		printf("Depsgraph relations of %d IDs updated in %f seconds "
+		       "(builders %f, cycles and finalize %f).\n",
+		       (int)id_states.size(),
+		       end_time - start_time,
+		       relations_time - start_time,
+		       end_time - relations_time);
+	}
+	return true;
+}
+
+}  // namespace
+
+}  // namespace DEG
+
+/* Create or update relations in the specified graph.
+ *
+ * When only relations of some objects were tagged for update, only nodes and
+ * relations of those objects are re-built. Otherwise relations are rebuilt
+ * from scratch.
+ */
 void DEG_graph_relations_update(Depsgraph *graph,
                                 Main *bmain,
                                 Scene *scene,
@@ -276,8 +563,17 @@ void DEG_graph_relations_update(Depsgraph *graph,
 {
 	DEG::Depsgraph *deg_graph = (DEG::Depsgraph *)graph;
 	if (!deg_graph->need_update) {
-		/* Graph is up to date, nothing to do. */
-		return;
+		if (BLI_gset_len(deg_graph->relations_tagged_ids) == 0) {
+			/* Graph is up to date, nothing to do. */
+			return;
+		}
+		if (DEG::deg_graph_build_tagged_ids(deg_graph,
+		                                    bmain,
+		                                    scene,
+		                                    view_layer))
+		{
+			return;
+		}
 	}
 	DEG_graph_build_from_view_layer(graph, bmain, scene, view_layer);
 }
@@ -298,3 +594,27 @@ void DEG_relations_tag_update(Main *bmain)
 		}
 	}
 }
+
+/* Tag relations of the given ID for update. */
+void DEG_id_tag_relations_update(Main *bmain, ID *id)
+{
+	DEG_GLOBAL_DEBUG_PRINTF(TAG, "%s: Tagging relations of %s for update.\n",
+	                        __func__, id->name);
+	LISTBASE_FOREACH (Scene *, scene, &bmain->scene) {
+		LISTBASE_FOREACH (ViewLayer *, view_layer, &scene->view_layers) {
+			Depsgraph *depsgraph =
+			        (Depsgraph *)BKE_scene_get_depsgraph(scene,
+			                                             view_layer,
+			                                             false);
+			if (depsgraph == NULL) {
+				continue;
+			}
+			DEG::Depsgraph *deg_graph =
+			        reinterpret_cast<DEG::Depsgraph *>(depsgraph);
+			/* Relations of IDs which are not in the graph don't affect it. */
+			if (deg_graph->find_id_node(id) != NULL) {
+				BLI_gset_add(deg_graph->relations_tagged_ids, id);
+			}
+		}
+	}
+}
@@ -46,6 +46,7 @@ extern "C" {
 
 #include "intern/depsgraph_intern.h"
 #include "intern/depsgraph_types.h"
+#include "intern/eval/deg_eval_timeline.h"
 #include "intern/nodes/deg_node_id.h"
 #include "intern/nodes/deg_node_time.h"
 
@@ -255,3 +256,27 @@ void DEG_stats_simple(const Depsgraph *graph, size_t *r_outer,
 		if (r_outer)     *r_outer     = tot_outer;
 	}
 }
+
+/* ************************************************ */
+/* Evaluation Timeline */
+
+void DEG_debug_timeline_begin(Depsgraph *graph)
+{
+	DEG::deg_eval_timeline_begin(reinterpret_cast<DEG::Depsgraph *>(graph));
+}
+
+void DEG_debug_timeline_end(Depsgraph *graph)
+{
+	DEG::deg_eval_timeline_end(reinterpret_cast<DEG::Depsgraph *>(graph));
+}
+
+void DEG_debug_timeline_trace_json(const Depsgraph *graph, FILE *stream)
+{
+	DEG::deg_eval_timeline_write_trace(
+	        stream, reinterpret_cast<const DEG::Depsgraph *>(graph));
+}
+
+void DEG_debug_timeline_trace_file_set(const char *filepath)
+{
+	DEG::deg_eval_timeline_trace_file_set(filepath);
+}
@@ -145,5 +145,7 @@ string deg_color_end(void);
 struct ListBase *deg_build_effector_relations(Depsgraph *graph, struct Collection *collection);
 struct ListBase *deg_build_collision_relations(Depsgraph *graph, struct Collection *collection, unsigned int modifier_type);
 void deg_clear_physics_relations(Depsgraph *graph);
+/* Check whether object is used by any of the cached physics relations. */
+bool deg_physics_relations_has_object(const Depsgraph *graph, const struct Object *object);
 
 }  // namespace DEG
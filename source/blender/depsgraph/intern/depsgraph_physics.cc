@@ -239,4 +239,33 @@ void deg_clear_physics_relations(Depsgraph *graph)
 	}
 }
 
+bool deg_physics_relations_has_object(const Depsgraph *graph, const Object *object)
+{
+	for (int i = 0; i < DEG_PHYSICS_RELATIONS_NUM; i++) {
+		GHash *hash = graph->physics_relations[i];
+		if (hash == NULL) {
+			continue;
+		}
+		GHASH_FOREACH_BEGIN(ListBase *, relations, hash)
+		{
+			if (i == DEG_PHYSICS_EFFECTOR) {
+				LISTBASE_FOREACH (EffectorRelation *, relation, relations) {
+					if (relation->ob == object) {
+						return true;
+					}
+				}
+			}
+			else {
+				LISTBASE_FOREACH (CollisionRelation *, relation, relations) {
+					if (relation->ob == object) {
+						return true;
+					}
+				}
+			}
+		}
+		GHASH_FOREACH_END();
+	}
+	return false;
+}
+
 }
@@ -41,6 +41,7 @@
 #include "intern/nodes/deg_node.h"
 #include "intern/nodes/deg_node_component.h"
 #include "intern/nodes/deg_node_operation.h"
+#include "intern/eval/deg_eval_timeline.h"
 
 #include "intern/depsgraph_intern.h"
 
@@ -197,4 +198,5 @@ void DEG_register_node_types(void)
 /* Free registry on exit */
 void DEG_free_node_types(void)
 {
+	DEG::deg_eval_timeline_trace_exit();
 }
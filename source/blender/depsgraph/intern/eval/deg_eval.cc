@@ -32,6 +32,10 @@
 
 #include "intern/eval/deg_eval.h"
 
+#include <algorithm>
+
+#include "MEM_guardedalloc.h"
+
 #include "PIL_time.h"
 
 #include "BLI_utildefines.h"
@@ -49,6 +53,7 @@
 #include "intern/eval/deg_eval_copy_on_write.h"
 #include "intern/eval/deg_eval_flush.h"
 #include "intern/eval/deg_eval_stats.h"
+#include "intern/eval/deg_eval_timeline.h"
 #include "intern/nodes/deg_node.h"
 #include "intern/nodes/deg_node_component.h"
 #include "intern/nodes/deg_node_id.h"
@@ -64,15 +69,38 @@ namespace DEG {
 /* ********************** */
 /* Evaluation Entrypoints */
 
+/* Cost of an operation which was never timed, in seconds. Without timing
+ * history critical path falls back to the longest chain of operations.
+ */
+#define DEG_EVAL_DEFAULT_COST 1e-6
+/* Weight of the last evaluation time in the smoothed operation cost. */
+#define DEG_EVAL_COST_FACTOR 0.25
+/* Operations with critical path shorter than this fraction of the longest
+ * one are pushed with low priority.
+ */
+#define DEG_EVAL_HIGH_PRIORITY_FACTOR 0.5
+/* Number of ready children which are sorted and pushed together. */
+#define DEG_EVAL_SCHEDULE_CHUNK 64
+
+struct DepsgraphEvalState;
+
 /* Forward declarations. */
 static void schedule_children(TaskPool *pool,
-                              Depsgraph *graph,
+                              DepsgraphEvalState *state,
                               OperationDepsNode *node,
                               const int thread_id);
 
 struct DepsgraphEvalState {
 	Depsgraph *graph;
 	bool do_stats;
+	/* Schedule operations with the longest critical path first, only makes
+	 * sense when there are multiple threads.
+	 */
+	bool do_critical_path;
+	/* Operations with critical path below this are pushed with low priority. */
+	double critical_path_high;
+	/* Timeline records of this evaluation, NULL when not recording. */
+	DepsgraphTimelineRecorder *timeline;
 };
 
 static void deg_task_run_func(TaskPool *pool,
@@ -85,22 +113,38 @@ static void deg_task_run_func(TaskPool *pool,
 	/* Sanity checks. */
 	BLI_assert(!node->is_noop() && "NOOP nodes should not actually be scheduled");
 	/* Perform operation. */
-	if (state->do_stats) {
+	if (state->do_stats || state->do_critical_path || state->timeline) {
 		const double start_time = PIL_check_seconds_timer();
 		node->evaluate((::Depsgraph *)state->graph);
-		node->stats.current_time += PIL_check_seconds_timer() - start_time;
+		const double end_time = PIL_check_seconds_timer();
+		const double time = end_time - start_time;
+		if (state->do_stats) {
+			node->stats.current_time += time;
+		}
+		if (state->timeline) {
+			state->timeline->record(node, thread_id, start_time, end_time);
+		}
+		/* Only this thread is accessing the node at this point. */
+		if (node->stats.average_time == 0.0) {
+			node->stats.average_time = time;
+		}
+		else {
+			node->stats.average_time +=
+			        (time - node->stats.average_time) * DEG_EVAL_COST_FACTOR;
+		}
 	}
 	else {
 		node->evaluate((::Depsgraph *)state->graph);
 	}
 	/* Schedule children. */
 	BLI_task_pool_delayed_push_begin(pool, thread_id);
-	schedule_children(pool, state->graph, node, thread_id);
+	schedule_children(pool, state, node, thread_id);
 	BLI_task_pool_delayed_push_end(pool, thread_id);
 }
 
 typedef struct CalculatePengindData {
 	Depsgraph *graph;
+	bool do_critical_path;
 } CalculatePengindData;
 
 static bool check_operation_node_visible(OperationDepsNode *op_node)
@@ -116,6 +160,34 @@ static bool check_operation_node_visible(OperationDepsNode *op_node)
 	return id_node->is_visible;
 }
 
+/* Check whether operation is to be evaluated during this update. */
+static bool check_operation_node_pending(OperationDepsNode *op_node)
+{
+	return check_operation_node_visible(op_node) &&
+	       (op_node->flag & DEPSOP_FLAG_NEEDS_UPDATE) != 0;
+}
+
+/* Relation which is to be waited for by the evaluation. */
+static bool check_operation_relation_pending(DepsRelation *rel)
+{
+	return rel->from->type == DEG_NODE_TYPE_OPERATION &&
+	       rel->to->type == DEG_NODE_TYPE_OPERATION &&
+	       (rel->flag & DEPSREL_FLAG_CYCLIC) == 0 &&
+	       check_operation_node_pending((OperationDepsNode *)rel->from) &&
+	       check_operation_node_pending((OperationDepsNode *)rel->to);
+}
+
+static double operation_node_cost(const OperationDepsNode *op_node)
+{
+	if (op_node->is_noop()) {
+		return 0.0;
+	}
+	if (op_node->stats.average_time > 0.0) {
+		return op_node->stats.average_time;
+	}
+	return DEG_EVAL_DEFAULT_COST;
+}
+
 static void calculate_pending_func(
         void *__restrict data_v,
         const int i,
@@ -155,13 +227,27 @@ static void calculate_pending_func(
 			++node->num_links_pending;
 		}
 	}
+	if (data->do_critical_path) {
+		/* Number of children to be visited before the critical path of this
+		 * node is known.
+		 */
+		node->custom_flags = 0;
+		node->critical_path = operation_node_cost(node);
+		foreach (DepsRelation *rel, node->outlinks) {
+			if (check_operation_relation_pending(rel)) {
+				++node->custom_flags;
+			}
+		}
+	}
 }
 
-static void calculate_pending_parents(Depsgraph *graph)
+static void calculate_pending_parents(DepsgraphEvalState *state,
+                                      Depsgraph *graph)
 {
 	const int num_operations = graph->operations.size();
 	CalculatePengindData data;
 	data.graph = graph;
+	data.do_critical_path = state->do_critical_path;
 	ParallelRangeSettings settings;
 	BLI_parallel_range_settings_defaults(&settings);
 	settings.min_iter_per_thread = 1024;
@@ -172,10 +258,53 @@ static void calculate_pending_parents(Depsgraph *graph)
 	                        &settings);
 }
 
+/* Calculate critical path of all operations to be evaluated, visiting them
+ * in reverse topological order (children before their parents). Operations
+ * which are part of a cycle not marked as such keep their own cost.
+ */
+static void calculate_critical_path(DepsgraphEvalState *state,
+                                    Depsgraph *graph)
+{
+	vector<OperationDepsNode *> stack;
+	foreach (OperationDepsNode *node, graph->operations) {
+		if (node->custom_flags == 0 && check_operation_node_pending(node)) {
+			stack.push_back(node);
+		}
+	}
+	double max_critical_path = 0.0;
+	while (!stack.empty()) {
+		OperationDepsNode *node = stack.back();
+		stack.pop_back();
+		double children_critical_path = 0.0;
+		foreach (DepsRelation *rel, node->outlinks) {
+			if (check_operation_relation_pending(rel)) {
+				OperationDepsNode *to = (OperationDepsNode *)rel->to;
+				children_critical_path = max(children_critical_path,
+				                             to->critical_path);
+			}
+		}
+		node->critical_path += children_critical_path;
+		max_critical_path = max(max_critical_path, node->critical_path);
+		foreach (DepsRelation *rel, node->inlinks) {
+			if (check_operation_relation_pending(rel)) {
+				OperationDepsNode *from = (OperationDepsNode *)rel->from;
+				if (--from->custom_flags == 0) {
+					stack.push_back(from);
+				}
+			}
+		}
+	}
+	state->critical_path_high = max_critical_path * DEG_EVAL_HIGH_PRIORITY_FACTOR;
+}
+
 static void initialize_execution(DepsgraphEvalState *state, Depsgraph *graph)
 {
 	const bool do_stats = state->do_stats;
-	calculate_pending_parents(graph);
+	state->critical_path_high = 0.0;
+	calculate_pending_parents(state, graph);
+	if (state->do_critical_path) {
+		calculate_critical_path(state, graph);
+	}
 	/* Clear tags and other things which needs to be clear. */
 	foreach (OperationDepsNode *node, graph->operations) {
 		if (do_stats) {
@@ -184,23 +313,22 @@ static void initialize_execution(DepsgraphEvalState *state, Depsgraph *graph)
 	}
 }
 
-/* Schedule a node if it needs evaluation.
+/* Check whether a node needs evaluation and all its dependencies are
+ * evaluated, marks the node as scheduled when it is ready to be pushed.
  *   dec_parents: Decrement pending parents count, true when child nodes are
  *                scheduled after a task has been completed.
  */
-static void schedule_node(TaskPool *pool, Depsgraph *graph,
-                          OperationDepsNode *node, bool dec_parents,
-                          const int thread_id)
+static bool schedule_node_ready(OperationDepsNode *node, bool dec_parents)
 {
 	/* No need to schedule nodes of invisible ID. */
 	if (!check_operation_node_visible(node)) {
-		return;
+		return false;
 	}
 	/* No need to schedule operations which are not tagged for update, they are
 	 * considered to be up to date.
 	 */
 	if ((node->flag & DEPSOP_FLAG_NEEDS_UPDATE) == 0) {
-		return;
+		return false;
 	}
 	/* TODO(sergey): This is not strictly speaking safe to read
 	 * num_links_pending.
@@ -213,39 +341,109 @@ static void schedule_node(TaskPool *pool, Depsgraph *graph,
 	 * evaluated.
 	 */
 	if (node->num_links_pending != 0) {
-		return;
+		return false;
 	}
 	bool is_scheduled = atomic_fetch_and_or_uint8(
 	        (uint8_t *)&node->scheduled, (uint8_t)true);
-	if (!is_scheduled) {
-		if (node->is_noop()) {
-			/* skip NOOP node, schedule children right away */
-			schedule_children(pool, graph, node, thread_id);
-		}
-		else {
-			/* children are scheduled once this task is completed */
-			BLI_task_pool_push_from_thread(pool,
-			                               deg_task_run_func,
-			                               node,
-			                               false,
-			                               TASK_PRIORITY_HIGH,
-			                               thread_id);
+	return !is_scheduled;
+}
+
+static void schedule_node_push(TaskPool *pool,
+                               DepsgraphEvalState *state,
+                               OperationDepsNode *node,
+                               const int thread_id)
+{
+	if (node->is_noop()) {
+		/* skip NOOP node, schedule children right away */
+		schedule_children(pool, state, node, thread_id);
+	}
+	else {
+		/* children are scheduled once this task is completed */
+		const TaskPriority priority =
+		        (node->critical_path >= state->critical_path_high)
+		                ? TASK_PRIORITY_HIGH
+		                : TASK_PRIORITY_LOW;
+		BLI_task_pool_push_from_thread(pool,
+		                               deg_task_run_func,
+		                               node,
+		                               false,
+		                               priority,
+		                               thread_id);
+	}
+}
+
+static bool operation_node_critical_path_less(const OperationDepsNode *a,
+                                              const OperationDepsNode *b)
+{
+	return a->critical_path < b->critical_path;
+}
+
+/* Push nodes which are ready so the ones with the longest critical path are
+ * picked up first: high priority tasks are added to the front of the queue
+ * (push shortest first), low priority ones to the back (push longest first).
+ *   first_longest: Push the longest node before all others, the first push
+ *                  from a task ends up in the thread's local queue and is
+ *                  evaluated right after the task.
+ */
+static void schedule_nodes_push(TaskPool *pool,
+                                DepsgraphEvalState *state,
+                                OperationDepsNode **nodes,
+                                int num_nodes,
+                                bool first_longest,
+                                const int thread_id)
+{
+	if (!state->do_critical_path || num_nodes < 2) {
+		for (int i = 0; i < num_nodes; i++) {
+			schedule_node_push(pool, state, nodes[i], thread_id);
 		}
+		return;
+	}
+	std::sort(nodes, nodes + num_nodes, operation_node_critical_path_less);
+	if (first_longest) {
+		num_nodes--;
+		schedule_node_push(pool, state, nodes[num_nodes], thread_id);
+	}
+	int first_high = 0;
+	while (first_high < num_nodes &&
+	       nodes[first_high]->critical_path < state->critical_path_high)
+	{
+		first_high++;
+	}
+	for (int i = first_high - 1; i >= 0; i--) {
+		schedule_node_push(pool, state, nodes[i], thread_id);
+	}
+	for (int i = first_high; i < num_nodes; i++) {
+		schedule_node_push(pool, state, nodes[i], thread_id);
 	}
 }
 
-static void schedule_graph(TaskPool *pool, Depsgraph *graph)
+static void schedule_graph(TaskPool *pool, DepsgraphEvalState *state)
 {
-	foreach (OperationDepsNode *node, graph->operations) {
-		schedule_node(pool, graph, node, false, 0);
+	vector<OperationDepsNode *> ready_nodes;
+	foreach (OperationDepsNode *node, state->graph->operations) {
+		if (schedule_node_ready(node, false)) {
+			ready_nodes.push_back(node);
+		}
 	}
+	if (ready_nodes.empty()) {
+		return;
+	}
+	/* The pool is suspended, nothing goes to a local queue. */
+	schedule_nodes_push(pool,
+	                    state,
+	                    &ready_nodes[0],
+	                    ready_nodes.size(),
+	                    false,
+	                    0);
 }
 
 static void schedule_children(TaskPool *pool,
-                              Depsgraph *graph,
+                              DepsgraphEvalState *state,
                               OperationDepsNode *node,
                               const int thread_id)
 {
+	OperationDepsNode *ready_nodes[DEG_EVAL_SCHEDULE_CHUNK];
+	int num_ready_nodes = 0;
 	foreach (DepsRelation *rel, node->outlinks) {
 		OperationDepsNode *child = (OperationDepsNode *)rel->to;
 		BLI_assert(child->type == DEG_NODE_TYPE_OPERATION);
@@ -253,12 +451,26 @@ static void schedule_children(TaskPool *pool,
 			/* Happens when having cyclic dependencies. */
 			continue;
 		}
-		schedule_node(pool,
-		              graph,
-		              child,
-		              (rel->flag & DEPSREL_FLAG_CYCLIC) == 0,
-		              thread_id);
+		if (!schedule_node_ready(child, (rel->flag & DEPSREL_FLAG_CYCLIC) == 0)) {
+			continue;
+		}
+		if (num_ready_nodes == DEG_EVAL_SCHEDULE_CHUNK) {
+			schedule_nodes_push(pool,
+			                    state,
+			                    ready_nodes,
+			                    num_ready_nodes,
+			                    true,
+			                    thread_id);
+			num_ready_nodes = 0;
+		}
+		ready_nodes[num_ready_nodes++] = child;
 	}
+	schedule_nodes_push(pool,
+	                    state,
+	                    ready_nodes,
+	                    num_ready_nodes,
+	                    true,
+	                    thread_id);
 }
 
 static void depsgraph_ensure_view_layer(Depsgraph *graph)
@@ -297,6 +509,8 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
 	DepsgraphEvalState state;
 	state.graph = graph;
 	state.do_stats = do_time_debug;
+	state.do_critical_path = false;
+	state.timeline = NULL;
 	/* Set up task scheduler and pull for threaded evaluation. */
 	TaskScheduler *task_scheduler;
 	bool need_free_scheduler;
@@ -307,14 +521,24 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
 	else {
 		task_scheduler = BLI_task_scheduler_get();
 		need_free_scheduler = false;
+		state.do_critical_path = BLI_task_scheduler_num_threads(task_scheduler) > 1;
+	}
+	if (deg_eval_timeline_is_enabled(graph)) {
+		state.timeline = OBJECT_GUARDED_NEW(
+		        DepsgraphTimelineRecorder,
+		        BLI_task_scheduler_num_threads(task_scheduler));
 	}
 	TaskPool *task_pool = BLI_task_pool_create_suspended(task_scheduler, &state);
 	/* Prepare all nodes for evaluation. */
 	initialize_execution(&state, graph);
 	/* Do actual evaluation now. */
-	schedule_graph(task_pool, graph);
+	schedule_graph(task_pool, &state);
 	BLI_task_pool_work_and_wait(task_pool);
 	BLI_task_pool_free(task_pool);
+	if (state.timeline != NULL) {
+		deg_eval_timeline_store(graph, *state.timeline, PIL_check_seconds_timer());
+		OBJECT_GUARDED_DELETE(state.timeline, DepsgraphTimelineRecorder);
+	}
 	/* Finalize statistics gathering. This is because we only gather single
 	 * operation timing here, without aggregating anything to avoid any extra
 	 * synchronization.
@@ -277,6 +277,11 @@ bool id_copy_inplace_no_main(const ID *id, ID *newid)
 	id_for_copy = nested_id_hack_get_discarded_pointers(&id_hack_storage, id);
 #endif
 
+	/* Data layers of linked meshes are shared with the original until they are
+	 * written to, they can't be edited so evaluation mostly only reads them.
+	 * Local meshes are copied, edits of the original are only seen by the copy
+	 * on the next copy-on-write update.
+	 */
 	bool result = BKE_id_copy_ex(NULL,
 	                             (ID *)id_for_copy,
 	                             &newid,
@@ -284,7 +289,8 @@ bool id_copy_inplace_no_main(const ID *id, ID *newid)
 	                              LIB_ID_CREATE_NO_USER_REFCOUNT |
 	                              LIB_ID_CREATE_NO_ALLOCATE |
 	                              LIB_ID_CREATE_NO_DEG_TAG |
-	                              LIB_ID_COPY_CACHES),
+	                              LIB_ID_COPY_CACHES |
+	                              LIB_ID_COPY_CD_SHARE),
 	                             false);
 
 #ifdef NESTED_ID_NASTY_WORKAROUND
@@ -0,0 +1,277 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2018 Blender Foundation.
+ * All rights reserved.
+ *
+ * Contributor(s): None Yet
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+
+/** \file blender/depsgraph/intern/eval/deg_eval_timeline.cc
+ *  \ingroup depsgraph
+ */
+
+#include "intern/eval/deg_eval_timeline.h"
+
+#include <cstring>
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_fileops.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+
+#include "intern/depsgraph.h"
+#include "intern/nodes/deg_node_component.h"
+#include "intern/nodes/deg_node_id.h"
+#include "intern/nodes/deg_node_operation.h"
+
+#include "util/deg_util_foreach.h"
+
+extern "C" {
+#include "DNA_ID.h"
+} /* extern "C" */
+
+namespace DEG {
+
+namespace {
+
+/* Global trace, enabled from the command line. Timelines are owned by the
+ * trace and outlive the graphs they were recorded for.
+ */
+ThreadMutex trace_mutex = BLI_MUTEX_INITIALIZER;
+char *trace_filepath = NULL;
+vector<DepsgraphTimeline *> trace_timelines;
+
+void timeline_json_escape(string *r_str, const string &str)
+{
+	r_str->clear();
+	r_str->reserve(str.size());
+	foreach (const char ch, str) {
+		switch (ch) {
+			case '"': *r_str += "\\\""; break;
+			case '\\': *r_str += "\\\\"; break;
+			case '\n': *r_str += "\\n"; break;
+			case '\t': *r_str += "\\t"; break;
+			default:
+				if ((unsigned char)ch < 0x20) {
+					char buf[8];
+					BLI_snprintf(buf, sizeof(buf), "\\u%04x", ch);
+					*r_str += buf;
+				}
+				else {
+					*r_str += ch;
+				}
+				break;
+		}
+	}
+}
+
+/* Chrome trace event timestamps are in microseconds. */
+BLI_INLINE double timeline_trace_time(double time, double base_time)
+{
+	return (time - base_time) * 1e6;
+}
+
+void timeline_write_trace(FILE *f,
+                          const vector<const DepsgraphTimeline *> &timelines)
+{
+	double base_time = 0.0;
+	bool has_base_time = false;
+	foreach (const DepsgraphTimeline *timeline, timelines) {
+		if (!has_base_time || timeline->start_time < base_time) {
+			base_time = timeline->start_time;
+			has_base_time = true;
+		}
+	}
+	string name, id_name, component_name;
+	bool is_first = true;
+	fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	for (int pid = 0; pid < (int)timelines.size(); pid++) {
+		const DepsgraphTimeline *timeline = timelines[pid];
+		timeline_json_escape(&name, timeline->name);
+		fprintf(f, "%s{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+		        "\"args\": {\"name\": \"%s\"}}",
+		        is_first ? "" : ",\n", pid, name.c_str());
+		is_first = false;
+		foreach (const DepsgraphTimelineEvent &event, timeline->events) {
+			timeline_json_escape(&name, event.name);
+			timeline_json_escape(&id_name, event.id_name);
+			timeline_json_escape(&component_name, event.component_name);
+			fprintf(f, ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", "
+			        "\"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d, "
+			        "\"args\": {\"id\": \"%s\", \"component\": \"%s\"}}",
+			        name.c_str(),
+			        event.id_name.empty() ? "evaluation" : "operation",
+			        timeline_trace_time(event.start_time, base_time),
+			        (event.end_time - event.start_time) * 1e6,
+			        pid,
+			        event.thread_id,
+			        id_name.c_str(),
+			        component_name.c_str());
+		}
+	}
+	fprintf(f, "\n]}\n");
+}
+
+}  // namespace
+
+DepsgraphTimelineRecorder::DepsgraphTimelineRecorder(int num_threads)
+        : start_time(PIL_check_seconds_timer()),
+          thread_records(num_threads)
+{
+}
+
+DepsgraphTimeline::DepsgraphTimeline(const string &name)
+        : name(name),
+          start_time(PIL_check_seconds_timer())
+{
+}
+
+void deg_eval_timeline_begin(Depsgraph *graph)
+{
+	deg_eval_timeline_end(graph);
+	graph->timeline = OBJECT_GUARDED_NEW(DepsgraphTimeline, graph->debug_name);
+}
+
+void deg_eval_timeline_end(Depsgraph *graph)
+{
+	if (graph->timeline != NULL) {
+		OBJECT_GUARDED_DELETE(graph->timeline, DepsgraphTimeline);
+		graph->timeline = NULL;
+	}
+}
+
+bool deg_eval_timeline_is_enabled(const Depsgraph *graph)
+{
+	return graph->timeline != NULL || trace_filepath != NULL;
+}
+
+void deg_eval_timeline_store(Depsgraph *graph,
+                             const DepsgraphTimelineRecorder &recorder,
+                             double end_time)
+{
+	vector<DepsgraphTimelineEvent> events;
+	/* Whole evaluation, shown on the thread which started it. */
+	DepsgraphTimelineEvent evaluation_event;
+	evaluation_event.name = "Evaluation";
+	evaluation_event.start_time = recorder.start_time;
+	evaluation_event.end_time = end_time;
+	evaluation_event.thread_id = 0;
+	events.push_back(evaluation_event);
+	for (int thread_id = 0;
+	     thread_id < (int)recorder.thread_records.size();
+	     thread_id++)
+	{
+		foreach (const DepsgraphTimelineRecord &record,
+		         recorder.thread_records[thread_id])
+		{
+			const OperationDepsNode *op_node = record.node;
+			const ComponentDepsNode *comp_node = op_node->owner;
+			const IDDepsNode *id_node = comp_node->owner;
+			DepsgraphTimelineEvent event;
+			event.name = op_node->identifier();
+			event.id_name = id_node->id_orig->name;
+			event.component_name = comp_node->identifier();
+			event.start_time = record.start_time;
+			event.end_time = record.end_time;
+			event.thread_id = thread_id;
+			events.push_back(event);
+		}
+	}
+	if (graph->timeline != NULL) {
+		graph->timeline->events.insert(graph->timeline->events.end(),
+		                               events.begin(),
+		                               events.end());
+	}
+	if (trace_filepath != NULL) {
+		BLI_mutex_lock(&trace_mutex);
+		if (graph->trace_timeline == NULL) {
+			string name = graph->debug_name;
+			if (name.empty()) {
+				char buf[64];
+				BLI_snprintf(buf, sizeof(buf), "Depsgraph %d",
+				             (int)trace_timelines.size());
+				name = buf;
+			}
+			graph->trace_timeline = OBJECT_GUARDED_NEW(DepsgraphTimeline, name);
+			trace_timelines.push_back(graph->trace_timeline);
+		}
+		graph->trace_timeline->events.insert(
+		        graph->trace_timeline->events.end(),
+		        events.begin(),
+		        events.end());
+		BLI_mutex_unlock(&trace_mutex);
+	}
+}
+
+void deg_eval_timeline_write_trace(FILE *f, const Depsgraph *graph)
+{
+	vector<const DepsgraphTimeline *> timelines;
+	if (graph->timeline != NULL) {
+		timelines.push_back(graph->timeline);
+	}
+	timeline_write_trace(f, timelines);
+}
+
+void deg_eval_timeline_trace_file_set(const char *filepath)
+{
+	BLI_mutex_lock(&trace_mutex);
+	MEM_SAFE_FREE(trace_filepath);
+	if (filepath != NULL && filepath[0] != '\0') {
+		trace_filepath = BLI_strdup(filepath);
+	}
+	BLI_mutex_unlock(&trace_mutex);
+}
+
+bool deg_eval_timeline_trace_exit(void)
+{
+	bool success = true;
+	BLI_mutex_lock(&trace_mutex);
+	if (trace_filepath != NULL) {
+		FILE *f = BLI_fopen(trace_filepath, "w");
+		if (f != NULL) {
+			vector<const DepsgraphTimeline *> timelines(trace_timelines.begin(),
+			                                             trace_timelines.end());
+			timeline_write_trace(f, timelines);
+			fclose(f);
+			printf("Depsgraph trace written to '%s'.\n", trace_filepath);
+		}
+		else {
+			fprintf(stderr,
+			        "Error writing depsgraph trace to '%s'.\n",
+			        trace_filepath);
+			success = false;
+		}
+		MEM_freeN(trace_filepath);
+		trace_filepath = NULL;
+	}
+	foreach (DepsgraphTimeline *timeline, trace_timelines) {
+		OBJECT_GUARDED_DELETE(timeline, DepsgraphTimeline);
+	}
+	trace_timelines.clear();
+	BLI_mutex_unlock(&trace_mutex);
+	return success;
+}
+
+}  // namespace DEG
@@ -0,0 +1,115 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2018 Blender Foundation.
+ * All rights reserved.
+ *
+ * Contributor(s): None Yet
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+
+/** \file blender/depsgraph/intern/eval/deg_eval_timeline.h
+ *  \ingroup depsgraph
+ *
+ * Timeline of operations evaluation, for profiling thread utilization.
+ */
+
+#pragma once
+
+#include <cstdio>
+
+#include "intern/depsgraph_types.h"
+
+namespace DEG {
+
+struct Depsgraph;
+struct OperationDepsNode;
+
+/* Operation evaluated on a thread, as recorded during evaluation. */
+struct DepsgraphTimelineRecord {
+	const OperationDepsNode *node;
+	double start_time, end_time;
+};
+
+/* Records of all threads of a single evaluation, each thread only appends
+ * to its own records so no locking is needed.
+ */
+struct DepsgraphTimelineRecorder {
+	DepsgraphTimelineRecorder(int num_threads);
+
+	void record(const OperationDepsNode *node,
+	            const int thread_id,
+	            double start_time,
+	            double end_time)
+	{
+		DepsgraphTimelineRecord record = {node, start_time, end_time};
+		thread_records[thread_id].push_back(record);
+	}
+
+	double start_time;
+	vector<vector<DepsgraphTimelineRecord> > thread_records;
+};
+
+struct DepsgraphTimelineEvent {
+	/* Operation identifier, or a description of the whole evaluation. */
+	string name;
+	/* Names of the ID and component, empty for the whole evaluation. */
+	string id_name;
+	string component_name;
+	/* Seconds, as given by PIL_check_seconds_timer(). */
+	double start_time, end_time;
+	int thread_id;
+};
+
+/* Events of all evaluations since recording started. */
+struct DepsgraphTimeline {
+	DepsgraphTimeline(const string &name);
+
+	/* Name of the graph, shown as a process in the trace. */
+	string name;
+	double start_time;
+	vector<DepsgraphTimelineEvent> events;
+};
+
+/* Start recording the graph's timeline, clearing anything recorded before. */
+void deg_eval_timeline_begin(Depsgraph *graph);
+void deg_eval_timeline_end(Depsgraph *graph);
+
+/* Check whether evaluation of the graph is to be recorded. */
+bool deg_eval_timeline_is_enabled(const Depsgraph *graph);
+
+/* Resolve records of finished evaluation to events, storing them in the
+ * graph's timeline and in the global trace.
+ */
+void deg_eval_timeline_store(Depsgraph *graph,
+                             const DepsgraphTimelineRecorder &recorder,
+                             double end_time);
+
+/* Write events as Chrome trace event JSON, which can be loaded in
+ * chrome://tracing or similar viewers.
+ */
+void deg_eval_timeline_write_trace(FILE *f, const Depsgraph *graph);
+
+/* Global trace, gathering events of all graphs. It is written and freed on
+ * exit, after all graphs are freed.
+ */
+void deg_eval_timeline_trace_file_set(const char *filepath);
+bool deg_eval_timeline_trace_exit(void);
+
+}  // namespace DEG
@@ -71,6 +71,7 @@ DepsNode::Stats::Stats()
 void DepsNode::Stats::reset()
 {
 	current_time = 0.0;
+	average_time = 0.0;
 }
 
 void DepsNode::Stats::reset_current()
@@ -68,6 +68,10 @@ struct DepsNode {
 		void reset_current();
 		/* Time spend on this node during current graph evaluation. */
 		double current_time;
+		/* Smoothed time spent on this node over previous evaluations, used
+		 * as an estimate of the node's cost when scheduling operations.
+		 */
+		double average_time;
 	};
 	/* Relationships between nodes
 	 * The reason why all depsgraph nodes are descended from this type (apart
@@ -78,6 +78,11 @@ struct OperationDepsNode : public DepsNode {
 	uint32_t num_links_pending;
 	bool scheduled;
 
+	/* Estimated time of the longest chain of operations starting with this
+	 * one, the most critical operations are scheduled first.
+	 */
+	double critical_path;
+
 	/* Identifier for the operation being performed. */
 	eDepsOperation_Code opcode;
 
@@ -153,4 +153,51 @@ void DRW_deferred_shader_remove(struct GPUMaterial *mat);
 struct DrawDataList *DRW_drawdatalist_from_id(struct ID *id);
 void DRW_drawdata_free(struct ID *id);
 
+/* CPU profiler (see draw_manager_profiling.c) */
+#define DRW_PROFILER_ENGINES_MAX 8
+#define DRW_PROFILER_OBJECTS_MAX 16
+
+typedef enum eDRWProfilerStage {
+	DRW_PROFILER_CACHE_INIT = 0,
+	DRW_PROFILER_CACHE_POPULATE,
+	DRW_PROFILER_CACHE_FINISH,
+	DRW_PROFILER_DRAW_BACKGROUND,
+	DRW_PROFILER_DRAW_SCENE,
+} eDRWProfilerStage;
+#define DRW_PROFILER_STAGE_LEN (DRW_PROFILER_DRAW_SCENE + 1)
+
+typedef struct DRWProfilerEngine {
+	char idname[32];
+	double stage_time[DRW_PROFILER_STAGE_LEN]; /* In milliseconds. */
+	int draw_calls;
+} DRWProfilerEngine;
+
+typedef struct DRWProfilerObject {
+	char name[66]; /* MAX_ID_NAME */
+	/* cache_populate of all engines, including the batch cache (re)creation, in milliseconds. */
+	double time;
+} DRWProfilerObject;
+
+typedef struct DRWProfilerFrame {
+	int id;             /* Incremented for every recorded frame. */
+	double total_time;  /* In milliseconds. */
+	int objects_len;    /* Number of populated objects. */
+	int draw_calls;
+	int occluded_calls; /* Skipped by occlusion culling. */
+	int instanced_calls; /* Merged into instanced draw calls (each counted once in draw_calls). */
+	/* Culling and matrices of call states evaluated in parallel before drawing passes. */
+	double call_states_time; /* In milliseconds. */
+	int call_states;
+	DRWProfilerEngine engines[DRW_PROFILER_ENGINES_MAX];
+	int engines_len;
+	DRWProfilerObject slowest_objects[DRW_PROFILER_OBJECTS_MAX]; /* Slowest first. */
+	int slowest_objects_len;
+} DRWProfilerFrame;
+
+void DRW_profiler_enable(bool enable);
+bool DRW_profiler_is_enabled(void);
+const char *DRW_profiler_stage_name(eDRWProfilerStage stage);
+const DRWProfilerFrame *DRW_profiler_frame_get(void);
+bool DRW_profiler_write_json(const char *filepath);
+
 #endif /* __DRW_ENGINE_H__ */
@@ -8,6 +8,20 @@ uniform mat3 NormalMatrix;
 in vec3 pos;
 in vec3 nor;
 in vec2 uv;
+
+/* Matrices of consecutive calls drawing the same batch (e.g. linked duplicates),
+ * drawn with a single instanced draw call by the draw manager.
+ * Array size is DRW_INSTANCED_CALLS_MAX. */
+struct DRWInstancedCall {
+	mat4 ModelViewProjectionMatrix;
+	mat4 NormalMatrix;
+};
+
+layout(std140) uniform drwInstancedCallsBlock {
+	DRWInstancedCall drwInstancedCallsData[128];
+};
+
+uniform bool drwInstancedCalls = false;
 #else /* HAIR_SHADER */
 #  ifdef V3D_SHADING_TEXTURE_COLOR
 uniform samplerBuffer u; /* active texture layer */
@@ -52,15 +66,22 @@ void main()
 	float sin_theta = sqrt(max(0.0, 1.0f - cos_theta*cos_theta));
 	nor = nor * sin_theta + binor * cos_theta;
 	gl_Position = ViewProjectionMatrix * vec4(pos, 1.0);
+	mat3 normal_matrix = NormalMatrix;
 #else
-	gl_Position = ModelViewProjectionMatrix * vec4(pos, 1.0);
+	mat4 model_view_projection = ModelViewProjectionMatrix;
+	mat3 normal_matrix = NormalMatrix;
+	if (drwInstancedCalls) {
+		model_view_projection = drwInstancedCallsData[gl_InstanceID].ModelViewProjectionMatrix;
+		normal_matrix = mat3(drwInstancedCallsData[gl_InstanceID].NormalMatrix);
+	}
+	gl_Position = model_view_projection * vec4(pos, 1.0);
 #endif
 #ifdef V3D_SHADING_TEXTURE_COLOR
 	uv_interp = uv;
 #endif
 
 #ifdef NORMAL_VIEWPORT_PASS_ENABLED
-	normal_viewport = NormalMatrix * nor;
+	normal_viewport = normal_matrix * nor;
 #  ifndef HAIR_SHADER
 	normal_viewport = normalize(normal_viewport);
 #  endif
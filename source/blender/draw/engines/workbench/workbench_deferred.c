@@ -417,8 +417,10 @@ void workbench_deferred_engine_init(WORKBENCH_Data *vedata)
 		const bool do_cull = (draw_ctx->v3d && (draw_ctx->v3d->flag2 & V3D_BACKFACE_CULLING));
 
 		int state = DRW_STATE_WRITE_COLOR | DRW_STATE_WRITE_DEPTH | DRW_STATE_DEPTH_LESS_EQUAL;
-		psl->prepass_pass = DRW_pass_create("Prepass", (do_cull) ? state | DRW_STATE_CULL_BACK : state);
-		psl->prepass_hair_pass = DRW_pass_create("Prepass", state);
+		/* Drawn in the scene depth, objects behind the occluders can be skipped. */
+		const int occlusion_state = state | DRW_STATE_OCCLUSION_CULL;
+		psl->prepass_pass = DRW_pass_create("Prepass", (do_cull) ? occlusion_state | DRW_STATE_CULL_BACK : occlusion_state);
+		psl->prepass_hair_pass = DRW_pass_create("Prepass", occlusion_state);
 
 		psl->ghost_prepass_pass = DRW_pass_create("Prepass Ghost", (do_cull) ? state | DRW_STATE_CULL_BACK : state);
 		psl->ghost_prepass_hair_pass = DRW_pass_create("Prepass Ghost", state);
@@ -738,7 +740,7 @@ void workbench_deferred_solid_cache_populate(WORKBENCH_Data *vedata, Object *ob)
 		if (!is_drawn) {
 			if (ELEM(wpd->shading.color_type, V3D_SHADING_SINGLE_COLOR, V3D_SHADING_RANDOM_COLOR)) {
 				/* No material split needed */
-				struct GPUBatch *geom = DRW_cache_object_surface_get(ob);
+				struct GPUBatch *geom = DRW_cache_object_surface_lod_get(ob);
 				if (geom) {
 					material = get_or_create_material_data(vedata, ob, NULL, NULL, wpd->shading.color_type);
 					if (is_sculpt_mode) {
@@ -32,16 +32,21 @@
 #include "DNA_particle_types.h"
 #include "DNA_modifier_types.h"
 #include "DNA_lattice_types.h"
+#include "DNA_userdef_types.h"
 
 #include "UI_resources.h"
 
 #include "BLI_utildefines.h"
 #include "BLI_math.h"
 
+#include "BKE_object.h"
+
 #include "GPU_batch.h"
 #include "GPU_batch_presets.h"
 #include "GPU_batch_utils.h"
 
+#include "DRW_render.h"
+
 #include "draw_cache.h"
 #include "draw_cache_impl.h"
 
@@ -727,6 +732,28 @@ GPUBatch *DRW_cache_object_surface_get(Object *ob)
 	}
 }
 
+/* Same as #DRW_cache_object_surface_get, using a simplified surface
+ * for heavy meshes covering few pixels on screen when enabled. */
+GPUBatch *DRW_cache_object_surface_lod_get(Object *ob)
+{
+	if ((ob->type == OB_MESH) && (U.uiflag2 & USER_GPU_MESH_LOD)) {
+		BoundSphere bsphere;
+		float corner[3];
+		BoundBox *bbox = BKE_object_boundbox_get(ob);
+		mid_v3_v3v3(bsphere.center, bbox->vec[0], bbox->vec[6]);
+		mul_v3_m4v3(corner, ob->obmat, bbox->vec[0]);
+		mul_m4_v3(ob->obmat, bsphere.center);
+		bsphere.radius = len_v3v3(bsphere.center, corner);
+
+		GPUBatch *geom = DRW_mesh_batch_cache_get_triangles_with_normals_lod(
+		        ob->data, DRW_viewport_sphere_pixel_size_get(&bsphere));
+		if (geom) {
+			return geom;
+		}
+	}
+	return DRW_cache_object_surface_get(ob);
+}
+
 GPUBatch **DRW_cache_object_surface_material_get(
         struct Object *ob, struct GPUMaterial **gpumat_array, uint gpumat_array_len,
         char **auto_layer_names, int **auto_layer_is_srgb, int *auto_layer_count)
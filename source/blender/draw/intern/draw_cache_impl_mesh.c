@@ -37,6 +37,9 @@
 #include "BLI_string.h"
 #include "BLI_alloca.h"
 #include "BLI_edgehash.h"
+#include "BLI_task.h"
+#include "BLI_ghash.h"
+#include "BLI_quadric.h"
 
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
@@ -48,8 +51,11 @@
 #include "BKE_editmesh_tangent.h"
 #include "BKE_mesh.h"
 #include "BKE_mesh_tangent.h"
+#include "BKE_mesh_runtime.h"
 #include "BKE_colorband.h"
 
+#include "atomic_ops.h"
+
 #include "bmesh.h"
 
 #include "GPU_batch.h"
@@ -1540,6 +1546,348 @@ static void add_overlay_loose_vert(
 /** \} */
 
 
+/* ---------------------------------------------------------------------- */
+
+/** \name Mesh Level of Detail
+ *
+ * Simplified surfaces for heavy meshes covering few pixels on screen.
+ * Vertices are clustered on a grid (one grid resolution per level), each cluster is moved
+ * to the position minimizing the quadric error of the faces around it and triangles
+ * collapsing into less than 3 clusters are dropped.
+ *
+ * Levels are generated by a background task working on a copy of the mesh data,
+ * GPU buffers are created by the drawing thread once the task is done.
+ * The copy is only made once the batch cache has been kept for a few redraws,
+ * and the task checks for cancellation in all its loops since freeing the cache waits for it.
+ * \{ */
+
+#define MESH_LOD_LEVELS 3
+/* Meshes with less triangles are always drawn at full resolution. */
+#define MESH_LOD_TRI_MIN 50000
+/* A level is used as long as its grid cells cover less pixels than this on screen. */
+#define MESH_LOD_CELL_PIXELS 2.0f
+/* Redraws the batch cache must survive before generating levels, so meshes being edited
+ * or animated (rebuilt on every redraw) never pay for copying their data to the task. */
+#define MESH_LOD_STABLE_REDRAWS 8
+
+/* Grid resolution along the largest dimension of the bounding box, from finest to coarsest.
+ * Must stay under 128 so cluster indices fit in 21 bits (see: mesh_lod_level_build). */
+static const int mesh_lod_grid_res[MESH_LOD_LEVELS] = {128, 48, 16};
+
+typedef struct MeshLODLevel {
+	float (*co)[3];
+	GPUPackedNormal *nor;
+	uint (*tris)[3];
+	int vert_len;
+	int tri_len;
+} MeshLODLevel;
+
+typedef struct MeshLODJob {
+	TaskPool *pool;
+
+	/* Copied from the mesh, so the task never reads data the mesh owns. */
+	float (*vert_co)[3];
+	uint (*tri_verts)[3];
+	int vert_len;
+	int tri_len;
+	float min[3], max[3];
+
+	MeshLODLevel levels[MESH_LOD_LEVELS];
+	int32_t is_done; /* Atomic, set by the task once all levels are written. */
+} MeshLODJob;
+
+typedef struct MeshLODCluster {
+	Quadric quadric;
+	double co_sum[3];
+	float nor[3];
+	float area;
+	int vert_len;
+	int cell[3];
+} MeshLODCluster;
+
+typedef struct MeshLODTri {
+	uint64_t key; /* Sorted cluster indices, to remove duplicates. */
+	uint tri[3];
+} MeshLODTri;
+
+static int mesh_lod_tri_cmp(const void *a_v, const void *b_v)
+{
+	const uint64_t a = ((const MeshLODTri *)a_v)->key;
+	const uint64_t b = ((const MeshLODTri *)b_v)->key;
+	return (a < b) ? -1 : (a > b);
+}
+
+static void mesh_lod_level_free(MeshLODLevel *level)
+{
+	MEM_SAFE_FREE(level->co);
+	MEM_SAFE_FREE(level->nor);
+	MEM_SAFE_FREE(level->tris);
+	level->vert_len = level->tri_len = 0;
+}
+
+/* Returns false when canceled. */
+static bool mesh_lod_level_build(TaskPool *pool, const MeshLODJob *job, const int grid_res, MeshLODLevel *level)
+{
+	float size[3];
+	sub_v3_v3v3(size, job->max, job->min);
+	const float cell_size = max_fff(size[0], size[1], size[2]) / (float)grid_res;
+	if (cell_size <= 0.0f) {
+		return true;
+	}
+
+	int dims[3];
+	for (int i = 0; i < 3; i++) {
+		dims[i] = min_ii((int)(size[i] / cell_size) + 1, grid_res);
+	}
+
+	/* Vertices to clusters, positions are converted to grid space (one unit per cell). */
+	float (*grid_co)[3] = MEM_mallocN(sizeof(*grid_co) * job->vert_len, __func__);
+	uint *vert_cluster = MEM_mallocN(sizeof(*vert_cluster) * job->vert_len, __func__);
+	GHash *cell_cluster = BLI_ghash_int_new(__func__);
+	MeshLODCluster *clusters = NULL;
+	MeshLODTri *lod_tris = NULL;
+	int cluster_len = 0;
+
+	for (int v = 0; v < job->vert_len; v++) {
+		if ((v & 0xFFFF) == 0 && BLI_task_pool_canceled(pool)) {
+			BLI_ghash_free(cell_cluster, NULL, NULL);
+			goto finally;
+		}
+		int cell[3];
+		sub_v3_v3v3(grid_co[v], job->vert_co[v], job->min);
+		mul_v3_fl(grid_co[v], 1.0f / cell_size);
+		for (int i = 0; i < 3; i++) {
+			cell[i] = clamp_i((int)grid_co[v][i], 0, dims[i] - 1);
+		}
+		const int cell_index = cell[0] + dims[0] * (cell[1] + dims[1] * cell[2]);
+		void **val;
+		if (!BLI_ghash_ensure_p(cell_cluster, SET_INT_IN_POINTER(cell_index), &val)) {
+			*val = SET_INT_IN_POINTER(cluster_len++);
+		}
+		vert_cluster[v] = (uint)GET_INT_FROM_POINTER(*val);
+	}
+	BLI_ghash_free(cell_cluster, NULL, NULL);
+
+	if (BLI_task_pool_canceled(pool)) {
+		goto finally;
+	}
+
+	clusters = MEM_callocN(sizeof(*clusters) * cluster_len, __func__);
+	for (int v = 0; v < job->vert_len; v++) {
+		if ((v & 0xFFFF) == 0 && BLI_task_pool_canceled(pool)) {
+			goto finally;
+		}
+		MeshLODCluster *cluster = &clusters[vert_cluster[v]];
+		if (cluster->vert_len++ == 0) {
+			for (int i = 0; i < 3; i++) {
+				cluster->cell[i] = clamp_i((int)grid_co[v][i], 0, dims[i] - 1);
+			}
+		}
+		for (int i = 0; i < 3; i++) {
+			cluster->co_sum[i] += grid_co[v][i];
+		}
+	}
+
+	/* Accumulate the area weighted face quadrics & normals of each cluster,
+	 * keep the triangles spanning 3 different clusters. */
+	lod_tris = MEM_mallocN(sizeof(*lod_tris) * job->tri_len, __func__);
+	int lod_tri_len = 0;
+
+	for (int t = 0; t < job->tri_len; t++) {
+		if ((t & 0xFFFF) == 0 && BLI_task_pool_canceled(pool)) {
+			goto finally;
+		}
+		const uint *tri = job->tri_verts[t];
+		float nor[3];
+		const float area = normal_tri_v3(nor, grid_co[tri[0]], grid_co[tri[1]], grid_co[tri[2]]);
+		if (area > 0.0f) {
+			const double plane[4] = {nor[0], nor[1], nor[2], -dot_v3v3(nor, grid_co[tri[0]])};
+			Quadric quadric;
+			BLI_quadric_from_plane(&quadric, plane);
+			BLI_quadric_mul(&quadric, area);
+			for (int i = 0; i < 3; i++) {
+				MeshLODCluster *cluster = &clusters[vert_cluster[tri[i]]];
+				BLI_quadric_add_qu_qu(&cluster->quadric, &quadric);
+				madd_v3_v3fl(cluster->nor, nor, area);
+				cluster->area += area;
+			}
+		}
+
+		uint c[3] = {vert_cluster[tri[0]], vert_cluster[tri[1]], vert_cluster[tri[2]]};
+		if (c[0] == c[1] || c[1] == c[2] || c[2] == c[0]) {
+			continue;
+		}
+		MeshLODTri *lod_tri = &lod_tris[lod_tri_len++];
+		memcpy(lod_tri->tri, c, sizeof(lod_tri->tri));
+		if (c[0] > c[1]) { SWAP(uint, c[0], c[1]); }
+		if (c[1] > c[2]) { SWAP(uint, c[1], c[2]); }
+		if (c[0] > c[1]) { SWAP(uint, c[0], c[1]); }
+		lod_tri->key = ((uint64_t)c[0] << 42) | ((uint64_t)c[1] << 21) | (uint64_t)c[2];
+	}
+
+	if (BLI_task_pool_canceled(pool)) {
+		goto finally;
+	}
+	qsort(lod_tris, lod_tri_len, sizeof(*lod_tris), mesh_lod_tri_cmp);
+	if (BLI_task_pool_canceled(pool)) {
+		goto finally;
+	}
+
+	level->tris = MEM_mallocN(sizeof(*level->tris) * max_ii(lod_tri_len, 1), __func__);
+	for (int t = 0; t < lod_tri_len; t++) {
+		if ((t & 0xFFFF) == 0 && BLI_task_pool_canceled(pool)) {
+			goto finally;
+		}
+		if (t == 0 || lod_tris[t].key != lod_tris[t - 1].key) {
+			memcpy(level->tris[level->tri_len++], lod_tris[t].tri, sizeof(*level->tris));
+		}
+	}
+
+	/* Place clusters, falling back to the average position when the optimal one
+	 * is undefined (flat or straight regions) or outside of the cell. */
+	level->vert_len = cluster_len;
+	level->co = MEM_mallocN(sizeof(*level->co) * cluster_len, __func__);
+	level->nor = MEM_mallocN(sizeof(*level->nor) * cluster_len, __func__);
+
+	for (int i = 0; i < cluster_len; i++) {
+		if ((i & 0xFFFF) == 0 && BLI_task_pool_canceled(pool)) {
+			goto finally;
+		}
+		MeshLODCluster *cluster = &clusters[i];
+		double co[3];
+		bool use_optimal = false;
+
+		if (cluster->area > 0.0f) {
+			BLI_quadric_mul(&cluster->quadric, 1.0 / cluster->area);
+			if (BLI_quadric_optimize(&cluster->quadric, co, 1e-4)) {
+				use_optimal = true;
+				for (int j = 0; j < 3; j++) {
+					if (co[j] < cluster->cell[j] || co[j] > cluster->cell[j] + 1) {
+						use_optimal = false;
+					}
+				}
+			}
+		}
+		if (!use_optimal) {
+			for (int j = 0; j < 3; j++) {
+				co[j] = cluster->co_sum[j] / cluster->vert_len;
+			}
+		}
+
+		copy_v3fl_v3db(level->co[i], co);
+		madd_v3_v3v3fl(level->co[i], job->min, level->co[i], cell_size);
+
+		normalize_v3(cluster->nor);
+		level->nor[i] = GPU_normal_convert_i10_v3(cluster->nor);
+	}
+
+finally:
+	MEM_freeN(grid_co);
+	MEM_freeN(vert_cluster);
+	MEM_SAFE_FREE(clusters);
+	MEM_SAFE_FREE(lod_tris);
+
+	return !BLI_task_pool_canceled(pool);
+}
+
+static void mesh_lod_job_run(TaskPool *__restrict pool, void *taskdata, int UNUSED(threadid))
+{
+	MeshLODJob *job = taskdata;
+	int tri_len_prev = job->tri_len;
+
+	for (int i = 0; i < MESH_LOD_LEVELS; i++) {
+		MeshLODLevel *level = &job->levels[i];
+		if (!mesh_lod_level_build(pool, job, mesh_lod_grid_res[i], level)) {
+			return;
+		}
+		/* Not worth drawing, a finer level will be used instead. */
+		if (level->tri_len == 0 || level->tri_len > tri_len_prev / 2) {
+			mesh_lod_level_free(level);
+			continue;
+		}
+		tri_len_prev = level->tri_len;
+	}
+
+	MEM_SAFE_FREE(job->vert_co);
+	MEM_SAFE_FREE(job->tri_verts);
+
+	atomic_add_and_fetch_int32(&job->is_done, 1);
+}
+
+static MeshLODJob *mesh_lod_job_create(Mesh *me)
+{
+	const MLoopTri *mlooptri = BKE_mesh_runtime_looptri_ensure(me);
+	MeshLODJob *job = MEM_callocN(sizeof(*job), __func__);
+
+	job->vert_len = me->totvert;
+	job->tri_len = BKE_mesh_runtime_looptri_len(me);
+	job->vert_co = MEM_mallocN(sizeof(*job->vert_co) * job->vert_len, __func__);
+	job->tri_verts = MEM_mallocN(sizeof(*job->tri_verts) * job->tri_len, __func__);
+
+	INIT_MINMAX(job->min, job->max);
+	for (int i = 0; i < job->vert_len; i++) {
+		copy_v3_v3(job->vert_co[i], me->mvert[i].co);
+		minmax_v3v3_v3(job->min, job->max, job->vert_co[i]);
+	}
+	for (int i = 0; i < job->tri_len; i++) {
+		for (int j = 0; j < 3; j++) {
+			job->tri_verts[i][j] = me->mloop[mlooptri[i].tri[j]].v;
+		}
+	}
+
+	job->pool = BLI_task_pool_create_background(BLI_task_scheduler_get(), job);
+	BLI_task_pool_push(job->pool, mesh_lod_job_run, job, false, TASK_PRIORITY_LOW);
+
+	return job;
+}
+
+static bool mesh_lod_job_is_done(MeshLODJob *job)
+{
+	return atomic_add_and_fetch_int32(&job->is_done, 0) != 0;
+}
+
+static void mesh_lod_job_free(MeshLODJob *job)
+{
+	/* Cancels and waits for the task if it is still running. */
+	BLI_task_pool_free(job->pool);
+
+	for (int i = 0; i < MESH_LOD_LEVELS; i++) {
+		mesh_lod_level_free(&job->levels[i]);
+	}
+	MEM_SAFE_FREE(job->vert_co);
+	MEM_SAFE_FREE(job->tri_verts);
+	MEM_freeN(job);
+}
+
+static GPUBatch *mesh_lod_level_batch_create(const MeshLODLevel *level)
+{
+	/* Same attributes as 'triangles_with_normals', so the same shaders can draw it. */
+	static GPUVertFormat format = { 0 };
+	static struct { uint pos, nor; } attr_id;
+	if (format.attr_len == 0) {
+		attr_id.pos = GPU_vertformat_attr_add(&format, "pos", GPU_COMP_F32, 3, GPU_FETCH_FLOAT);
+		attr_id.nor = GPU_vertformat_attr_add(&format, "nor", GPU_COMP_I10, 3, GPU_FETCH_INT_TO_FLOAT_UNIT);
+	}
+
+	GPUVertBuf *vbo = GPU_vertbuf_create_with_format(&format);
+	GPU_vertbuf_data_alloc(vbo, level->vert_len);
+	GPU_vertbuf_attr_fill(vbo, attr_id.pos, level->co);
+	GPU_vertbuf_attr_fill(vbo, attr_id.nor, level->nor);
+
+	GPUIndexBufBuilder elb;
+	GPU_indexbuf_init(&elb, GPU_PRIM_TRIS, level->tri_len, level->vert_len);
+	for (int i = 0; i < level->tri_len; i++) {
+		GPU_indexbuf_add_tri_verts(&elb, UNPACK3(level->tris[i]));
+	}
+
+	return GPU_batch_create_ex(
+	        GPU_PRIM_TRIS, vbo, GPU_indexbuf_build(&elb),
+	        GPU_BATCH_OWNS_VBO | GPU_BATCH_OWNS_INDEX);
+}
+
+/** \} */
+
+
 /* ---------------------------------------------------------------------- */
 
 /** \name Mesh GPUBatch Cache
@@ -1654,6 +2002,12 @@ typedef struct MeshBatchCache {
 
 	/* Valid only if edges_adjacency is up to date. */
 	bool is_manifold;
+
+	/* Simplified 'triangles_with_normals', levels are NULL when not worth drawing. */
+	MeshLODJob *lod_job;
+	GPUBatch *triangles_with_normals_lod[MESH_LOD_LEVELS];
+	int lod_stable_redraws;
+	bool is_lod_ready;
 } MeshBatchCache;
 
 /* GPUBatch cache management. */
@@ -1777,6 +2131,19 @@ void DRW_mesh_batch_cache_dirty_tag(Mesh *me, int mode)
 	}
 }
 
+static void mesh_batch_cache_clear_lod(MeshBatchCache *cache)
+{
+	if (cache->lod_job) {
+		mesh_lod_job_free(cache->lod_job);
+		cache->lod_job = NULL;
+	}
+	for (int i = 0; i < MESH_LOD_LEVELS; i++) {
+		GPU_BATCH_DISCARD_SAFE(cache->triangles_with_normals_lod[i]);
+	}
+	cache->lod_stable_redraws = 0;
+	cache->is_lod_ready = false;
+}
+
 /**
  * This only clear the batches associated to the given vertex buffer.
  **/
@@ -1791,6 +2158,7 @@ static void mesh_batch_cache_clear_selective(Mesh *me, GPUVertBuf *vert)
 
 	if (cache->pos_with_normals == vert) {
 		GPU_BATCH_DISCARD_SAFE(cache->triangles_with_normals);
+		mesh_batch_cache_clear_lod(cache);
 		GPU_BATCH_DISCARD_SAFE(cache->triangles_with_weights);
 		GPU_BATCH_DISCARD_SAFE(cache->triangles_with_vert_colors);
 		GPU_BATCH_DISCARD_SAFE(cache->triangles_with_select_id);
@@ -1906,6 +2274,7 @@ static void mesh_batch_cache_clear(Mesh *me)
 
 	GPU_BATCH_DISCARD_SAFE(cache->texpaint_triangles_single);
 
+	mesh_batch_cache_clear_lod(cache);
 }
 
 void DRW_mesh_batch_cache_free(Mesh *me)
@@ -2216,139 +2585,193 @@ static GPUVertBuf *mesh_batch_cache_get_tri_uv_active(
 	return cache->tri_aligned_uv;
 }
 
-static GPUVertBuf *mesh_batch_cache_get_tri_pos_and_normals_ex(
-        MeshRenderData *rdata, const bool use_hide,
-        GPUVertBuf **r_vbo)
+typedef struct TriPosNorExtractData {
+	MeshRenderData *rdata;
+	/* Index of the first output triangle for each looptri, -1 for skipped ones.
+	 * NULL when no looptri is skipped. */
+	int *tri_offset;
+	GPUVertBufRaw pos_step, nor_step;
+} TriPosNorExtractData;
+
+BLI_INLINE void *tri_pos_nor_raw_elem(const GPUVertBufRaw *raw, const int vidx)
 {
-	BLI_assert(rdata->types & (MR_DATATYPE_VERT | MR_DATATYPE_LOOPTRI | MR_DATATYPE_LOOP | MR_DATATYPE_POLY));
+	return raw->data_init + (size_t)vidx * raw->stride;
+}
 
-	if (*r_vbo == NULL) {
-		static GPUVertFormat format = { 0 };
-		static struct { uint pos, nor; } attr_id;
-		if (format.attr_len == 0) {
-			attr_id.pos = GPU_vertformat_attr_add(&format, "pos", GPU_COMP_F32, 3, GPU_FETCH_FLOAT);
-			attr_id.nor = GPU_vertformat_attr_add(&format, "nor", GPU_COMP_I10, 3, GPU_FETCH_INT_TO_FLOAT_UNIT);
-		}
+static void mesh_extract_tri_pos_and_normals_bmesh_cb(
+        void *__restrict userdata,
+        const int i,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	const TriPosNorExtractData *data = userdata;
+	const MeshRenderData *rdata = data->rdata;
+	const int tri_dst = data->tri_offset ? data->tri_offset[i] : i;
 
-		const int tri_len = mesh_render_data_looptri_len_get(rdata);
+	if (tri_dst == -1) {
+		return;
+	}
 
-		GPUVertBuf *vbo = *r_vbo = GPU_vertbuf_create_with_format(&format);
+	const BMLoop **bm_looptri = (const BMLoop **)rdata->edit_bmesh->looptris[i];
+	const BMFace *bm_face = bm_looptri[0]->f;
+	const float (*lnors)[3] = (const float (*)[3])rdata->loop_normals;
 
-		const int vbo_len_capacity = tri_len * 3;
-		int vbo_len_used = 0;
-		GPU_vertbuf_data_alloc(vbo, vbo_len_capacity);
+	for (uint t = 0; t < 3; t++) {
+		const int vidx = tri_dst * 3 + (int)t;
+		const int v_index = BM_elem_index_get(bm_looptri[t]->v);
+		GPUPackedNormal *nor = tri_pos_nor_raw_elem(&data->nor_step, vidx);
+		float *pos = tri_pos_nor_raw_elem(&data->pos_step, vidx);
 
-		GPUVertBufRaw pos_step, nor_step;
-		GPU_vertbuf_attr_get_raw_data(vbo, attr_id.pos, &pos_step);
-		GPU_vertbuf_attr_get_raw_data(vbo, attr_id.nor, &nor_step);
+		if (lnors) {
+			*nor = GPU_normal_convert_i10_v3(lnors[BM_elem_index_get(bm_looptri[t])]);
+		}
+		else if (BM_elem_flag_test(bm_face, BM_ELEM_SMOOTH)) {
+			*nor = rdata->vert_normals_pack[v_index];
+		}
+		else {
+			*nor = rdata->poly_normals_pack[BM_elem_index_get(bm_face)];
+		}
 
-		float (*lnors)[3] = rdata->loop_normals;
+		/* TODO(sybren): deduplicate this and all the other places it's pasted to in this file. */
+		if (rdata->edit_data && rdata->edit_data->vertexCos) {
+			copy_v3_v3(pos, rdata->edit_data->vertexCos[v_index]);
+		}
+		else {
+			copy_v3_v3(pos, bm_looptri[t]->v->co);
+		}
+	}
+}
 
-		if (rdata->edit_bmesh) {
-			GPUPackedNormal *pnors_pack, *vnors_pack;
+static void mesh_extract_tri_pos_and_normals_mesh_cb(
+        void *__restrict userdata,
+        const int i,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	const TriPosNorExtractData *data = userdata;
+	const MeshRenderData *rdata = data->rdata;
+	const int tri_dst = data->tri_offset ? data->tri_offset[i] : i;
 
-			if (lnors == NULL) {
-				mesh_render_data_ensure_poly_normals_pack(rdata);
-				mesh_render_data_ensure_vert_normals_pack(rdata);
+	if (tri_dst == -1) {
+		return;
+	}
 
-				pnors_pack = rdata->poly_normals_pack;
-				vnors_pack = rdata->vert_normals_pack;
-			}
+	const MLoopTri *mlt = &rdata->mlooptri[i];
+	const MPoly *mp = &rdata->mpoly[mlt->poly];
+	const float (*lnors)[3] = (const float (*)[3])rdata->loop_normals;
 
-			for (int i = 0; i < tri_len; i++) {
-				const BMLoop **bm_looptri = (const BMLoop **)rdata->edit_bmesh->looptris[i];
-				const BMFace *bm_face = bm_looptri[0]->f;
+	for (uint t = 0; t < 3; t++) {
+		const int vidx = tri_dst * 3 + (int)t;
+		const MVert *mv = &rdata->mvert[rdata->mloop[mlt->tri[t]].v];
+		GPUPackedNormal *nor = tri_pos_nor_raw_elem(&data->nor_step, vidx);
+		float *pos = tri_pos_nor_raw_elem(&data->pos_step, vidx);
 
-				/* use_hide always for edit-mode */
-				if (BM_elem_flag_test(bm_face, BM_ELEM_HIDDEN)) {
-					continue;
-				}
+		if (lnors) {
+			*nor = GPU_normal_convert_i10_v3(lnors[mlt->tri[t]]);
+		}
+		else if (mp->flag & ME_SMOOTH) {
+			*nor = GPU_normal_convert_i10_s3(mv->no);
+		}
+		else {
+			*nor = rdata->poly_normals_pack[mlt->poly];
+		}
 
-				if (lnors) {
-					for (uint t = 0; t < 3; t++) {
-						const float *nor = lnors[BM_elem_index_get(bm_looptri[t])];
-						*((GPUPackedNormal *)GPU_vertbuf_raw_step(&nor_step)) = GPU_normal_convert_i10_v3(nor);
-					}
-				}
-				else if (BM_elem_flag_test(bm_face, BM_ELEM_SMOOTH)) {
-					for (uint t = 0; t < 3; t++) {
-						*((GPUPackedNormal *)GPU_vertbuf_raw_step(&nor_step)) = vnors_pack[BM_elem_index_get(bm_looptri[t]->v)];
-					}
-				}
-				else {
-					const GPUPackedNormal *snor_pack = &pnors_pack[BM_elem_index_get(bm_face)];
-					for (uint t = 0; t < 3; t++) {
-						*((GPUPackedNormal *)GPU_vertbuf_raw_step(&nor_step)) = *snor_pack;
-					}
-				}
+		copy_v3_v3(pos, mv->co);
+	}
+}
 
-				/* TODO(sybren): deduplicate this and all the other places it's pasted to in this file. */
-				if (rdata->edit_data && rdata->edit_data->vertexCos) {
-					for (uint t = 0; t < 3; t++) {
-						int vidx = BM_elem_index_get(bm_looptri[t]->v);
-						const float *pos = rdata->edit_data->vertexCos[vidx];
-						copy_v3_v3(GPU_vertbuf_raw_step(&pos_step), pos);
-					}
-				}
-				else {
-					for (uint t = 0; t < 3; t++) {
-						copy_v3_v3(GPU_vertbuf_raw_step(&pos_step), bm_looptri[t]->v->co);
-					}
+/**
+ * Output offset of each looptri when some of them are hidden.
+ * Returns NULL when all triangles are drawn.
+ */
+static int *mesh_tri_offsets_visible(MeshRenderData *rdata, const bool use_hide, int *r_tri_len_used)
+{
+	const int tri_len = mesh_render_data_looptri_len_get(rdata);
+	int *tri_offset = NULL;
+	int tri_len_used = 0;
+
+	/* use_hide always for edit-mode */
+	if (rdata->edit_bmesh == NULL && !use_hide) {
+		*r_tri_len_used = tri_len;
+		return NULL;
+	}
+
+	for (int i = 0; i < tri_len; i++) {
+		bool is_hidden;
+		if (rdata->edit_bmesh) {
+			is_hidden = BM_elem_flag_test(rdata->edit_bmesh->looptris[i][0]->f, BM_ELEM_HIDDEN) != 0;
+		}
+		else {
+			is_hidden = (rdata->mpoly[rdata->mlooptri[i].poly].flag & ME_HIDE) != 0;
+		}
+
+		if (is_hidden) {
+			if (tri_offset == NULL) {
+				tri_offset = MEM_mallocN(sizeof(*tri_offset) * tri_len, __func__);
+				for (int j = 0; j < i; j++) {
+					tri_offset[j] = j;
 				}
 			}
+			tri_offset[i] = -1;
 		}
 		else {
-			if (lnors == NULL) {
-				/* Use normals from vertex. */
-				mesh_render_data_ensure_poly_normals_pack(rdata);
+			if (tri_offset) {
+				tri_offset[i] = tri_len_used;
 			}
+			tri_len_used++;
+		}
+	}
 
-			for (int i = 0; i < tri_len; i++) {
-				const MLoopTri *mlt = &rdata->mlooptri[i];
-				const MPoly *mp = &rdata->mpoly[mlt->poly];
+	*r_tri_len_used = tri_len_used;
+	return tri_offset;
+}
 
-				if (use_hide && (mp->flag & ME_HIDE)) {
-					continue;
-				}
+static GPUVertBuf *mesh_batch_cache_get_tri_pos_and_normals_ex(
+        MeshRenderData *rdata, const bool use_hide,
+        GPUVertBuf **r_vbo)
+{
+	BLI_assert(rdata->types & (MR_DATATYPE_VERT | MR_DATATYPE_LOOPTRI | MR_DATATYPE_LOOP | MR_DATATYPE_POLY));
 
-				const uint vtri[3] = {
-					rdata->mloop[mlt->tri[0]].v,
-					rdata->mloop[mlt->tri[1]].v,
-					rdata->mloop[mlt->tri[2]].v,
-				};
+	if (*r_vbo == NULL) {
+		static GPUVertFormat format = { 0 };
+		static struct { uint pos, nor; } attr_id;
+		if (format.attr_len == 0) {
+			attr_id.pos = GPU_vertformat_attr_add(&format, "pos", GPU_COMP_F32, 3, GPU_FETCH_FLOAT);
+			attr_id.nor = GPU_vertformat_attr_add(&format, "nor", GPU_COMP_I10, 3, GPU_FETCH_INT_TO_FLOAT_UNIT);
+		}
 
-				if (lnors) {
-					for (uint t = 0; t < 3; t++) {
-						const float *nor = lnors[mlt->tri[t]];
-						*((GPUPackedNormal *)GPU_vertbuf_raw_step(&nor_step)) = GPU_normal_convert_i10_v3(nor);
-					}
-				}
-				else if (mp->flag & ME_SMOOTH) {
-					for (uint t = 0; t < 3; t++) {
-						const MVert *mv = &rdata->mvert[vtri[t]];
-						*((GPUPackedNormal *)GPU_vertbuf_raw_step(&nor_step)) = GPU_normal_convert_i10_s3(mv->no);
-					}
-				}
-				else {
-					const GPUPackedNormal *pnors_pack = &rdata->poly_normals_pack[mlt->poly];
-					for (uint t = 0; t < 3; t++) {
-						*((GPUPackedNormal *)GPU_vertbuf_raw_step(&nor_step)) = *pnors_pack;
-					}
-				}
+		const int tri_len = mesh_render_data_looptri_len_get(rdata);
+		int tri_len_used;
 
-				for (uint t = 0; t < 3; t++) {
-					const MVert *mv = &rdata->mvert[vtri[t]];
-					copy_v3_v3(GPU_vertbuf_raw_step(&pos_step), mv->co);
-				}
+		GPUVertBuf *vbo = *r_vbo = GPU_vertbuf_create_with_format(&format);
+
+		/* Triangles are written at a known offset, so they can be extracted in parallel. */
+		TriPosNorExtractData data = {
+			.rdata = rdata,
+			.tri_offset = mesh_tri_offsets_visible(rdata, use_hide, &tri_len_used),
+		};
+
+		GPU_vertbuf_data_alloc(vbo, tri_len_used * 3);
+		GPU_vertbuf_attr_get_raw_data(vbo, attr_id.pos, &data.pos_step);
+		GPU_vertbuf_attr_get_raw_data(vbo, attr_id.nor, &data.nor_step);
+
+		/* Lazily initialized data has to be ready before threads read it. */
+		if (rdata->loop_normals == NULL) {
+			mesh_render_data_ensure_poly_normals_pack(rdata);
+			if (rdata->edit_bmesh) {
+				mesh_render_data_ensure_vert_normals_pack(rdata);
 			}
 		}
 
-		vbo_len_used = GPU_vertbuf_raw_used(&pos_step);
-		BLI_assert(vbo_len_used == GPU_vertbuf_raw_used(&nor_step));
+		ParallelRangeSettings settings;
+		BLI_parallel_range_settings_defaults(&settings);
+		settings.min_iter_per_thread = 4096;
+		BLI_task_parallel_range(
+		        0, tri_len, &data,
+		        rdata->edit_bmesh ?
+		        mesh_extract_tri_pos_and_normals_bmesh_cb :
+		        mesh_extract_tri_pos_and_normals_mesh_cb,
+		        &settings);
 
-		if (vbo_len_capacity != vbo_len_used) {
-			GPU_vertbuf_data_resize(vbo, vbo_len_used);
-		}
+		MEM_SAFE_FREE(data.tri_offset);
 	}
 	return *r_vbo;
 }
@@ -3836,6 +4259,52 @@ GPUBatch *DRW_mesh_batch_cache_get_triangles_with_normals(Mesh *me)
 	return cache->triangles_with_normals;
 }
 
+/**
+ * Simplified #DRW_mesh_batch_cache_get_triangles_with_normals for a mesh covering \a pixel_size
+ * pixels on screen. Returns NULL when the full resolution batch should be used,
+ * including while the levels are being generated.
+ */
+GPUBatch *DRW_mesh_batch_cache_get_triangles_with_normals_lod(Mesh *me, float pixel_size)
+{
+	MeshBatchCache *cache = mesh_batch_cache_get(me);
+
+	if (cache->is_editmode || (cache->tri_len < MESH_LOD_TRI_MIN) ||
+	    (pixel_size > mesh_lod_grid_res[0] * MESH_LOD_CELL_PIXELS))
+	{
+		return NULL;
+	}
+
+	if (!cache->is_lod_ready) {
+		if (cache->lod_job == NULL) {
+			if (cache->lod_stable_redraws++ >= MESH_LOD_STABLE_REDRAWS) {
+				cache->lod_job = mesh_lod_job_create(me);
+			}
+			return NULL;
+		}
+		if (!mesh_lod_job_is_done(cache->lod_job)) {
+			return NULL;
+		}
+		for (int i = 0; i < MESH_LOD_LEVELS; i++) {
+			if (cache->lod_job->levels[i].tri_len != 0) {
+				cache->triangles_with_normals_lod[i] = mesh_lod_level_batch_create(&cache->lod_job->levels[i]);
+			}
+		}
+		mesh_lod_job_free(cache->lod_job);
+		cache->lod_job = NULL;
+		cache->is_lod_ready = true;
+	}
+
+	/* Coarsest level with cells still small enough on screen. */
+	for (int i = MESH_LOD_LEVELS - 1; i >= 0; i--) {
+		if (cache->triangles_with_normals_lod[i] &&
+		    (pixel_size <= mesh_lod_grid_res[i] * MESH_LOD_CELL_PIXELS))
+		{
+			return cache->triangles_with_normals_lod[i];
+		}
+	}
+	return NULL;
+}
+
 GPUBatch *DRW_mesh_batch_cache_get_loose_edges_with_normals(Mesh *me)
 {
 	MeshBatchCache *cache = mesh_batch_cache_get(me);
@@ -104,6 +104,7 @@ DRWManager DST = {NULL};
 static ListBase DRW_engines = {NULL, NULL};
 
 extern struct GPUUniformBuffer *view_ubo; /* draw_manager_exec.c */
+extern struct GPUUniformBuffer *instanced_calls_ubo; /* draw_manager_exec.c */
 
 static void drw_state_prepare_clean_for_draw(DRWManager *dst)
 {
@@ -598,6 +599,10 @@ static void drw_viewport_var_init(void)
 	if (view_ubo == NULL) {
 		view_ubo = DRW_uniformbuffer_create(sizeof(ViewUboStorage), NULL);
 	}
+	if (instanced_calls_ubo == NULL) {
+		instanced_calls_ubo = DRW_uniformbuffer_create(
+		        sizeof(DRWInstancedCallUboStorage) * DRW_INSTANCED_CALLS_MAX, NULL);
+	}
 
 	DST.override_mat = 0;
 	DST.dirty_mat = true;
@@ -667,6 +672,24 @@ bool DRW_viewport_is_persp_get(void)
 	}
 }
 
+/* Approximate on-screen diameter in pixels of a world space BoundSphere,
+ * FLT_MAX when the view is inside of it. */
+float DRW_viewport_sphere_pixel_size_get(const BoundSphere *bsphere)
+{
+	const DRWMatrixState *matstate = &DST.view_data.matstate;
+	float radius = bsphere->radius * matstate->winmat[1][1];
+
+	if (DRW_viewport_is_persp_get()) {
+		const float depth = -(dot_m4_v3_row_z(matstate->viewmat, bsphere->center) + matstate->viewmat[3][2]);
+		if (depth <= bsphere->radius) {
+			return FLT_MAX;
+		}
+		radius /= depth;
+	}
+	/* NDC spans 2 units for the viewport height. */
+	return radius * DST.size[1];
+}
+
 float DRW_viewport_near_distance_get(void)
 {
 	float projmat[4][4];
@@ -937,9 +960,14 @@ static void drw_engines_cache_init(void)
 			DST.text_store_p = &data->text_draw_cache;
 		}
 
+		DRWProfilerTimer ptimer;
+		DRW_profiler_timer_start(&ptimer);
+
 		if (engine->cache_init) {
 			engine->cache_init(data);
 		}
+
+		DRW_profiler_stage_end(engine, DRW_PROFILER_CACHE_INIT, &ptimer);
 	}
 }
 
@@ -969,9 +997,14 @@ static void drw_engines_cache_populate(Object *ob)
 	 * ourselves here. */
 	drw_drawdata_unlink_dupli((ID *)ob);
 
+	DRWProfilerTimer ptimer_ob;
+	DRW_profiler_timer_start(&ptimer_ob);
+
 	for (LinkData *link = DST.enabled_engines.first; link; link = link->next) {
 		DrawEngineType *engine = link->data;
 		ViewportEngineData *data = drw_viewport_engine_data_ensure(engine);
+		DRWProfilerTimer ptimer;
+		DRW_profiler_timer_start(&ptimer);
 
 		if (engine->id_update) {
 			engine->id_update(data, &ob->id);
@@ -980,8 +1013,12 @@ static void drw_engines_cache_populate(Object *ob)
 		if (engine->cache_populate) {
 			engine->cache_populate(data, ob);
 		}
+
+		DRW_profiler_stage_end(engine, DRW_PROFILER_CACHE_POPULATE, &ptimer);
 	}
 
+	DRW_profiler_object_end(ob, &ptimer_ob);
+
 	/* ... and clearing it here too because theses draw data are
 	 * from a mempool and must not be free individually by depsgraph. */
 	drw_drawdata_unlink_dupli((ID *)ob);
@@ -993,9 +1030,14 @@ static void drw_engines_cache_finish(void)
 		DrawEngineType *engine = link->data;
 		ViewportEngineData *data = drw_viewport_engine_data_ensure(engine);
 
+		DRWProfilerTimer ptimer;
+		DRW_profiler_timer_start(&ptimer);
+
 		if (engine->cache_finish) {
 			engine->cache_finish(data);
 		}
+
+		DRW_profiler_stage_end(engine, DRW_PROFILER_CACHE_FINISH, &ptimer);
 	}
 }
 
@@ -1007,11 +1049,14 @@ static void drw_engines_draw_background(void)
 
 		if (engine->draw_background) {
 			PROFILE_START(stime);
+			DRWProfilerTimer ptimer;
+			DRW_profiler_timer_start(&ptimer);
 
 			DRW_stats_group_start(engine->idname);
 			engine->draw_background(data);
 			DRW_stats_group_end();
 
+			DRW_profiler_stage_end(engine, DRW_PROFILER_DRAW_BACKGROUND, &ptimer);
 			PROFILE_END_UPDATE(data->background_time, stime);
 			return;
 		}
@@ -1036,6 +1081,8 @@ static void drw_engines_draw_scene(void)
 
 		ViewportEngineData *data = drw_viewport_engine_data_ensure(engine);
 		PROFILE_START(stime);
+		DRWProfilerTimer ptimer;
+		DRW_profiler_timer_start(&ptimer);
 
 		if (engine->draw_scene) {
 			DRW_stats_group_start(engine->idname);
@@ -1047,6 +1094,7 @@ static void drw_engines_draw_scene(void)
 			DRW_stats_group_end();
 		}
 
+		DRW_profiler_stage_end(engine, DRW_PROFILER_DRAW_SCENE, &ptimer);
 		PROFILE_END_UPDATE(data->render_time, stime);
 	}
 }
@@ -1458,6 +1506,8 @@ void DRW_draw_render_loop_ex(
 	/* No framebuffer allowed before drawing. */
 	BLI_assert(GPU_framebuffer_active_get() == NULL);
 
+	DRW_profiler_frame_begin();
+
 	/* Init engines */
 	drw_engines_init();
 
@@ -1467,11 +1517,14 @@ void DRW_draw_render_loop_ex(
 		drw_engines_cache_init();
 		drw_engines_world_update(scene);
 
+		drw_occlusion_init();
+
 		const int object_type_exclude_viewport = v3d->object_type_exclude_viewport;
 		DEG_OBJECT_ITER_FOR_RENDER_ENGINE_BEGIN(depsgraph, ob)
 		{
 			if ((object_type_exclude_viewport & (1 << ob->type)) == 0) {
 				drw_engines_cache_populate(ob);
+				drw_occlusion_occluder_add(ob);
 			}
 		}
 		DEG_OBJECT_ITER_FOR_RENDER_ENGINE_END;
@@ -1480,6 +1533,8 @@ void DRW_draw_render_loop_ex(
 
 		DRW_render_instance_buffer_finish();
 
+		drw_occlusion_build();
+
 #ifdef USE_PROFILE
 		double *cache_time = GPU_viewport_cache_time_get(DST.viewport);
 		PROFILE_END_UPDATE(*cache_time, stime);
@@ -1615,6 +1670,8 @@ void DRW_draw_render_loop_ex(
 		ED_view3d_draw_bgpic_test(scene, depsgraph, ar, v3d, true, true);
 	}
 
+	DRW_profiler_frame_end();
+
 	if (G.debug_value > 20) {
 		glDisable(GL_DEPTH_TEST);
 		rcti rect; /* local coordinate visible rect inside region, to accomodate overlapping ui */
@@ -2569,6 +2626,7 @@ void DRW_engines_free(void)
 
 	DRW_hair_free();
 	DRW_shape_cache_free();
+	drw_occlusion_free();
 	DRW_stats_free();
 	DRW_globals_free();
 
@@ -2584,6 +2642,7 @@ void DRW_engines_free(void)
 
 	DRW_UBO_FREE_SAFE(globals_ubo);
 	DRW_UBO_FREE_SAFE(view_ubo);
+	DRW_UBO_FREE_SAFE(instanced_calls_ubo);
 	DRW_TEXTURE_FREE_SAFE(globals_ramp);
 	MEM_SAFE_FREE(g_pos_format);
 
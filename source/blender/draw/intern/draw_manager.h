@@ -89,6 +89,8 @@ enum {
 	DRW_CALL_CULLED                 = (1 << 0),
 	DRW_CALL_NEGSCALE               = (1 << 1),
 	DRW_CALL_BYPASS_CULLING         = (1 << 2),
+	DRW_CALL_OCCLUDED               = (1 << 3),
+	DRW_CALL_BYPASS_OCCLUSION       = (1 << 4),
 };
 
 /* Used by DRWCallState.matflag */
@@ -257,6 +259,7 @@ struct DRWShadingGroup {
 	int orcotexfac;
 	int eye;
 	int callid;
+	int instanced_calls; /* Location of 'drwInstancedCalls', -1 when calls can't be instanced. */
 	uint16_t matflag; /* Matrices needed, same as DRWCall.flag */
 
 #ifndef NDEBUG
@@ -290,6 +293,17 @@ typedef struct ViewUboStorage {
 	float clipplanes[2][4];
 } ViewUboStorage;
 
+/* Consecutive calls of a shading group drawing the same batch can be drawn with a single
+ * instanced draw call, when its shader reads their matrices from 'drwInstancedCallsBlock'
+ * (instead of the ModelViewProjectionMatrix and NormalMatrix uniforms) when 'drwInstancedCalls' is set.
+ * Must match the block declared in GLSL, 16KB is the minimum UBO size of GL 3.3. */
+#define DRW_INSTANCED_CALLS_MAX 128
+
+typedef struct DRWInstancedCallUboStorage {
+	float modelviewprojection[4][4];
+	float normalview[4][4]; /* 3x3 in the upper left, std140 pads mat3 columns anyway. */
+} DRWInstancedCallUboStorage;
+
 /* ------------- DRAW DEBUG ------------ */
 
 typedef struct DRWDebugLine {
@@ -371,6 +385,11 @@ typedef struct DRWManager {
 		bool updated;
 	} clipping;
 
+	struct {
+		bool is_enabled; /* Occluders are gathered for this redraw. */
+		bool is_valid;   /* Depth buffer matches the current view. */
+	} occlusion;
+
 #ifdef USE_GPU_SELECT
 	uint select_id;
 #endif
@@ -416,4 +435,12 @@ void drw_state_set(DRWState state);
 void drw_debug_draw(void);
 void drw_debug_init(void);
 
+void drw_occlusion_init(void);
+void drw_occlusion_occluder_add(struct Object *ob);
+void drw_occlusion_build(void);
+void drw_occlusion_view_update(void);
+bool drw_occlusion_state_is_supported(DRWState state);
+bool drw_occlusion_sphere_test(const BoundSphere *bsphere);
+void drw_occlusion_free(void);
+
 #endif /* __DRAW_MANAGER_H__ */
@@ -44,6 +44,7 @@
 struct GPUVertFormat *g_pos_format = NULL;
 
 extern struct GPUUniformBuffer *view_ubo; /* draw_manager_exec.c */
+extern struct GPUUniformBuffer *instanced_calls_ubo; /* draw_manager_exec.c */
 
 /* -------------------------------------------------------------------- */
 
@@ -327,6 +328,11 @@ static DRWCallState *drw_call_state_create(DRWShadingGroup *shgroup, float (*obm
 		mul_v3_m4v3(corner, obmat, bbox->vec[0]);
 		mul_m4_v3(obmat, state->bsphere.center);
 		state->bsphere.radius = len_v3v3(state->bsphere.center, corner);
+
+		/* X-Ray objects are seen through the occluders. */
+		if (ob->dtx & OB_DRAWXRAY) {
+			state->flag |= DRW_CALL_BYPASS_OCCLUSION;
+		}
 	}
 	else {
 		/* Bypass test. */
@@ -638,6 +644,20 @@ static void drw_shgroup_init(DRWShadingGroup *shgroup, GPUShader *shader)
 		shgroup->matflag |= DRW_CALL_ORCOTEXFAC;
 	if (shgroup->eye > -1)
 		shgroup->matflag |= DRW_CALL_EYEVEC;
+
+	shgroup->instanced_calls = -1;
+	int instanced_calls_ubo_location = GPU_shader_get_uniform_block(shader, "drwInstancedCallsBlock");
+	if (instanced_calls_ubo_location != -1) {
+		drw_shgroup_uniform_create_ex(
+		        shgroup, instanced_calls_ubo_location, DRW_UNIFORM_BLOCK_PERSIST, instanced_calls_ubo, 0, 1);
+		/* Only the matrices stored in DRWInstancedCallUboStorage can differ between instanced calls. */
+		if ((shgroup->model == -1) && (shgroup->modelinverse == -1) &&
+		    (shgroup->modelview == -1) && (shgroup->modelviewinverse == -1) &&
+		    (shgroup->normalworld == -1) && (shgroup->orcotexfac == -1) && (shgroup->eye == -1))
+		{
+			shgroup->instanced_calls = GPU_shader_get_uniform(shader, "drwInstancedCalls");
+		}
+	}
 }
 
 static void drw_shgroup_instance_init(
@@ -26,6 +26,7 @@
 #include "draw_manager.h"
 
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 
 #include "BIF_glutil.h"
 
@@ -36,6 +37,8 @@
 #include "GPU_extensions.h"
 #include "intern/gpu_shader_private.h"
 
+#include "draw_manager_profiling.h"
+
 #ifdef USE_GPU_SELECT
 #  include "ED_view3d.h"
 #  include "ED_armature.h"
@@ -53,6 +56,9 @@ void DRW_select_load_id(uint id)
 #define DEBUG_UBO_BINDING
 
 struct GPUUniformBuffer *view_ubo;
+struct GPUUniformBuffer *instanced_calls_ubo;
+
+static DRWInstancedCallUboStorage instanced_calls_data[DRW_INSTANCED_CALLS_MAX];
 
 /* -------------------------------------------------------------------- */
 
@@ -643,11 +649,10 @@ static void draw_clipping_setup_from_view(void)
 	DST.clipping.updated = true;
 }
 
-/* Return True if the given BoundSphere intersect the current view frustum */
-bool DRW_culling_sphere_test(BoundSphere *bsphere)
+/* Same as DRW_culling_sphere_test() but expects the clipping data to be up to date,
+ * only reads from it so it can be used from multiple threads. */
+static bool draw_culling_sphere_test(const BoundSphere *bsphere)
 {
-	draw_clipping_setup_from_view();
-
 	/* Bypass test if radius is negative. */
 	if (bsphere->radius < 0.0f)
 		return true;
@@ -669,6 +674,14 @@ bool DRW_culling_sphere_test(BoundSphere *bsphere)
 	return true;
 }
 
+/* Return True if the given BoundSphere intersect the current view frustum */
+bool DRW_culling_sphere_test(BoundSphere *bsphere)
+{
+	draw_clipping_setup_from_view();
+
+	return draw_culling_sphere_test(bsphere);
+}
+
 /* Return True if the given BoundBox intersect the current view frustum.
  * bbox must be in world space. */
 bool DRW_culling_box_test(BoundBox *bbox)
@@ -737,7 +750,9 @@ static void draw_visibility_eval(DRWCallState *st)
 
 	if (st->cache_id != DST.state_cache_id) {
 		/* Update culling result for this view. */
-		culled = !DRW_culling_sphere_test(&st->bsphere);
+		culled = !draw_culling_sphere_test(&st->bsphere);
+		const bool occluded = !culled && drw_occlusion_sphere_test(&st->bsphere);
+		SET_FLAG_FROM_TEST(st->flag, occluded, DRW_CALL_OCCLUDED);
 	}
 
 	if (st->visibility_cb) {
@@ -747,16 +762,8 @@ static void draw_visibility_eval(DRWCallState *st)
 	SET_FLAG_FROM_TEST(st->flag, culled, DRW_CALL_CULLED);
 }
 
-static void draw_matrices_model_prepare(DRWCallState *st)
+static void draw_matrices_model_compute(DRWCallState *st)
 {
-	if (st->cache_id == DST.state_cache_id) {
-		/* Values are already updated for this view. */
-		return;
-	}
-	else {
-		st->cache_id = DST.state_cache_id;
-	}
-
 	/* No need to go further the call will not be used. */
 	if ((st->flag & DRW_CALL_CULLED) != 0 &&
 	    (st->flag & DRW_CALL_BYPASS_CULLING) == 0)
@@ -801,6 +808,87 @@ static void draw_matrices_model_prepare(DRWCallState *st)
 	}
 }
 
+static void draw_matrices_model_prepare(DRWCallState *st)
+{
+	if (st->cache_id == DST.state_cache_id) {
+		/* Values are already updated for this view. */
+		return;
+	}
+	else {
+		st->cache_id = DST.state_cache_id;
+	}
+
+	draw_matrices_model_compute(st);
+}
+
+/* Only the frustum test and the matrices are evaluated here, visibility callbacks
+ * are user code and still run during submission. */
+static void draw_call_state_prepare_cb(
+        void *__restrict userdata,
+        const int i,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	DRWCallState *st = ((DRWCallState **)userdata)[i];
+
+	const bool culled = !draw_culling_sphere_test(&st->bsphere);
+	const bool occluded = !culled && drw_occlusion_sphere_test(&st->bsphere);
+	SET_FLAG_FROM_TEST(st->flag, culled, DRW_CALL_CULLED);
+	SET_FLAG_FROM_TEST(st->flag, occluded, DRW_CALL_OCCLUDED);
+
+	draw_matrices_model_compute(st);
+}
+
+/* Evaluate culling and matrices of the call states drawn by a range of shading groups at once.
+ * Below this amount of states, doing it lazily during submission is cheaper,
+ * e.g. for the many small passes of shadow maps. */
+#define DRW_CALL_STATE_PREPARE_THRESHOLD 1024
+
+static DRWCall *draw_shgroup_calls_first(const DRWShadingGroup *shgroup)
+{
+	return ELEM(shgroup->type, DRW_SHG_NORMAL, DRW_SHG_FEEDBACK_TRANSFORM) ? shgroup->calls.first : NULL;
+}
+
+static void draw_call_states_prepare(DRWShadingGroup *start_group, DRWShadingGroup *end_group)
+{
+	/* Upper bound, states shared by several calls are counted for each of them. */
+	int states_len = 0;
+	for (DRWShadingGroup *shgroup = start_group; shgroup; shgroup = (shgroup != end_group) ? shgroup->next : NULL) {
+		for (DRWCall *call = draw_shgroup_calls_first(shgroup); call; call = call->next) {
+			if (call->state->cache_id != DST.state_cache_id) {
+				states_len++;
+			}
+		}
+	}
+
+	if (states_len < DRW_CALL_STATE_PREPARE_THRESHOLD) {
+		return;
+	}
+
+	DRWProfilerTimer ptimer;
+	DRW_profiler_timer_start(&ptimer);
+
+	/* Tagging the states while gathering them makes each appear only once. */
+	DRWCallState **states = MEM_mallocN(sizeof(*states) * states_len, __func__);
+	states_len = 0;
+	for (DRWShadingGroup *shgroup = start_group; shgroup; shgroup = (shgroup != end_group) ? shgroup->next : NULL) {
+		for (DRWCall *call = draw_shgroup_calls_first(shgroup); call; call = call->next) {
+			DRWCallState *st = call->state;
+			if (st->cache_id != DST.state_cache_id) {
+				st->cache_id = DST.state_cache_id;
+				states[states_len++] = st;
+			}
+		}
+	}
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	BLI_task_parallel_range(0, states_len, states, draw_call_state_prepare_cb, &settings);
+
+	MEM_freeN(states);
+
+	DRW_profiler_call_states_end(&ptimer, states_len);
+}
+
 static void draw_geometry_prepare(DRWShadingGroup *shgroup, DRWCallState *state)
 {
 	/* step 1 : bind object dependent matrices */
@@ -838,6 +926,7 @@ static void draw_geometry_execute_ex(
 		BLI_assert(shgroup->type == DRW_SHG_TRIANGLE_BATCH); /* Add other type if needed. */
 		/* Shader is already bound. */
 		GPU_draw_primitive(GPU_PRIM_TRIS, count);
+		DRW_profiler_draw_call_add();
 		return;
 	}
 
@@ -848,6 +937,7 @@ static void draw_geometry_execute_ex(
 	geom->program_in_use = true;
 
 	GPU_batch_draw_range_ex(geom, start, count, draw_instance);
+	DRW_profiler_draw_call_add();
 
 	geom->program_in_use = false; /* XXX hacking gawain */
 }
@@ -857,6 +947,85 @@ static void draw_geometry_execute(DRWShadingGroup *shgroup, GPUBatch *geom)
 	draw_geometry_execute_ex(shgroup, geom, 0, 0, false);
 }
 
+/* Evaluate the visibility of a call for the current view, culling and matrices
+ * are usually ready (see draw_call_states_prepare()). */
+static bool draw_call_is_drawn(DRWCallState *st, const bool use_occlusion)
+{
+	draw_visibility_eval(st);
+	draw_matrices_model_prepare(st);
+
+	if ((st->flag & DRW_CALL_CULLED) != 0 &&
+	    (st->flag & DRW_CALL_BYPASS_CULLING) == 0)
+	{
+		return false;
+	}
+
+	if (use_occlusion &&
+	    (st->flag & DRW_CALL_OCCLUDED) != 0 &&
+	    (st->flag & DRW_CALL_BYPASS_OCCLUSION) == 0)
+	{
+		DRW_profiler_occluded_call_add();
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Draw \a call (visible, with its matrices bound) and the visible calls following it
+ * that draw the same batch with a single instanced draw call, e.g. linked duplicates.
+ * Their matrices are read by the shader from 'drwInstancedCallsBlock'.
+ *
+ * \return the last call handled, so the caller continues after it.
+ */
+static DRWCall *draw_calls_instanced(DRWShadingGroup *shgroup, DRWCall *call, const bool use_occlusion)
+{
+	GPUBatch *geom = call->single.geometry;
+	DRWCall *call_last = call;
+	int len = 0;
+
+	/* Batches with their own instance attributes are drawn as usual. */
+	if ((geom != NULL) && (geom->inst == NULL)) {
+		/* Front face is set once for all instances. */
+		const short neg_scale = call->state->flag & DRW_CALL_NEGSCALE;
+
+		for (DRWCall *call_iter = call; call_iter; call_iter = call_iter->next) {
+			/* Stop before the calls that can't be instanced, their visibility is evaluated by the caller. */
+			if ((call_iter->type != DRW_CALL_SINGLE) ||
+			    (call_iter->single.geometry != geom) ||
+			    ((call_iter->state->flag & DRW_CALL_NEGSCALE) != neg_scale) ||
+			    (len == DRW_INSTANCED_CALLS_MAX))
+			{
+				break;
+			}
+			call_last = call_iter;
+			if ((call_iter != call) && !draw_call_is_drawn(call_iter->state, use_occlusion)) {
+				continue;
+			}
+			DRWInstancedCallUboStorage *data = &instanced_calls_data[len++];
+			copy_m4_m4(data->modelviewprojection, call_iter->state->modelviewprojection);
+			copy_m4_m3(data->normalview, call_iter->state->normalview);
+		}
+	}
+
+	if (len < 2) {
+		draw_geometry_execute(shgroup, geom);
+		return call_last;
+	}
+
+	GPU_uniformbuffer_update_range(instanced_calls_ubo, instanced_calls_data, sizeof(*instanced_calls_data) * len);
+
+	int use_instanced_calls = 1;
+	GPU_shader_uniform_vector_int(shgroup->shader, shgroup->instanced_calls, 1, 1, &use_instanced_calls);
+	draw_geometry_execute_ex(shgroup, geom, 0, len, true);
+	use_instanced_calls = 0;
+	GPU_shader_uniform_vector_int(shgroup->shader, shgroup->instanced_calls, 1, 1, &use_instanced_calls);
+
+	DRW_profiler_instanced_calls_add(len);
+
+	return call_last;
+}
+
 enum {
 	BIND_NONE = 0,
 	BIND_TEMP = 1,         /* Release slot after this shading group. */
@@ -1179,15 +1348,19 @@ static void draw_shgroup(DRWShadingGroup *shgroup, DRWState pass_state)
 	else {
 		bool prev_neg_scale = false;
 		int callid = 0;
+		/* Only passes drawn in the scene depth opt-in, hidden calls would not pass its depth test. */
+		const bool use_occlusion = drw_occlusion_state_is_supported(DST.state);
+		/* Picking needs a select id per call. */
+		const bool use_instanced_calls = (shgroup->instanced_calls != -1) &&
+		                                 (shgroup->type == DRW_SHG_NORMAL) &&
+		                                 (shgroup->callid == -1) &&
+		                                 ((G.f & G_PICKSEL) == 0);
+		/* Calls of the same object share their state (see drw_call_state_object()),
+		 * their matrices are already bound when they follow each other. */
+		DRWCallState *prev_state = NULL;
 		for (DRWCall *call = shgroup->calls.first; call; call = call->next) {
 
-			/* OPTI/IDEA(clem): Do this preparation in another thread. */
-			draw_visibility_eval(call->state);
-			draw_matrices_model_prepare(call->state);
-
-			if ((call->state->flag & DRW_CALL_CULLED) != 0 &&
-			    (call->state->flag & DRW_CALL_BYPASS_CULLING) == 0)
-			{
+			if (!draw_call_is_drawn(call->state, use_occlusion)) {
 				continue;
 			}
 
@@ -1205,11 +1378,19 @@ static void draw_shgroup(DRWShadingGroup *shgroup, DRWState pass_state)
 			}
 
 			GPU_SELECT_LOAD_IF_PICKSEL_CALL(call);
-			draw_geometry_prepare(shgroup, call->state);
+			if (call->state != prev_state) {
+				draw_geometry_prepare(shgroup, call->state);
+				prev_state = call->state;
+			}
 
 			switch (call->type) {
 				case DRW_CALL_SINGLE:
-					draw_geometry_execute(shgroup, call->single.geometry);
+					if (use_instanced_calls) {
+						call = draw_calls_instanced(shgroup, call, use_occlusion);
+					}
+					else {
+						draw_geometry_execute(shgroup, call->single.geometry);
+					}
 					break;
 				case DRW_CALL_RANGE:
 					draw_geometry_execute_ex(shgroup, call->range.geometry, call->range.start, call->range.count, false);
@@ -1222,6 +1403,7 @@ static void draw_shgroup(DRWShadingGroup *shgroup, DRWState pass_state)
 					break;
 				case DRW_CALL_PROCEDURAL:
 					GPU_draw_primitive(call->procedural.prim_type, call->procedural.vert_count);
+					DRW_profiler_draw_call_add();
 					break;
 				default:
 					BLI_assert(0);
@@ -1241,6 +1423,8 @@ static void draw_shgroup(DRWShadingGroup *shgroup, DRWState pass_state)
 
 static void drw_update_view(void)
 {
+	const bool view_changed = DST.dirty_mat;
+
 	if (DST.dirty_mat) {
 		DST.state_cache_id++;
 		DST.dirty_mat = false;
@@ -1259,11 +1443,13 @@ static void drw_update_view(void)
 				state->cache_id = 0;
 			}
 		}
-
-		/* TODO dispatch threads to compute matrices/culling */
 	}
 
 	draw_clipping_setup_from_view();
+
+	if (view_changed) {
+		drw_occlusion_view_update();
+	}
 }
 
 static void drw_draw_pass_ex(DRWPass *pass, DRWShadingGroup *start_group, DRWShadingGroup *end_group)
@@ -1277,6 +1463,9 @@ static void drw_draw_pass_ex(DRWPass *pass, DRWShadingGroup *start_group, DRWSha
 
 	drw_update_view();
 
+	/* Only the states used by this pass, other views (e.g. shadow maps) draw other passes. */
+	draw_call_states_prepare(start_group, end_group);
+
 	drw_state_set(pass->state);
 
 	DRW_stats_query_start(pass->name);
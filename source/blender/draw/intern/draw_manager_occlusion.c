@@ -0,0 +1,482 @@
+/*
+ * Copyright 2016, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor(s): Blender Institute
+ *
+ */
+
+/** \file draw_manager_occlusion.c
+ *  \ingroup draw
+ *
+ * Occlusion culling using a low resolution depth buffer rendered on the CPU.
+ *
+ * Large meshes with few triangles (walls, floors, buildings...) are collected while
+ * populating the cache and rasterized once before drawing. Call states hidden behind
+ * them are then skipped by depth tested passes drawn from the same view.
+ */
+
+#include <stdlib.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_math.h"
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+
+#include "BKE_material.h"
+#include "BKE_mesh_runtime.h"
+#include "BKE_object.h"
+
+#include "DNA_material_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_userdef_types.h"
+#include "DNA_view3d_types.h"
+
+#include "draw_manager.h"
+
+/* Width of the depth buffer, the height follows the viewport aspect. */
+#define OCCLUSION_BUFFER_WIDTH 256
+/* Rows rasterized by each task. */
+#define OCCLUSION_BAND_HEIGHT 16
+/* Occluders must cover this fraction of the viewport height. */
+#define OCCLUSION_OCCLUDER_SIZE_MIN 0.1f
+/* Heavier meshes are not worth rasterizing, they rarely make good occluders anyway. */
+#define OCCLUSION_OCCLUDER_TRI_MAX 8192
+/* Triangles rasterized per redraw, biggest occluders on screen first. */
+#define OCCLUSION_TRI_BUDGET 65536
+
+/* Objects given by the depsgraph iterator can be temporary (dupli-objects), keep what's needed. */
+typedef struct DRWOccluder {
+	Mesh *me;
+	float obmat[4][4];
+	float pixel_size;
+	int tri_len;
+} DRWOccluder;
+
+/* Screen space triangle, x and y in buffer pixels, z in [0..1] depth range. */
+typedef struct DRWOccluderTri {
+	float co[3][3];
+	int ymin, ymax;
+} DRWOccluderTri;
+
+static struct {
+	float *depth;
+	int width, height;
+	/* View the depth buffer was rendered from. */
+	float persmat[4][4];
+
+	DRWOccluder *occluders;
+	int occluders_len, occluders_alloc;
+
+	DRWOccluderTri *tris;
+	int tris_len, tris_alloc;
+} OCC = {NULL};
+
+/* -------------------------------------------------------------------- */
+
+/** \name Occluders
+ * \{ */
+
+void drw_occlusion_init(void)
+{
+	const View3D *v3d = DST.draw_ctx.v3d;
+
+	OCC.occluders_len = 0;
+	DST.occlusion.is_enabled = false;
+	DST.occlusion.is_valid = false;
+
+	if (!(U.uiflag2 & USER_GPU_OCCLUSION_CULLING) || (v3d == NULL) || (DST.draw_ctx.rv3d == NULL)) {
+		return;
+	}
+	/* Only opaque surfaces can hide what's behind them. Material and rendered shading
+	 * use the material's surface (displacement, alpha, shadows), not the mesh. */
+	if ((v3d->shading.type != OB_SOLID) || (v3d->shading.flag & V3D_SHADING_XRAY)) {
+		return;
+	}
+	/* Back faces of occluders are not drawn, they must not hide anything either. */
+	if (v3d->flag2 & V3D_BACKFACE_CULLING) {
+		return;
+	}
+	DST.occlusion.is_enabled = true;
+}
+
+static bool drw_occlusion_object_is_opaque(Object *ob)
+{
+	if ((ob->dt < OB_SOLID) || (ob->dtx & OB_DRAWXRAY)) {
+		return false;
+	}
+	for (int i = 0; i < ob->totcol; i++) {
+		Material *ma = give_current_material(ob, i + 1);
+		if (ma && (ma->blend_method != MA_BM_SOLID)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void drw_occlusion_occluder_add(Object *ob)
+{
+	if (!DST.occlusion.is_enabled || (ob->type != OB_MESH)) {
+		return;
+	}
+
+	/* Only objects the engines draw, see: #workbench_deferred_solid_cache_populate. */
+	if (!DRW_check_object_visible_within_active_context(ob)) {
+		return;
+	}
+
+	Mesh *me = ob->data;
+	if ((me->edit_btmesh != NULL) || !drw_occlusion_object_is_opaque(ob)) {
+		return;
+	}
+
+	const int tri_len = BKE_mesh_runtime_looptri_len(me);
+	if ((tri_len == 0) || (tri_len > OCCLUSION_OCCLUDER_TRI_MAX)) {
+		return;
+	}
+
+	BoundSphere bsphere;
+	float corner[3];
+	BoundBox *bbox = BKE_object_boundbox_get(ob);
+	mid_v3_v3v3(bsphere.center, bbox->vec[0], bbox->vec[6]);
+	mul_v3_m4v3(corner, ob->obmat, bbox->vec[0]);
+	mul_m4_v3(ob->obmat, bsphere.center);
+	bsphere.radius = len_v3v3(bsphere.center, corner);
+
+	const float pixel_size = DRW_viewport_sphere_pixel_size_get(&bsphere);
+	if ((pixel_size < DST.size[1] * OCCLUSION_OCCLUDER_SIZE_MIN) || !DRW_culling_sphere_test(&bsphere)) {
+		return;
+	}
+
+	if (OCC.occluders_len == OCC.occluders_alloc) {
+		OCC.occluders_alloc = max_ii(64, OCC.occluders_alloc * 2);
+		OCC.occluders = MEM_reallocN_id(OCC.occluders, sizeof(*OCC.occluders) * OCC.occluders_alloc, __func__);
+	}
+	DRWOccluder *occluder = &OCC.occluders[OCC.occluders_len++];
+	occluder->me = me;
+	copy_m4_m4(occluder->obmat, ob->obmat);
+	occluder->pixel_size = pixel_size;
+	occluder->tri_len = tri_len;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+
+/** \name Rasterization
+ * \{ */
+
+static int drw_occluder_cmp(const void *a_v, const void *b_v)
+{
+	const DRWOccluder *a = a_v, *b = b_v;
+	return (a->pixel_size < b->pixel_size) ? 1 : (a->pixel_size > b->pixel_size) ? -1 : 0;
+}
+
+static void drw_occlusion_tri_add(const float clip[3][4])
+{
+	DRWOccluderTri *tri;
+
+	if (OCC.tris_len == OCC.tris_alloc) {
+		OCC.tris_alloc = max_ii(1024, OCC.tris_alloc * 2);
+		OCC.tris = MEM_reallocN_id(OCC.tris, sizeof(*OCC.tris) * OCC.tris_alloc, __func__);
+	}
+	tri = &OCC.tris[OCC.tris_len++];
+
+	float ymin = FLT_MAX, ymax = -FLT_MAX;
+	for (int i = 0; i < 3; i++) {
+		const float inv_w = 1.0f / clip[i][3];
+		tri->co[i][0] = (clip[i][0] * inv_w * 0.5f + 0.5f) * OCC.width;
+		tri->co[i][1] = (clip[i][1] * inv_w * 0.5f + 0.5f) * OCC.height;
+		tri->co[i][2] = clip[i][2] * inv_w * 0.5f + 0.5f;
+		ymin = min_ff(ymin, tri->co[i][1]);
+		ymax = max_ff(ymax, tri->co[i][1]);
+	}
+	tri->ymin = max_ii((int)floorf(ymin), 0);
+	tri->ymax = min_ii((int)ceilf(ymax), OCC.height - 1);
+
+	if (tri->ymin > tri->ymax) {
+		OCC.tris_len--;
+	}
+}
+
+/* Clip against the near plane (z >= -w), so triangles going behind the view still occlude. */
+static void drw_occlusion_tri_clip_add(const float clip[3][4])
+{
+	float poly[4][4];
+	int poly_len = 0;
+
+	for (int i = 0; i < 3; i++) {
+		const float *a = clip[i], *b = clip[(i + 1) % 3];
+		const float da = a[2] + a[3], db = b[2] + b[3];
+		if (da >= 0.0f) {
+			copy_v4_v4(poly[poly_len++], a);
+		}
+		if ((da >= 0.0f) != (db >= 0.0f)) {
+			interp_v4_v4v4(poly[poly_len++], a, b, da / (da - db));
+		}
+	}
+
+	for (int i = 2; i < poly_len; i++) {
+		const float tri[3][4] = {
+			{UNPACK4(poly[0])}, {UNPACK4(poly[i - 1])}, {UNPACK4(poly[i])},
+		};
+		if (tri[0][3] > 0.0f && tri[1][3] > 0.0f && tri[2][3] > 0.0f) {
+			drw_occlusion_tri_add(tri);
+		}
+	}
+}
+
+static void drw_occlusion_band_raster_cb(
+        void *__restrict UNUSED(userdata),
+        const int band,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	const int band_ymin = band * OCCLUSION_BAND_HEIGHT;
+	const int band_ymax = min_ii(band_ymin + OCCLUSION_BAND_HEIGHT, OCC.height) - 1;
+
+	for (int t = 0; t < OCC.tris_len; t++) {
+		const DRWOccluderTri *tri = &OCC.tris[t];
+		if (tri->ymax < band_ymin || tri->ymin > band_ymax) {
+			continue;
+		}
+
+		const float (*co)[3] = tri->co;
+		const float area = (co[1][0] - co[0][0]) * (co[2][1] - co[0][1]) -
+		                   (co[2][0] - co[0][0]) * (co[1][1] - co[0][1]);
+		if (fabsf(area) < 1e-8f) {
+			continue;
+		}
+		/* Edge functions normalized so they are positive inside whatever the winding,
+		 * they give the barycentric weights of the opposite vertex. */
+		const float inv_area = 1.0f / area;
+		float edge[3][3];
+		for (int i = 0; i < 3; i++) {
+			const float *a = co[(i + 1) % 3], *b = co[(i + 2) % 3];
+			edge[i][0] = (a[1] - b[1]) * inv_area;
+			edge[i][1] = (b[0] - a[0]) * inv_area;
+			edge[i][2] = (a[0] * b[1] - a[1] * b[0]) * inv_area;
+		}
+		/* Depth as a plane equation of the pixel position. */
+		const float dz_dx = edge[0][0] * co[0][2] + edge[1][0] * co[1][2] + edge[2][0] * co[2][2];
+		const float dz_dy = edge[0][1] * co[0][2] + edge[1][1] * co[1][2] + edge[2][1] * co[2][2];
+		const float dz_0 = edge[0][2] * co[0][2] + edge[1][2] * co[1][2] + edge[2][2] * co[2][2];
+
+		const int xmin = max_ii((int)floorf(min_fff(co[0][0], co[1][0], co[2][0])), 0);
+		const int xmax = min_ii((int)ceilf(max_fff(co[0][0], co[1][0], co[2][0])), OCC.width - 1);
+		const int ymin = max_ii(tri->ymin, band_ymin);
+		const int ymax = min_ii(tri->ymax, band_ymax);
+
+		/* Only pixels whose center is covered are written, so coverage is never overestimated. */
+		for (int y = ymin; y <= ymax; y++) {
+			const float py = (float)y + 0.5f;
+			float *row = OCC.depth + y * OCC.width;
+			for (int x = xmin; x <= xmax; x++) {
+				const float px = (float)x + 0.5f;
+				const float w0 = edge[0][0] * px + edge[0][1] * py + edge[0][2];
+				const float w1 = edge[1][0] * px + edge[1][1] * py + edge[1][2];
+				const float w2 = edge[2][0] * px + edge[2][1] * py + edge[2][2];
+				const float z = dz_dx * px + dz_dy * py + dz_0;
+				if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f && z < row[x]) {
+					row[x] = z;
+				}
+			}
+		}
+	}
+}
+
+/* Keep the farthest depth of each 3x3 neighborhood: a pixel then only occludes if the occluders
+ * cover all of it, not only its center, and its depth is the farthest one over its area. */
+static void drw_occlusion_buffer_dilate(void)
+{
+	const int w = OCC.width, h = OCC.height;
+	float *tmp = MEM_mallocN(sizeof(float) * w * h, __func__);
+
+	for (int y = 0; y < h; y++) {
+		const float *src = OCC.depth + y * w;
+		float *dst = tmp + y * w;
+		for (int x = 0; x < w; x++) {
+			const float l = (x > 0) ? src[x - 1] : 1.0f;
+			const float r = (x < w - 1) ? src[x + 1] : 1.0f;
+			dst[x] = max_fff(l, src[x], r);
+		}
+	}
+	for (int y = 0; y < h; y++) {
+		const float *up = (y > 0) ? tmp + (y - 1) * w : NULL;
+		const float *down = (y < h - 1) ? tmp + (y + 1) * w : NULL;
+		const float *src = tmp + y * w;
+		float *dst = OCC.depth + y * w;
+		for (int x = 0; x < w; x++) {
+			dst[x] = max_fff(up ? up[x] : 1.0f, src[x], down ? down[x] : 1.0f);
+		}
+	}
+
+	MEM_freeN(tmp);
+}
+
+void drw_occlusion_build(void)
+{
+	if (!DST.occlusion.is_enabled || OCC.occluders_len == 0) {
+		return;
+	}
+
+	/* Depth buffer. */
+	const int width = OCCLUSION_BUFFER_WIDTH;
+	const int height = max_ii(1, (int)(width * DST.size[1] / max_ff(DST.size[0], 1.0f)));
+	if (width * height != OCC.width * OCC.height) {
+		MEM_SAFE_FREE(OCC.depth);
+		OCC.depth = MEM_mallocN(sizeof(float) * width * height, __func__);
+	}
+	OCC.width = width;
+	OCC.height = height;
+	copy_vn_fl(OCC.depth, width * height, 1.0f);
+
+	DRW_viewport_matrix_get(OCC.persmat, DRW_MAT_PERS);
+
+	/* Screen space triangles of the biggest occluders. */
+	qsort(OCC.occluders, OCC.occluders_len, sizeof(*OCC.occluders), drw_occluder_cmp);
+
+	OCC.tris_len = 0;
+	int tri_budget = OCCLUSION_TRI_BUDGET;
+	for (int i = 0; i < OCC.occluders_len; i++) {
+		const DRWOccluder *occluder = &OCC.occluders[i];
+		if (occluder->tri_len > tri_budget) {
+			continue;
+		}
+		tri_budget -= occluder->tri_len;
+
+		const Mesh *me = occluder->me;
+		const MLoopTri *mlooptri = BKE_mesh_runtime_looptri_ensure(occluder->me);
+		float mvp[4][4];
+		mul_m4_m4m4(mvp, OCC.persmat, occluder->obmat);
+
+		for (int t = 0; t < occluder->tri_len; t++) {
+			float clip[3][4];
+			for (int j = 0; j < 3; j++) {
+				const float *co = me->mvert[me->mloop[mlooptri[t].tri[j]].v].co;
+				mul_v4_m4v3(clip[j], mvp, co);
+			}
+			drw_occlusion_tri_clip_add(clip);
+		}
+	}
+
+	/* Rows are split in bands so each task owns the pixels it writes. */
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.use_threading = (OCC.tris_len > 256);
+	BLI_task_parallel_range(
+	        0, (height + OCCLUSION_BAND_HEIGHT - 1) / OCCLUSION_BAND_HEIGHT, NULL,
+	        drw_occlusion_band_raster_cb, &settings);
+
+	drw_occlusion_buffer_dilate();
+
+	DST.occlusion.is_valid = true;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+
+/** \name Occlusion Test
+ * \{ */
+
+/* Called when the view changes, the buffer is only used by views matching the one it was rendered from. */
+void drw_occlusion_view_update(void)
+{
+	if (!DST.occlusion.is_enabled || OCC.depth == NULL || OCC.occluders_len == 0) {
+		return;
+	}
+	DST.occlusion.is_valid = equals_m4m4(OCC.persmat, DST.view_data.matstate.mat[DRW_MAT_PERS]);
+}
+
+/* Only for passes opting in with #DRW_STATE_OCCLUSION_CULL,
+ * other passes may draw in a different depth buffer (outlines, x-ray...). */
+bool drw_occlusion_state_is_supported(DRWState state)
+{
+	return DST.occlusion.is_valid && (state & DRW_STATE_OCCLUSION_CULL) != 0;
+}
+
+/* Return true if the BoundSphere is entirely hidden by the occluders.
+ * Only reads from the depth buffer so it can be used from multiple threads. */
+bool drw_occlusion_sphere_test(const BoundSphere *bsphere)
+{
+	if (!DST.occlusion.is_valid || bsphere->radius < 0.0f) {
+		return false;
+	}
+
+	const DRWMatrixState *matstate = &DST.view_data.matstate;
+	const bool is_persp = (matstate->winmat[3][3] == 0.0f);
+	float center[3];
+	mul_v3_m4v3(center, matstate->viewmat, bsphere->center);
+
+	/* Nearest point of the sphere must be in front of the view, then its screen bounds
+	 * are the ones of the view aligned cube around it. */
+	const float near_z = center[2] + bsphere->radius;
+	if (is_persp && (near_z >= -DRW_viewport_near_distance_get())) {
+		return false;
+	}
+
+	float rect[2][2] = {{FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX}};
+	for (int i = 0; i < 8; i++) {
+		float co[4] = {
+			center[0] + ((i & 1) ? bsphere->radius : -bsphere->radius),
+			center[1] + ((i & 2) ? bsphere->radius : -bsphere->radius),
+			center[2] + ((i & 4) ? bsphere->radius : -bsphere->radius),
+			1.0f,
+		};
+		mul_m4_v4(matstate->winmat, co);
+		const float inv_w = 1.0f / co[3];
+		for (int j = 0; j < 2; j++) {
+			const float ndc = co[j] * inv_w;
+			rect[0][j] = min_ff(rect[0][j], ndc);
+			rect[1][j] = max_ff(rect[1][j], ndc);
+		}
+	}
+
+	float near_co[4] = {0.0f, 0.0f, near_z, 1.0f};
+	mul_m4_v4(matstate->winmat, near_co);
+	const float depth = near_co[2] / near_co[3] * 0.5f + 0.5f;
+
+	const int xmin = max_ii((int)floorf((rect[0][0] * 0.5f + 0.5f) * OCC.width), 0);
+	const int xmax = min_ii((int)floorf((rect[1][0] * 0.5f + 0.5f) * OCC.width), OCC.width - 1);
+	const int ymin = max_ii((int)floorf((rect[0][1] * 0.5f + 0.5f) * OCC.height), 0);
+	const int ymax = min_ii((int)floorf((rect[1][1] * 0.5f + 0.5f) * OCC.height), OCC.height - 1);
+	if (xmin > xmax || ymin > ymax) {
+		return false;
+	}
+
+	for (int y = ymin; y <= ymax; y++) {
+		const float *row = OCC.depth + y * OCC.width;
+		for (int x = xmin; x <= xmax; x++) {
+			if (row[x] >= depth) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/** \} */
+
+void drw_occlusion_free(void)
+{
+	MEM_SAFE_FREE(OCC.depth);
+	MEM_SAFE_FREE(OCC.occluders);
+	MEM_SAFE_FREE(OCC.tris);
+	memset(&OCC, 0, sizeof(OCC));
+}
@@ -25,11 +25,14 @@
 
 #include "BLI_rect.h"
 #include "BLI_string.h"
+#include "BLI_fileops.h"
 
 #include "BKE_global.h"
 
 #include "BLF_api.h"
 
+#include "DNA_object_types.h"
+
 #include "MEM_guardedalloc.h"
 
 #include "draw_manager.h"
@@ -361,3 +364,261 @@ void DRW_stats_draw(rcti *rect)
 	BLF_batch_draw_end();
 	BLF_disable(fontid, BLF_SHADOW);
 }
+
+/* -------------------------------------------------------------------- */
+/** \name CPU Profiler
+ *
+ * Unlike the timers above, this works in release builds and is toggled at runtime
+ * (see the gpu.profiler Python module). It records the time spent by each engine
+ * in every stage of the last drawn viewport, the slowest objects to populate and
+ * the number of draw calls, as well as the calls skipped by occlusion culling,
+ * the calls merged into instanced draws and the call states evaluated ahead of drawing passes.
+ * \{ */
+
+static struct DRWProfiler {
+	bool is_enabled;
+	bool is_recording;
+	int draw_calls;
+	int occluded_calls;
+	int instanced_calls;
+	double frame_time_start;
+	DRWProfilerFrame frame;
+	DRWProfilerFrame frame_last;
+} DPF = {false};
+
+static const char *drw_profiler_stage_names[DRW_PROFILER_STAGE_LEN] = {
+	"cache_init",
+	"cache_populate",
+	"cache_finish",
+	"draw_background",
+	"draw_scene",
+};
+
+void DRW_profiler_enable(bool enable)
+{
+	if (enable && !DPF.is_enabled) {
+		memset(&DPF, 0, sizeof(DPF));
+	}
+	DPF.is_enabled = enable;
+}
+
+bool DRW_profiler_is_enabled(void)
+{
+	return DPF.is_enabled;
+}
+
+const char *DRW_profiler_stage_name(eDRWProfilerStage stage)
+{
+	BLI_assert(stage < DRW_PROFILER_STAGE_LEN);
+	return drw_profiler_stage_names[stage];
+}
+
+/* Return the last recorded frame, or NULL if none was recorded since enabling the profiler. */
+const DRWProfilerFrame *DRW_profiler_frame_get(void)
+{
+	return (DPF.frame_last.id != 0) ? &DPF.frame_last : NULL;
+}
+
+void DRW_profiler_frame_begin(void)
+{
+	DPF.is_recording = DPF.is_enabled;
+	if (!DPF.is_recording) {
+		return;
+	}
+
+	const int id = DPF.frame_last.id;
+	memset(&DPF.frame, 0, sizeof(DPF.frame));
+	DPF.frame.id = id + 1;
+	DPF.draw_calls = 0;
+	DPF.occluded_calls = 0;
+	DPF.instanced_calls = 0;
+	DPF.frame_time_start = PIL_check_seconds_timer();
+}
+
+void DRW_profiler_frame_end(void)
+{
+	if (!DPF.is_recording) {
+		return;
+	}
+
+	DPF.frame.total_time = (PIL_check_seconds_timer() - DPF.frame_time_start) * 1e3;
+	DPF.frame.draw_calls = DPF.draw_calls;
+	DPF.frame.occluded_calls = DPF.occluded_calls;
+	DPF.frame.instanced_calls = DPF.instanced_calls;
+
+	DPF.frame_last = DPF.frame;
+	DPF.is_recording = false;
+}
+
+void DRW_profiler_timer_start(DRWProfilerTimer *timer)
+{
+	if (DPF.is_recording) {
+		timer->time_start = PIL_check_seconds_timer();
+		timer->draw_calls_start = DPF.draw_calls;
+	}
+}
+
+static DRWProfilerEngine *drw_profiler_engine_get(const DrawEngineType *engine)
+{
+	DRWProfilerFrame *frame = &DPF.frame;
+
+	for (int i = 0; i < frame->engines_len; i++) {
+		if (STREQ(frame->engines[i].idname, engine->idname)) {
+			return &frame->engines[i];
+		}
+	}
+
+	if (frame->engines_len == DRW_PROFILER_ENGINES_MAX) {
+		return NULL;
+	}
+
+	DRWProfilerEngine *pf_engine = &frame->engines[frame->engines_len++];
+	BLI_strncpy(pf_engine->idname, engine->idname, sizeof(pf_engine->idname));
+	return pf_engine;
+}
+
+void DRW_profiler_stage_end(
+        const DrawEngineType *engine, const eDRWProfilerStage stage, const DRWProfilerTimer *timer)
+{
+	if (!DPF.is_recording) {
+		return;
+	}
+
+	DRWProfilerEngine *pf_engine = drw_profiler_engine_get(engine);
+	if (pf_engine == NULL) {
+		return;
+	}
+
+	pf_engine->stage_time[stage] += (PIL_check_seconds_timer() - timer->time_start) * 1e3;
+	pf_engine->draw_calls += DPF.draw_calls - timer->draw_calls_start;
+}
+
+void DRW_profiler_object_end(const Object *ob, const DRWProfilerTimer *timer)
+{
+	if (!DPF.is_recording) {
+		return;
+	}
+
+	DRWProfilerFrame *frame = &DPF.frame;
+	const double time = (PIL_check_seconds_timer() - timer->time_start) * 1e3;
+
+	frame->objects_len++;
+
+	/* Insertion into the sorted list of slowest objects. */
+	int i = frame->slowest_objects_len;
+	if (i == DRW_PROFILER_OBJECTS_MAX) {
+		if (time <= frame->slowest_objects[i - 1].time) {
+			return;
+		}
+		i--;
+	}
+	else {
+		frame->slowest_objects_len++;
+	}
+	for (; i > 0 && frame->slowest_objects[i - 1].time < time; i--) {
+		frame->slowest_objects[i] = frame->slowest_objects[i - 1];
+	}
+	BLI_strncpy(frame->slowest_objects[i].name, ob->id.name, sizeof(frame->slowest_objects[i].name));
+	frame->slowest_objects[i].time = time;
+}
+
+void DRW_profiler_draw_call_add(void)
+{
+	DPF.draw_calls++;
+}
+
+void DRW_profiler_occluded_call_add(void)
+{
+	DPF.occluded_calls++;
+}
+
+void DRW_profiler_instanced_calls_add(int calls_len)
+{
+	DPF.instanced_calls += calls_len;
+}
+
+void DRW_profiler_call_states_end(const DRWProfilerTimer *timer, int states_len)
+{
+	if (!DPF.is_recording) {
+		return;
+	}
+
+	DPF.frame.call_states_time += (PIL_check_seconds_timer() - timer->time_start) * 1e3;
+	DPF.frame.call_states += states_len;
+}
+
+static void drw_profiler_json_string(FILE *fp, const char *str)
+{
+	fputc('"', fp);
+	for (const char *c = str; *c; c++) {
+		if (ELEM(*c, '"', '\\')) {
+			fprintf(fp, "\\%c", *c);
+		}
+		else if ((unsigned char)*c < 0x20) {
+			fprintf(fp, "\\u%04x", (unsigned char)*c);
+		}
+		else {
+			fputc(*c, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+static void drw_profiler_json_frame(FILE *fp, const DRWProfilerFrame *frame)
+{
+	if (frame == NULL) {
+		fprintf(fp, "null");
+		return;
+	}
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "\t\t\"id\": %d,\n", frame->id);
+	fprintf(fp, "\t\t\"total_time\": %.4f,\n", frame->total_time);
+	fprintf(fp, "\t\t\"objects\": %d,\n", frame->objects_len);
+	fprintf(fp, "\t\t\"draw_calls\": %d,\n", frame->draw_calls);
+	fprintf(fp, "\t\t\"occluded_calls\": %d,\n", frame->occluded_calls);
+	fprintf(fp, "\t\t\"instanced_calls\": %d,\n", frame->instanced_calls);
+	fprintf(fp, "\t\t\"call_states\": %d,\n", frame->call_states);
+	fprintf(fp, "\t\t\"call_states_time\": %.4f,\n", frame->call_states_time);
+
+	fprintf(fp, "\t\t\"engines\": [");
+	for (int i = 0; i < frame->engines_len; i++) {
+		const DRWProfilerEngine *pf_engine = &frame->engines[i];
+		fprintf(fp, "%s\n\t\t\t{\"idname\": ", (i != 0) ? "," : "");
+		drw_profiler_json_string(fp, pf_engine->idname);
+		for (int stage = 0; stage < DRW_PROFILER_STAGE_LEN; stage++) {
+			fprintf(fp, ", \"%s\": %.4f", drw_profiler_stage_names[stage], pf_engine->stage_time[stage]);
+		}
+		fprintf(fp, ", \"draw_calls\": %d}", pf_engine->draw_calls);
+	}
+	fprintf(fp, "\n\t\t],\n");
+
+	fprintf(fp, "\t\t\"slowest_objects\": [");
+	for (int i = 0; i < frame->slowest_objects_len; i++) {
+		const DRWProfilerObject *pf_object = &frame->slowest_objects[i];
+		fprintf(fp, "%s\n\t\t\t{\"name\": ", (i != 0) ? "," : "");
+		/* Skip the ID code. */
+		drw_profiler_json_string(fp, pf_object->name + 2);
+		fprintf(fp, ", \"time\": %.4f}", pf_object->time);
+	}
+	fprintf(fp, "\n\t\t]\n");
+	fprintf(fp, "\t}");
+}
+
+/* Write the last recorded frame as JSON, times are in milliseconds. */
+bool DRW_profiler_write_json(const char *filepath)
+{
+	FILE *fp = BLI_fopen(filepath, "w");
+	if (fp == NULL) {
+		return false;
+	}
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "\t\"last_frame\": ");
+	drw_profiler_json_frame(fp, DRW_profiler_frame_get());
+	fprintf(fp, "\n}\n");
+
+	return (fclose(fp) == 0);
+}
+
+/** \} */
@@ -26,6 +26,8 @@
 #ifndef __DRAW_MANAGER_PROFILING_H__
 #define __DRAW_MANAGER_PROFILING_H__
 
+#include "DRW_engine.h"  /* for eDRWProfilerStage */
+
 struct rcti;
 
 void DRW_stats_free(void);
@@ -40,4 +42,25 @@ void DRW_stats_query_end(void);
 
 void DRW_stats_draw(rcti *rect);
 
+/* CPU profiler, recording only when enabled with DRW_profiler_enable(). */
+struct DrawEngineType;
+struct Object;
+
+typedef struct DRWProfilerTimer {
+	double time_start;
+	int draw_calls_start;
+} DRWProfilerTimer;
+
+void DRW_profiler_frame_begin(void);
+void DRW_profiler_frame_end(void);
+
+void DRW_profiler_timer_start(DRWProfilerTimer *timer);
+void DRW_profiler_stage_end(
+        const struct DrawEngineType *engine, const eDRWProfilerStage stage, const DRWProfilerTimer *timer);
+void DRW_profiler_object_end(const struct Object *ob, const DRWProfilerTimer *timer);
+void DRW_profiler_draw_call_add(void);
+void DRW_profiler_occluded_call_add(void);
+void DRW_profiler_instanced_calls_add(int calls_len);
+void DRW_profiler_call_states_end(const DRWProfilerTimer *timer, int states_len);
+
 #endif /* __DRAW_MANAGER_PROFILING_H__ */
@@ -1236,7 +1236,7 @@ void ED_object_constraint_dependency_update(Main *bmain, Object *ob)
 	if (ob->pose) {
 		object_pose_tag_update(bmain, ob);
 	}
-	DEG_relations_tag_update(bmain);
+	DEG_id_tag_relations_update(bmain, &ob->id);
 }
 
 void ED_object_constraint_tag_update(Main *bmain, Object *ob, bConstraint *con)
@@ -1265,7 +1265,7 @@ void ED_object_constraint_dependency_tag_update(Main *bmain, Object *ob, bConstr
 	if (ob->pose) {
 		object_pose_tag_update(bmain, ob);
 	}
-	DEG_relations_tag_update(bmain);
+	DEG_id_tag_relations_update(bmain, &ob->id);
 }
 
 static bool constraint_poll(bContext *C)
@@ -1290,7 +1290,7 @@ static int constraint_delete_exec(bContext *C, wmOperator *UNUSED(op))
 		ED_object_constraint_update(bmain, ob); /* needed to set the flags on posebones correctly */
 
 		/* relatiols */
-		DEG_relations_tag_update(CTX_data_main(C));
+		DEG_id_tag_relations_update(bmain, &ob->id);
 
 		/* notifiers */
 		WM_event_add_notifier(C, NC_OBJECT | ND_CONSTRAINT | NA_REMOVED, ob);
@@ -48,6 +48,8 @@ enum {
 	GPU_SHADER_FLAGS_NONE = 0,
 	GPU_SHADER_FLAGS_SPECIAL_OPENSUBDIV = (1 << 0),
 	GPU_SHADER_FLAGS_NEW_SHADING        = (1 << 1),
+	/* Hint the driver that the program binary will be read back (see #GPU_pass_compile). */
+	GPU_SHADER_FLAGS_BINARY_RETRIEVABLE = (1 << 2),
 };
 
 typedef enum GPUShaderTFBType {
@@ -33,6 +33,7 @@
 #define __GPU_SHADER_INTERFACE_H__
 
 #include "GPU_common.h"
+#include "GPU_vertex_format.h"
 
 typedef enum {
 	GPU_UNIFORM_NONE = 0, /* uninitialized/unknown */
@@ -74,6 +75,18 @@ typedef struct GPUShaderInput {
 	int32_t location;
 } GPUShaderInput;
 
+/* Attrib locations of a vertex format layout resolved against one shader interface.
+ * Shared by every batch drawing a format with the same attrib names using this shader. */
+typedef struct GPUShaderAttrPlan {
+	struct GPUShaderAttrPlan *next;
+	uint name_hash; /* GPUVertFormat.name_hash */
+	uint attr_len;
+	uint name_offset;
+	uchar name_len[GPU_VERT_ATTR_MAX_LEN];
+	char names[GPU_VERT_ATTR_NAMES_BUF_LEN];
+	int16_t location[GPU_VERT_ATTR_MAX_LEN][GPU_VERT_ATTR_MAX_NAMES]; /* -1 if not used by the shader */
+} GPUShaderAttrPlan;
+
 #define GPU_NUM_SHADERINTERFACE_BUCKETS 257
 #define GPU_SHADERINTERFACE_REF_ALLOC_COUNT 16
 
@@ -87,6 +100,7 @@ typedef struct GPUShaderInterface {
 	char *name_buffer;
 	struct GPUBatch **batches; /* references to batches using this interface */
 	uint batches_len;
+	GPUShaderAttrPlan *attr_plans; /* cached attrib locations per vertex format layout */
 } GPUShaderInterface;
 
 GPUShaderInterface *GPU_shaderinterface_create(int32_t program_id);
@@ -96,6 +110,7 @@ const GPUShaderInput *GPU_shaderinterface_uniform(const GPUShaderInterface *, co
 const GPUShaderInput *GPU_shaderinterface_uniform_builtin(const GPUShaderInterface *, GPUUniformBuiltin);
 const GPUShaderInput *GPU_shaderinterface_ubo(const GPUShaderInterface *, const char *name);
 const GPUShaderInput *GPU_shaderinterface_attr(const GPUShaderInterface *, const char *name);
+const GPUShaderAttrPlan *GPU_shaderinterface_attr_plan(const GPUShaderInterface *, const GPUVertFormat *);
 
 /* keep track of batches using this interface */
 void GPU_shaderinterface_add_batch_ref(GPUShaderInterface *, struct GPUBatch *);
@@ -42,6 +42,7 @@ GPUUniformBuffer *GPU_uniformbuffer_dynamic_create(struct ListBase *inputs, char
 void GPU_uniformbuffer_free(GPUUniformBuffer *ubo);
 
 void GPU_uniformbuffer_update(GPUUniformBuffer *ubo, const void *data);
+void GPU_uniformbuffer_update_range(GPUUniformBuffer *ubo, const void *data, int size);
 void GPU_uniformbuffer_dynamic_update(GPUUniformBuffer *ubo_);
 
 void GPU_uniformbuffer_bind(GPUUniformBuffer *ubo, int number);
@@ -75,6 +75,7 @@ typedef struct GPUVertFormat {
 	uint name_len; /* total count of active vertex attrib */
 	uint stride; /* stride in bytes, 1 to 256 */
 	uint name_offset;
+	uint name_hash; /* hash of all attrib names & aliases, computed when packed */
 	bool packed;
 	char names[GPU_VERT_ATTR_NAMES_BUF_LEN];
 	GPUVertAttr attribs[GPU_VERT_ATTR_MAX_LEN]; /* TODO: variable-size attribs array */
@@ -71,15 +71,17 @@ void get_attrib_locations(const GPUVertFormat *format, GPUAttrBinding *binding,
 {
 	AttribBinding_clear(binding);
 
+	const GPUShaderAttrPlan *plan = GPU_shaderinterface_attr_plan(shaderface, format);
+
 	for (uint a_idx = 0; a_idx < format->attr_len; ++a_idx) {
 		const GPUVertAttr *a = format->attribs + a_idx;
 		for (uint n_idx = 0; n_idx < a->name_len; ++n_idx) {
-			const GPUShaderInput *input = GPU_shaderinterface_attr(shaderface, a->name[n_idx]);
+			const int location = plan->location[a_idx][n_idx];
 #if TRUST_NO_ONE
-			assert(input != NULL);
+			assert(location != -1);
 			/* TODO: make this a recoverable runtime error? indicates mismatch between vertex format and program */
 #endif
-			write_attrib_location(binding, a_idx, input->location);
+			write_attrib_location(binding, a_idx, location);
 		}
 	}
 }
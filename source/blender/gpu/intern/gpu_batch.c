@@ -343,6 +343,7 @@ static void create_bindings(
 
 	const uint attr_len = format->attr_len;
 	const uint stride = format->stride;
+	const GPUShaderAttrPlan *plan = GPU_shaderinterface_attr_plan(interface, format);
 
 	GPU_vertbuf_use(verts);
 
@@ -351,9 +352,9 @@ static void create_bindings(
 		const GLvoid *pointer = (const GLubyte *)0 + a->offset + v_first * stride;
 
 		for (uint n_idx = 0; n_idx < a->name_len; ++n_idx) {
-			const GPUShaderInput *input = GPU_shaderinterface_attr(interface, a->name[n_idx]);
+			const int location = plan->location[a_idx][n_idx];
 
-			if (input == NULL) continue;
+			if (location == -1) continue;
 
 			if (a->comp_len == 16 || a->comp_len == 12 || a->comp_len == 8) {
 #if TRUST_NO_ONE
@@ -361,26 +362,26 @@ static void create_bindings(
 				assert(a->gl_comp_type == GL_FLOAT);
 #endif
 				for (int i = 0; i < a->comp_len / 4; ++i) {
-					glEnableVertexAttribArray(input->location + i);
-					glVertexAttribDivisor(input->location + i, (use_instancing) ? 1 : 0);
-					glVertexAttribPointer(input->location + i, 4, a->gl_comp_type, GL_FALSE, stride,
+					glEnableVertexAttribArray(location + i);
+					glVertexAttribDivisor(location + i, (use_instancing) ? 1 : 0);
+					glVertexAttribPointer(location + i, 4, a->gl_comp_type, GL_FALSE, stride,
 					                      (const GLubyte *)pointer + i * 16);
 				}
 			}
 			else {
-				glEnableVertexAttribArray(input->location);
-				glVertexAttribDivisor(input->location, (use_instancing) ? 1 : 0);
+				glEnableVertexAttribArray(location);
+				glVertexAttribDivisor(location, (use_instancing) ? 1 : 0);
 
 				switch (a->fetch_mode) {
 					case GPU_FETCH_FLOAT:
 					case GPU_FETCH_INT_TO_FLOAT:
-						glVertexAttribPointer(input->location, a->comp_len, a->gl_comp_type, GL_FALSE, stride, pointer);
+						glVertexAttribPointer(location, a->comp_len, a->gl_comp_type, GL_FALSE, stride, pointer);
 						break;
 					case GPU_FETCH_INT_TO_FLOAT_UNIT:
-						glVertexAttribPointer(input->location, a->comp_len, a->gl_comp_type, GL_TRUE, stride, pointer);
+						glVertexAttribPointer(location, a->comp_len, a->gl_comp_type, GL_TRUE, stride, pointer);
 						break;
 					case GPU_FETCH_INT:
-						glVertexAttribIPointer(input->location, a->comp_len, a->gl_comp_type, stride, pointer);
+						glVertexAttribIPointer(location, a->comp_len, a->gl_comp_type, stride, pointer);
 						break;
 				}
 			}
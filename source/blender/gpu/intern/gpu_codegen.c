@@ -39,6 +39,7 @@
 #include "DNA_node_types.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_fileops_types.h"
 #include "BLI_hash_mm2a.h"
 #include "BLI_link_utils.h"
 #include "BLI_utildefines.h"
@@ -46,6 +47,10 @@
 #include "BLI_ghash.h"
 #include "BLI_threads.h"
 
+#include "BKE_appdir.h"
+#include "BKE_blender_version.h"
+#include "BKE_global.h"
+
 #include "PIL_time.h"
 
 #include "GPU_extensions.h"
@@ -58,9 +63,11 @@
 #include "BLI_sys_types.h" /* for intptr_t support */
 
 #include "gpu_codegen.h"
+#include "gpu_shader_private.h"
 
 #include <string.h>
 #include <stdarg.h>
+#include <stdio.h>
 
 extern char datatoc_gpu_shader_material_glsl[];
 extern char datatoc_gpu_shader_geometry_glsl[];
@@ -131,6 +138,235 @@ static GPUPass *gpu_pass_cache_resolve_collision(
 	return NULL;
 }
 
+/* -------------------- GPUPass Disk Cache ------------------ */
+/**
+ * Persistent cache of linked program binaries, shared between sessions.
+ *
+ * Material shaders are keyed by a hash of their generated GLSL, the driver
+ * and the Blender version, so a driver or Blender update naturally misses.
+ * The GLSL is stored along with the binary and compared on load, a hash
+ * collision only costs a regular compilation. The directory is trimmed on
+ * startup, oldest files first (files are touched on every hit).
+ **/
+
+#define GPU_DISK_CACHE_DIRNAME "shader_cache"
+#define GPU_DISK_CACHE_EXT ".bin"
+#define GPU_DISK_CACHE_VERSION 1
+/* Size at which the cache gets trimmed on startup, down to 3/4 of it. */
+#define GPU_DISK_CACHE_SIZE_MAX ((size_t)512 * 1024 * 1024)
+
+static const char gpu_disk_cache_magic[8] = "BLGPUSB";
+
+typedef struct GPUPassDiskCacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t binary_format;
+	uint32_t binary_len;
+	/* Length + 1 of each source (zero when NULL): vertex, geometry, fragment, defines. */
+	uint32_t source_len[4];
+} GPUPassDiskCacheHeader;
+
+static struct {
+	bool enabled;
+	char dirpath[FILE_MAX];
+	/* Identifies the driver & Blender build, part of every key. */
+	char driver[512];
+} gpu_disk_cache = {false};
+
+static void gpu_pass_disk_cache_sources(const GPUPass *pass, const char *r_sources[4])
+{
+	r_sources[0] = pass->vertexcode;
+	r_sources[1] = pass->geometrycode;
+	r_sources[2] = pass->fragmentcode;
+	r_sources[3] = pass->defines;
+}
+
+static void gpu_pass_disk_cache_filepath(const GPUPass *pass, char r_filepath[FILE_MAX])
+{
+	const char *sources[4];
+	uint32_t hash[2];
+
+	gpu_pass_disk_cache_sources(pass, sources);
+
+	/* Two seeds give a 64 bit key, the in memory 32 bit hash collides too often across sessions. */
+	for (int seed = 0; seed < 2; seed++) {
+		BLI_HashMurmur2A hm2a;
+		BLI_hash_mm2a_init(&hm2a, (uint32_t)seed);
+		BLI_hash_mm2a_add(&hm2a, (const unsigned char *)gpu_disk_cache.driver, strlen(gpu_disk_cache.driver));
+		for (int i = 0; i < 4; i++) {
+			if (sources[i]) {
+				BLI_hash_mm2a_add(&hm2a, (const unsigned char *)sources[i], strlen(sources[i]) + 1);
+			}
+			else {
+				BLI_hash_mm2a_add_int(&hm2a, 0);
+			}
+		}
+		hash[seed] = BLI_hash_mm2a_end(&hm2a);
+	}
+
+	char filename[FILE_MAXFILE];
+	BLI_snprintf(filename, sizeof(filename), "%08x%08x" GPU_DISK_CACHE_EXT, hash[0], hash[1]);
+	BLI_join_dirfile(r_filepath, FILE_MAX, gpu_disk_cache.dirpath, filename);
+}
+
+static int gpu_disk_cache_file_cmp_mtime(const void *a_v, const void *b_v)
+{
+	const struct direntry *a = a_v, *b = b_v;
+	if (a->s.st_mtime < b->s.st_mtime) return -1;
+	if (a->s.st_mtime > b->s.st_mtime) return 1;
+	return 0;
+}
+
+/* Remove the least recently used files once the cache exceeds #GPU_DISK_CACHE_SIZE_MAX. */
+static void gpu_pass_disk_cache_trim(void)
+{
+	struct direntry *files;
+	const uint files_len = BLI_filelist_dir_contents(gpu_disk_cache.dirpath, &files);
+	size_t total_size = 0;
+
+	for (uint i = 0; i < files_len; i++) {
+		if (S_ISREG(files[i].s.st_mode) && BLI_path_extension_check(files[i].relname, GPU_DISK_CACHE_EXT)) {
+			total_size += (size_t)files[i].s.st_size;
+		}
+	}
+
+	if (total_size > GPU_DISK_CACHE_SIZE_MAX) {
+		qsort(files, files_len, sizeof(*files), gpu_disk_cache_file_cmp_mtime);
+		for (uint i = 0; i < files_len && total_size > (GPU_DISK_CACHE_SIZE_MAX / 4) * 3; i++) {
+			if (S_ISREG(files[i].s.st_mode) && BLI_path_extension_check(files[i].relname, GPU_DISK_CACHE_EXT)) {
+				if (BLI_delete(files[i].path, false, false) == 0) {
+					total_size -= (size_t)files[i].s.st_size;
+				}
+			}
+		}
+	}
+
+	BLI_filelist_free(files, files_len);
+}
+
+/* Needs an active OpenGL context, to identify the driver. */
+static void gpu_pass_disk_cache_init(void)
+{
+	gpu_disk_cache.enabled = false;
+
+	/* Shader dumps need the sources to actually go through the compiler. */
+	if ((G.debug & G_DEBUG_GPU_SHADERS) || !gpu_shader_binary_supported()) {
+		return;
+	}
+
+	const char *dirpath = BKE_appdir_folder_id_create(BLENDER_USER_DATAFILES, GPU_DISK_CACHE_DIRNAME);
+	if (dirpath == NULL) {
+		return;
+	}
+	BLI_strncpy(gpu_disk_cache.dirpath, dirpath, sizeof(gpu_disk_cache.dirpath));
+
+	BLI_snprintf(
+	        gpu_disk_cache.driver, sizeof(gpu_disk_cache.driver), "%s|%s|%s|%d.%d|%s",
+	        (const char *)glGetString(GL_VENDOR),
+	        (const char *)glGetString(GL_RENDERER),
+	        (const char *)glGetString(GL_VERSION),
+	        BLENDER_VERSION, BLENDER_SUBVERSION,
+	        gpu_disk_cache_magic);
+
+	gpu_pass_disk_cache_trim();
+
+	gpu_disk_cache.enabled = true;
+}
+
+/* Return the shader stored for this pass, or NULL on any mismatch. */
+static GPUShader *gpu_pass_disk_cache_load(const GPUPass *pass, const char *filepath, const char *shname)
+{
+	size_t data_len;
+	char *data = BLI_file_read_binary_as_mem(filepath, 0, &data_len);
+	GPUShader *shader = NULL;
+
+	if (data == NULL) {
+		return NULL;
+	}
+
+	const GPUPassDiskCacheHeader *header = (const GPUPassDiskCacheHeader *)data;
+	if ((data_len < sizeof(*header)) ||
+	    (memcmp(header->magic, gpu_disk_cache_magic, sizeof(header->magic)) != 0) ||
+	    (header->version != GPU_DISK_CACHE_VERSION))
+	{
+		goto finally;
+	}
+
+	const char *sources[4];
+	gpu_pass_disk_cache_sources(pass, sources);
+
+	size_t offset = sizeof(*header);
+	for (int i = 0; i < 4; i++) {
+		const uint32_t len = sources[i] ? (uint32_t)strlen(sources[i]) + 1 : 0;
+		if ((header->source_len[i] != len) ||
+		    (offset + len > data_len) ||
+		    (len && memcmp(data + offset, sources[i], len) != 0))
+		{
+			goto finally;
+		}
+		offset += len;
+	}
+
+	if (offset + header->binary_len != data_len) {
+		goto finally;
+	}
+
+	shader = gpu_shader_create_from_binary(data + offset, (int)header->binary_len, header->binary_format, shname);
+	if (shader) {
+		/* Keep recently used entries from being trimmed. */
+		BLI_file_touch(filepath);
+	}
+
+finally:
+	MEM_freeN(data);
+	return shader;
+}
+
+static void gpu_pass_disk_cache_store(const GPUPass *pass, const char *filepath)
+{
+	GPUPassDiskCacheHeader header = {{0}};
+	int binary_len;
+	uint binary_format;
+	void *binary = gpu_shader_binary_get(pass->shader, &binary_len, &binary_format);
+
+	if (binary == NULL) {
+		return;
+	}
+
+	const char *sources[4];
+	gpu_pass_disk_cache_sources(pass, sources);
+
+	memcpy(header.magic, gpu_disk_cache_magic, sizeof(header.magic));
+	header.version = GPU_DISK_CACHE_VERSION;
+	header.binary_format = binary_format;
+	header.binary_len = (uint32_t)binary_len;
+	for (int i = 0; i < 4; i++) {
+		header.source_len[i] = sources[i] ? (uint32_t)strlen(sources[i]) + 1 : 0;
+	}
+
+	/* Write to a temporary file first so other instances never read partial entries. */
+	char filepath_tmp[FILE_MAX];
+	BLI_snprintf(filepath_tmp, sizeof(filepath_tmp), "%s.%p.tmp", filepath, (const void *)pass);
+
+	FILE *f = BLI_fopen(filepath_tmp, "wb");
+	if (f != NULL) {
+		bool ok = (fwrite(&header, sizeof(header), 1, f) == 1);
+		for (int i = 0; i < 4 && ok; i++) {
+			if (header.source_len[i]) {
+				ok = (fwrite(sources[i], header.source_len[i], 1, f) == 1);
+			}
+		}
+		ok = ok && (fwrite(binary, (size_t)binary_len, 1, f) == 1);
+		ok = (fclose(f) == 0) && ok;
+
+		if (!ok || BLI_rename(filepath_tmp, filepath) != 0) {
+			BLI_delete(filepath_tmp, false, false);
+		}
+	}
+
+	MEM_freeN(binary);
+}
+
 /* -------------------- GPU Codegen ------------------ */
 
 /* type definitions and constants */
@@ -338,19 +574,23 @@ static char *gpu_generate_function_prototyps(GHash *hash)
 }
 #endif
 
+/* Read only after #gpu_codegen_init, safe to use from any thread. */
 static GPUFunction *gpu_lookup_function(const char *name)
 {
-	if (!FUNCTION_HASH) {
-		FUNCTION_HASH = BLI_ghash_str_new("GPU_lookup_function gh");
-		gpu_parse_functions_string(FUNCTION_HASH, glsl_material_library);
-	}
-
+	BLI_assert(FUNCTION_HASH != NULL);
 	return BLI_ghash_lookup(FUNCTION_HASH, (const void *)name);
 }
 
 void gpu_codegen_init(void)
 {
 	GPU_code_generate_glsl_lib();
+
+	/* Parse the function library once up-front instead of lazily on first lookup,
+	 * so code generation never modifies shared state. */
+	if (!FUNCTION_HASH) {
+		FUNCTION_HASH = BLI_ghash_str_new("GPU_lookup_function gh");
+		gpu_parse_functions_string(FUNCTION_HASH, glsl_material_library);
+	}
 }
 
 void gpu_codegen_exit(void)
@@ -1814,13 +2054,30 @@ GPUPass *GPU_generate_pass_new(
 void GPU_pass_compile(GPUPass *pass, const char *shname)
 {
 	if (!pass->compiled) {
-		pass->shader = GPU_shader_create(
-		        pass->vertexcode,
-		        pass->fragmentcode,
-		        pass->geometrycode,
-		        NULL,
-		        pass->defines,
-		        shname);
+		char filepath[FILE_MAX];
+
+		if (gpu_disk_cache.enabled) {
+			gpu_pass_disk_cache_filepath(pass, filepath);
+			pass->shader = gpu_pass_disk_cache_load(pass, filepath, shname);
+		}
+
+		if (pass->shader == NULL) {
+			pass->shader = GPU_shader_create_ex(
+			        pass->vertexcode,
+			        pass->fragmentcode,
+			        pass->geometrycode,
+			        NULL,
+			        pass->defines,
+			        gpu_disk_cache.enabled ? GPU_SHADER_FLAGS_BINARY_RETRIEVABLE : GPU_SHADER_FLAGS_NONE,
+			        GPU_SHADER_TFB_NONE,
+			        NULL,
+			        0,
+			        shname);
+
+			if (pass->shader && gpu_disk_cache.enabled) {
+				gpu_pass_disk_cache_store(pass, filepath);
+			}
+		}
 		pass->compiled = true;
 	}
 }
@@ -1879,6 +2136,7 @@ void GPU_pass_cache_garbage_collect(void)
 void GPU_pass_cache_init(void)
 {
 	BLI_spin_init(&pass_cache_spin);
+	gpu_pass_disk_cache_init();
 }
 
 void GPU_pass_cache_free(void)
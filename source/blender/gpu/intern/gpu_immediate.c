@@ -47,6 +47,17 @@
 extern void GPU_matrix_bind(const GPUShaderInterface *);
 extern bool GPU_matrix_dirty_get(void);
 
+/* size of internal buffer -- make this adjustable? */
+#define IMM_BUFFER_SIZE (4 * 1024 * 1024)
+
+/* With ARB_buffer_storage, map a larger buffer once and use it as a ring, instead of mapping
+ * a range for every immBegin. Each segment is fenced when left and waited on before it is
+ * written again, so the GPU is never reading what we overwrite. A draw never needs more than
+ * IMM_BUFFER_SIZE so it spans at most two segments. */
+#define IMM_USE_PERSISTENT_BUFFER
+#define IMM_RING_SEGMENTS 4
+#define IMM_RING_SIZE (IMM_RING_SEGMENTS * IMM_BUFFER_SIZE)
+
 typedef struct {
 	/* TODO: organize this struct by frequency of change (run-time) */
 
@@ -71,15 +82,28 @@ typedef struct {
 	GLuint vbo_id;
 	GLuint vao_id;
 
+	/* Persistently mapped ring buffer (see IMM_USE_PERSISTENT_BUFFER), NULL when not supported. */
+	GLubyte *buffer_persistent;
+	uint ring_segment;
+	GLsync ring_fences[IMM_RING_SEGMENTS];
+
+	/* Vertex attributes of the last draw, they don't need to be specified again when unchanged. */
+	bool attrib_setup_valid;
+	uint attrib_setup_stride;
+	uint attrib_setup_len;
+	struct {
+		uint loc, offset;
+		GPUVertFetchMode fetch_mode;
+		GLenum gl_comp_type;
+		uint comp_len;
+	} attrib_setup[GPU_VERT_ATTR_MAX_LEN];
+
 	GLuint bound_program;
 	const GPUShaderInterface *shader_interface;
 	GPUAttrBinding attrib_binding;
 	uint16_t prev_enabled_attrib_bits; /* <-- only affects this VAO, so we're ok */
 } Immediate;
 
-/* size of internal buffer -- make this adjustable? */
-#define IMM_BUFFER_SIZE (4 * 1024 * 1024)
-
 static bool initialized = false;
 static Immediate imm;
 
@@ -92,7 +116,18 @@ void immInit(void)
 
 	imm.vbo_id = GPU_buf_alloc();
 	glBindBuffer(GL_ARRAY_BUFFER, imm.vbo_id);
-	glBufferData(GL_ARRAY_BUFFER, IMM_BUFFER_SIZE, NULL, GL_DYNAMIC_DRAW);
+
+#ifdef IMM_USE_PERSISTENT_BUFFER
+	if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, IMM_RING_SIZE, NULL, flags);
+		imm.buffer_persistent = glMapBufferRange(GL_ARRAY_BUFFER, 0, IMM_RING_SIZE, flags);
+	}
+	if (imm.buffer_persistent == NULL)
+#endif
+	{
+		glBufferData(GL_ARRAY_BUFFER, IMM_BUFFER_SIZE, NULL, GL_DYNAMIC_DRAW);
+	}
 
 	imm.prim_type = GPU_PRIM_NONE;
 	imm.strict_vertex_len = true;
@@ -110,6 +145,7 @@ void immActivate(void)
 #endif
 	imm.vao_id = GPU_vao_alloc();
 	imm.context = GPU_context_active_get();
+	imm.attrib_setup_valid = false;
 }
 
 void immDeactivate(void)
@@ -122,10 +158,21 @@ void immDeactivate(void)
 	GPU_vao_free(imm.vao_id, imm.context);
 	imm.vao_id = 0;
 	imm.prev_enabled_attrib_bits = 0;
+	imm.attrib_setup_valid = false;
 }
 
 void immDestroy(void)
 {
+	if (imm.buffer_persistent) {
+		glBindBuffer(GL_ARRAY_BUFFER, imm.vbo_id);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		for (uint i = 0; i < IMM_RING_SEGMENTS; i++) {
+			if (imm.ring_fences[i]) {
+				glDeleteSync(imm.ring_fences[i]);
+			}
+		}
+	}
 	GPU_buf_free(imm.vbo_id);
 	initialized = false;
 }
@@ -200,6 +247,53 @@ static bool vertex_count_makes_sense_for_primitive(uint vertex_len, GPUPrimType
 }
 #endif
 
+static void immRingSegmentWait(uint segment)
+{
+	GLsync fence = imm.ring_fences[segment];
+	if (fence) {
+		/* Only blocks if the GPU is still reading the segment, a full ring behind. */
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+			/* pass */
+		}
+		glDeleteSync(fence);
+		imm.ring_fences[segment] = NULL;
+	}
+}
+
+/* Fence the segments left behind, they only contain data of draws already issued. */
+static void immRingSegmentAdvance(uint segment, bool wait)
+{
+	while (imm.ring_segment != segment) {
+		imm.ring_fences[imm.ring_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		imm.ring_segment = (imm.ring_segment + 1) % IMM_RING_SEGMENTS;
+		if (wait) {
+			immRingSegmentWait(imm.ring_segment);
+		}
+	}
+}
+
+static void immBeginPersistent(uint bytes_needed)
+{
+	const uint pre_padding = padding(imm.buffer_offset, imm.vertex_format.stride);
+	if (imm.buffer_offset + pre_padding + bytes_needed <= IMM_RING_SIZE) {
+		imm.buffer_offset += pre_padding;
+	}
+	else {
+		imm.buffer_offset = 0;
+	}
+
+	const uint segment_first = imm.buffer_offset / IMM_BUFFER_SIZE;
+	const uint segment_last = (imm.buffer_offset + bytes_needed - 1) / IMM_BUFFER_SIZE;
+
+	immRingSegmentAdvance(segment_first, true);
+	if (segment_last != segment_first) {
+		/* Spanning two segments, the first one is fenced after the draw (see immEnd). */
+		immRingSegmentWait(segment_last);
+	}
+
+	imm.buffer_data = imm.buffer_persistent + imm.buffer_offset;
+}
+
 void immBegin(GPUPrimType prim_type, uint vertex_len)
 {
 #if TRUST_NO_ONE
@@ -219,6 +313,13 @@ void immBegin(GPUPrimType prim_type, uint vertex_len)
 	assert(bytes_needed <= IMM_BUFFER_SIZE);
 #endif
 
+	if (imm.buffer_persistent) {
+		immBeginPersistent(bytes_needed);
+		imm.buffer_bytes_mapped = bytes_needed;
+		imm.vertex_data = imm.buffer_data;
+		return;
+	}
+
 	glBindBuffer(GL_ARRAY_BUFFER, imm.vbo_id);
 
 	/* does the current buffer have enough room? */
@@ -290,6 +391,30 @@ GPUBatch *immBeginBatchAtMost(GPUPrimType prim_type, uint vertex_len)
 	return immBeginBatch(prim_type, vertex_len);
 }
 
+/* Is the layout of the current vertex format the same as the one of the last draw? */
+static bool immAttribSetupMatch(void)
+{
+	if (!imm.attrib_setup_valid ||
+	    (imm.attrib_setup_stride != imm.vertex_format.stride) ||
+	    (imm.attrib_setup_len != imm.vertex_format.attr_len))
+	{
+		return false;
+	}
+
+	for (uint a_idx = 0; a_idx < imm.vertex_format.attr_len; ++a_idx) {
+		const GPUVertAttr *a = imm.vertex_format.attribs + a_idx;
+		if ((imm.attrib_setup[a_idx].loc != read_attrib_location(&imm.attrib_binding, a_idx)) ||
+		    (imm.attrib_setup[a_idx].offset != a->offset) ||
+		    (imm.attrib_setup[a_idx].fetch_mode != a->fetch_mode) ||
+		    (imm.attrib_setup[a_idx].gl_comp_type != a->gl_comp_type) ||
+		    (imm.attrib_setup[a_idx].comp_len != a->comp_len))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 static void immDrawSetup(void)
 {
 	/* set up VAO -- can be done during Begin or End really */
@@ -312,16 +437,38 @@ static void immDrawSetup(void)
 		imm.prev_enabled_attrib_bits = imm.attrib_binding.enabled_bits;
 	}
 
+	/* Attributes point to the start of the buffer, immEnd draws from the first vertex at
+	 * buffer_offset (always a multiple of the stride). Consecutive draws with the same layout,
+	 * the common case for UI drawing, don't have to specify them again. */
+	if (immAttribSetupMatch()) {
+		if (GPU_matrix_dirty_get()) {
+			GPU_matrix_bind(imm.shader_interface);
+		}
+		return;
+	}
+
 	const uint stride = imm.vertex_format.stride;
 
+	glBindBuffer(GL_ARRAY_BUFFER, imm.vbo_id);
+
+	imm.attrib_setup_valid = true;
+	imm.attrib_setup_stride = stride;
+	imm.attrib_setup_len = imm.vertex_format.attr_len;
+
 	for (uint a_idx = 0; a_idx < imm.vertex_format.attr_len; ++a_idx) {
 		const GPUVertAttr *a = imm.vertex_format.attribs + a_idx;
 
-		const uint offset = imm.buffer_offset + a->offset;
+		const uint offset = a->offset;
 		const GLvoid *pointer = (const GLubyte *)0 + offset;
 
 		const uint loc = read_attrib_location(&imm.attrib_binding, a_idx);
 
+		imm.attrib_setup[a_idx].loc = loc;
+		imm.attrib_setup[a_idx].offset = a->offset;
+		imm.attrib_setup[a_idx].fetch_mode = a->fetch_mode;
+		imm.attrib_setup[a_idx].gl_comp_type = a->gl_comp_type;
+		imm.attrib_setup[a_idx].comp_len = a->comp_len;
+
 		switch (a->fetch_mode) {
 			case GPU_FETCH_FLOAT:
 			case GPU_FETCH_INT_TO_FLOAT:
@@ -369,7 +516,9 @@ void immEnd(void)
 			/* unused buffer bytes are available to the next immBegin */
 		}
 		/* tell OpenGL what range was modified so it doesn't copy the whole mapped range */
-		glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, buffer_bytes_used);
+		if (!imm.buffer_persistent) {
+			glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, buffer_bytes_used);
+		}
 	}
 
 	if (imm.batch) {
@@ -382,10 +531,16 @@ void immEnd(void)
 		imm.batch = NULL; /* don't free, batch belongs to caller */
 	}
 	else {
-		glUnmapBuffer(GL_ARRAY_BUFFER);
+		if (!imm.buffer_persistent) {
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
 		if (imm.vertex_len > 0) {
 			immDrawSetup();
-			glDrawArrays(convert_prim_type_to_gl(imm.prim_type), 0, imm.vertex_len);
+			glDrawArrays(convert_prim_type_to_gl(imm.prim_type),
+			             imm.buffer_offset / imm.vertex_format.stride, imm.vertex_len);
+		}
+		if (imm.buffer_persistent && buffer_bytes_used > 0) {
+			immRingSegmentAdvance((imm.buffer_offset + buffer_bytes_used - 1) / IMM_BUFFER_SIZE, false);
 		}
 		/* These lines are causing crash on startup on some old GPU + drivers.
 		 * They are not required so just comment them. (T55722) */
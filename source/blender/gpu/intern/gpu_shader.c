@@ -354,6 +354,100 @@ static void gpu_dump_shaders(const char **code, const int num_shaders, const cha
 	printf("Shader file written to disk: %s\n", shader_path);
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Program Binaries
+ *
+ * Used by the material pass disk cache (see gpu_codegen.c) to skip GLSL compilation
+ * of shaders already compiled by a previous session on the same driver.
+ * \{ */
+
+bool gpu_shader_binary_supported(void)
+{
+	static int supported = -1;
+
+	if (supported == -1) {
+		GLint num_formats = 0;
+		if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+		}
+		supported = (num_formats > 0);
+	}
+	return (supported == 1);
+}
+
+/**
+ * Create a shader from a program binary returned by #gpu_shader_binary_get.
+ * Returns NULL when the driver rejects the binary (e.g. after a driver update),
+ * in which case the caller is expected to compile from source.
+ */
+GPUShader *gpu_shader_create_from_binary(
+        const void *binary, const int binary_len, const unsigned int binary_format, const char *shname)
+{
+	GLint status;
+
+	if (!gpu_shader_binary_supported()) {
+		return NULL;
+	}
+
+	GPUShader *shader = MEM_callocN(sizeof(GPUShader), "GPUShader");
+
+#ifndef NDEBUG
+	BLI_snprintf(shader->name, sizeof(shader->name), "%s_%u", shname, g_shaderid++);
+#else
+	UNUSED_VARS(shname);
+#endif
+
+	shader->program = glCreateProgram();
+	if (!shader->program) {
+		GPU_shader_free(shader);
+		return NULL;
+	}
+
+	glProgramBinary(shader->program, binary_format, binary, binary_len);
+	glGetProgramiv(shader->program, GL_LINK_STATUS, &status);
+	if (!status) {
+		GPU_shader_free(shader);
+		return NULL;
+	}
+
+	shader->interface = GPU_shaderinterface_create(shader->program);
+
+	return shader;
+}
+
+/**
+ * Return a newly allocated copy of the linked program binary, or NULL if the driver
+ * can't provide one. The shader must have been created with #GPU_SHADER_FLAGS_BINARY_RETRIEVABLE.
+ */
+void *gpu_shader_binary_get(GPUShader *shader, int *r_binary_len, unsigned int *r_binary_format)
+{
+	GLint binary_len = 0;
+	GLenum binary_format = 0;
+
+	if (!gpu_shader_binary_supported()) {
+		return NULL;
+	}
+
+	glGetProgramiv(shader->program, GL_PROGRAM_BINARY_LENGTH, &binary_len);
+	if (binary_len <= 0) {
+		return NULL;
+	}
+
+	void *binary = MEM_mallocN((size_t)binary_len, __func__);
+	GLsizei length = 0;
+	glGetProgramBinary(shader->program, binary_len, &length, &binary_format, binary);
+	if (length <= 0) {
+		MEM_freeN(binary);
+		return NULL;
+	}
+
+	*r_binary_len = length;
+	*r_binary_format = binary_format;
+	return binary;
+}
+
+/** \} */
+
 GPUShader *GPU_shader_create_ex(
         const char *vertexcode,
         const char *fragcode,
@@ -369,7 +463,6 @@ GPUShader *GPU_shader_create_ex(
 #ifdef WITH_OPENSUBDIV
 	bool use_opensubdiv = (flags & GPU_SHADER_FLAGS_SPECIAL_OPENSUBDIV) != 0;
 #else
-	UNUSED_VARS(flags);
 	bool use_opensubdiv = false;
 #endif
 	GLint status;
@@ -525,6 +618,10 @@ GPUShader *GPU_shader_create_ex(
 		shader->feedback_transform_type = tf_type;
 	}
 
+	if ((flags & GPU_SHADER_FLAGS_BINARY_RETRIEVABLE) && gpu_shader_binary_supported()) {
+		glProgramParameteri(shader->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
 	glLinkProgram(shader->program);
 	glGetProgramiv(shader->program, GL_LINK_STATUS, &status);
 	if (!status) {
@@ -304,6 +304,11 @@ void GPU_shaderinterface_discard(GPUShaderInterface *shaderface)
 		}
 	}
 	MEM_freeN(shaderface->batches);
+	/* Free cached attrib locations. */
+	for (GPUShaderAttrPlan *plan = shaderface->attr_plans, *plan_next; plan; plan = plan_next) {
+		plan_next = plan->next;
+		MEM_freeN(plan);
+	}
 	/* Free memory used by shader interface by its self. */
 	MEM_freeN(shaderface);
 }
@@ -340,6 +345,56 @@ const GPUShaderInput *GPU_shaderinterface_attr(const GPUShaderInterface *shaderf
 	return buckets_lookup(shaderface->attrib_buckets, shaderface->name_buffer, name);
 }
 
+static bool attr_plan_match(const GPUShaderAttrPlan *plan, const GPUVertFormat *format)
+{
+	if (plan->name_hash != format->name_hash ||
+	    plan->attr_len != format->attr_len ||
+	    plan->name_offset != format->name_offset)
+	{
+		return false;
+	}
+	for (uint a_idx = 0; a_idx < format->attr_len; ++a_idx) {
+		if (plan->name_len[a_idx] != format->attribs[a_idx].name_len) {
+			return false;
+		}
+	}
+	return memcmp(plan->names, format->names, format->name_offset) == 0;
+}
+
+/* Resolving attrib names is a string hash & compare per name, which adds up when
+ * many batches are (re)bound. Resolve each format layout once per interface instead. */
+const GPUShaderAttrPlan *GPU_shaderinterface_attr_plan(const GPUShaderInterface *shaderface, const GPUVertFormat *format)
+{
+#if TRUST_NO_ONE
+	assert(format->packed);
+#endif
+	for (GPUShaderAttrPlan *plan = shaderface->attr_plans; plan; plan = plan->next) {
+		if (attr_plan_match(plan, format)) {
+			return plan;
+		}
+	}
+
+	GPUShaderAttrPlan *plan = MEM_mallocN(sizeof(GPUShaderAttrPlan), "GPUShaderAttrPlan");
+	plan->name_hash = format->name_hash;
+	plan->attr_len = format->attr_len;
+	plan->name_offset = format->name_offset;
+	memcpy(plan->names, format->names, format->name_offset);
+
+	for (uint a_idx = 0; a_idx < format->attr_len; ++a_idx) {
+		const GPUVertAttr *a = format->attribs + a_idx;
+		plan->name_len[a_idx] = a->name_len;
+		for (uint n_idx = 0; n_idx < a->name_len; ++n_idx) {
+			const GPUShaderInput *input = GPU_shaderinterface_attr(shaderface, a->name[n_idx]);
+			plan->location[a_idx][n_idx] = (input != NULL) ? input->location : -1;
+		}
+	}
+
+	/* Interfaces are otherwise immutable, the plan list is only a cache. */
+	plan->next = shaderface->attr_plans;
+	((GPUShaderInterface *)shaderface)->attr_plans = plan;
+	return plan;
+}
+
 void GPU_shaderinterface_add_batch_ref(GPUShaderInterface *shaderface, GPUBatch *batch)
 {
 	int i; /* find first unused slot */
@@ -43,4 +43,10 @@ struct GPUShader {
 #endif
 };
 
+/* Program binaries (see gpu_shader.c). */
+bool gpu_shader_binary_supported(void);
+struct GPUShader *gpu_shader_create_from_binary(
+        const void *binary, const int binary_len, const unsigned int binary_format, const char *shname);
+void *gpu_shader_binary_get(struct GPUShader *shader, int *r_binary_len, unsigned int *r_binary_format);
+
 #endif  /* __GPU_SHADER_PRIVATE_H__ */
@@ -207,6 +207,18 @@ void GPU_uniformbuffer_update(GPUUniformBuffer *ubo, const void *data)
 	gpu_uniformbuffer_update(ubo, data);
 }
 
+/**
+ * Only update the first \a size bytes, when the rest of the buffer is not read.
+ */
+void GPU_uniformbuffer_update_range(GPUUniformBuffer *ubo, const void *data, int size)
+{
+	BLI_assert(ubo->type == GPU_UBO_STATIC);
+	BLI_assert(size <= ubo->size);
+	glBindBuffer(GL_UNIFORM_BUFFER, ubo->bindcode);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
 /**
  * We need to recalculate the internal data, and re-generate it
  * from its populated items.
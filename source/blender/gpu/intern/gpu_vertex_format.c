@@ -49,6 +49,7 @@ void GPU_vertformat_clear(GPUVertFormat *format)
 	format->packed = false;
 	format->name_offset = 0;
 	format->name_len = 0;
+	format->name_hash = 0;
 
 	for (unsigned i = 0; i < GPU_VERT_ATTR_MAX_LEN; i++) {
 		format->attribs[i].name_len = 0;
@@ -210,6 +211,20 @@ unsigned padding(unsigned offset, unsigned alignment)
 	return (mod == 0) ? 0 : (alignment - mod);
 }
 
+/* Identifies the attrib names layout of a format, shader interfaces use it to look up
+ * their cached attrib locations (see GPU_shaderinterface_attr_plan). */
+static unsigned names_hash(const GPUVertFormat *format)
+{
+	unsigned hash = format->attr_len;
+	for (unsigned a_idx = 0; a_idx < format->attr_len; ++a_idx) {
+		hash = hash * 37 + format->attribs[a_idx].name_len;
+	}
+	for (unsigned i = 0; i < format->name_offset; ++i) {
+		hash = hash * 37 + (unsigned char)format->names[i];
+	}
+	return hash;
+}
+
 #if PACK_DEBUG
 static void show_pack(unsigned a_idx, unsigned sz, unsigned pad)
 {
@@ -260,6 +275,7 @@ void VertexFormat_pack(GPUVertFormat *format)
 	putchar('\n');
 #endif
 	format->stride = offset + end_padding;
+	format->name_hash = names_hash(format);
 	format->packed = true;
 }
 
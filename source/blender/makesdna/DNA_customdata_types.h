@@ -191,6 +191,8 @@ enum {
 	CD_FLAG_EXTERNAL  = (1 << 3),
 	/* Indicates external data is read into memory */
 	CD_FLAG_IN_MEMORY = (1 << 4),
+	/* Indicates layer data is shared with other layers and user counted, implies no free (runtime only) */
+	CD_FLAG_SHARED    = (1 << 5),
 };
 
 /* Limits */
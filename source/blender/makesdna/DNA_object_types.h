@@ -146,6 +146,9 @@ typedef struct Object_Runtime {
 
 	/* Runtime evaluated curve-specific data, not stored in the file. */
 	struct CurveCache *curve_cache;
+
+	/* BVH trees of the last freed 'mesh_eval', refit for the next one (see: mesh_build_data). */
+	struct BVHCacheStash *bvh_cache_stash;
 } Object_Runtime;
 
 typedef struct Object {
@@ -775,6 +775,8 @@ typedef enum eUserpref_UI_Flag2 {
 	USER_KEEP_SESSION			= (1 << 0),
 	USER_REGION_OVERLAP			= (1 << 1),
 	USER_TRACKPAD_NATURAL		= (1 << 2),
+	USER_GPU_MESH_LOD			= (1 << 3),
+	USER_GPU_OCCLUSION_CULLING	= (1 << 4),
 } eUserpref_UI_Flag2;
 
 /* UserDef.app_flag */
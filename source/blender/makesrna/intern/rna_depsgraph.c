@@ -191,6 +191,27 @@ static void rna_Depsgraph_debug_stats_gnuplot(Depsgraph *depsgraph,
 	fclose(f);
 }
 
+static void rna_Depsgraph_debug_timeline_begin(Depsgraph *depsgraph)
+{
+	DEG_debug_timeline_begin(depsgraph);
+}
+
+static void rna_Depsgraph_debug_timeline_end(Depsgraph *depsgraph)
+{
+	DEG_debug_timeline_end(depsgraph);
+}
+
+static void rna_Depsgraph_debug_timeline_trace_json(Depsgraph *depsgraph,
+                                                    const char *filename)
+{
+	FILE *f = fopen(filename, "w");
+	if (f == NULL) {
+		return;
+	}
+	DEG_debug_timeline_trace_json(depsgraph, f);
+	fclose(f);
+}
+
 static void rna_Depsgraph_debug_tag_update(Depsgraph *depsgraph)
 {
 	DEG_graph_tag_relations_update(depsgraph);
@@ -500,6 +521,18 @@ static void rna_def_depsgraph(BlenderRNA *brna)
 	                                "File name where gnuplot script will save the result");
 	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
 
+	func = RNA_def_function(srna, "debug_timeline_begin", "rna_Depsgraph_debug_timeline_begin");
+	RNA_def_function_ui_description(func, "Start recording the evaluation timeline, discarding previous recording");
+
+	func = RNA_def_function(srna, "debug_timeline_end", "rna_Depsgraph_debug_timeline_end");
+	RNA_def_function_ui_description(func, "Stop recording the evaluation timeline");
+
+	func = RNA_def_function(srna, "debug_timeline_trace_json", "rna_Depsgraph_debug_timeline_trace_json");
+	RNA_def_function_ui_description(func, "Save the recorded evaluation timeline as Chrome trace event JSON");
+	parm = RNA_def_string_file_path(func, "filename", NULL, FILE_MAX, "File Name",
+	                                "File in which to store the trace");
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+
 	func = RNA_def_function(srna, "debug_tag_update", "rna_Depsgraph_debug_tag_update");
 
 	func = RNA_def_function(srna, "debug_stats", "rna_Depsgraph_debug_stats");
@@ -4394,6 +4394,18 @@ static void rna_def_userdef_system(BlenderRNA *brna)
 	                         "Draw tool/property regions over the main region, when using Triple Buffer");
 	RNA_def_property_update(prop, 0, "rna_userdef_dpi_update");
 
+	prop = RNA_def_property(srna, "use_gpu_mesh_lod", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "uiflag2", USER_GPU_MESH_LOD);
+	RNA_def_property_ui_text(prop, "Mesh Level of Detail",
+	                         "Draw heavy meshes with simplified geometry when they cover few pixels in Solid mode");
+	RNA_def_property_update(prop, 0, "rna_userdef_update");
+
+	prop = RNA_def_property(srna, "use_gpu_occlusion_culling", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "uiflag2", USER_GPU_OCCLUSION_CULLING);
+	RNA_def_property_ui_text(prop, "Occlusion Culling",
+	                         "Skip drawing objects hidden behind large opaque meshes in Solid mode");
+	RNA_def_property_update(prop, 0, "rna_userdef_update");
+
 	prop = RNA_def_property(srna, "gpu_viewport_quality", PROP_FLOAT, PROP_FACTOR);
 	RNA_def_property_float_sdna(prop, NULL, "gpu_viewport_quality");
 	RNA_def_property_float_default(prop, 0.6f);
@@ -39,5 +39,6 @@ PyObject *GPU_initPython(void);
 PyObject *BPyInit_gpu_offscreen(void);
 PyObject *BPyInit_gpu_matrix(void);
 PyObject *BPyInit_gpu_select(void);
+PyObject *BPyInit_gpu_profiler(void);
 
 #endif /* __GPU_H__ */
@@ -0,0 +1,195 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/python/intern/gpu_py_profiler.c
+ *  \ingroup pythonintern
+ *
+ * This file defines the gpu.profiler API, giving access to the CPU profiler of the viewport draw manager.
+ */
+
+#include <Python.h>
+
+#include "BLI_utildefines.h"
+
+#include "../generic/py_capi_utils.h"
+
+#include "gpu.h"
+
+#include "DRW_engine.h"
+
+/* -------------------------------------------------------------------- */
+/** \name Methods
+ * \{ */
+
+PyDoc_STRVAR(pygpu_profiler_enable_doc,
+"enable(state=True)\n"
+"\n"
+"   Start or stop recording the draw manager statistics of each viewport redraw.\n"
+"\n"
+"   :param state: Whether to record.\n"
+"   :type state: bool\n"
+);
+static PyObject *pygpu_profiler_enable(PyObject *UNUSED(self), PyObject *args)
+{
+	bool state = true;
+	if (!PyArg_ParseTuple(args, "|O&:enable", PyC_ParseBool, &state)) {
+		return NULL;
+	}
+	DRW_profiler_enable(state);
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(pygpu_profiler_is_enabled_doc,
+"is_enabled()\n"
+"\n"
+"   :return: True when recording.\n"
+"   :rtype: bool\n"
+);
+static PyObject *pygpu_profiler_is_enabled(PyObject *UNUSED(self))
+{
+	return PyBool_FromLong(DRW_profiler_is_enabled());
+}
+
+static void pygpu_profiler_dict_set_steal(PyObject *dict, const char *key, PyObject *value)
+{
+	PyDict_SetItemString(dict, key, value);
+	Py_DECREF(value);
+}
+
+PyDoc_STRVAR(pygpu_profiler_stats_doc,
+"stats()\n"
+"\n"
+"   Statistics of the last recorded viewport redraw, times are in milliseconds.\n"
+"   Object times include the creation of their batch caches by all engines.\n"
+"\n"
+"   :return: A dictionary with ``total_time``, ``objects``, ``draw_calls``,\n"
+"      ``occluded_calls`` (draw calls skipped by occlusion culling),\n"
+"      ``instanced_calls`` (calls merged into instanced draw calls),\n"
+"      ``call_states`` and ``call_states_time`` (objects culled and transformed in parallel before drawing),\n"
+"      ``engines``\n"
+"      (a list of dictionaries with the time of each stage and the draw calls of every engine)\n"
+"      and ``slowest_objects`` (a list of ``(name, time)`` tuples), or None when nothing was recorded.\n"
+"   :rtype: dict or None\n"
+);
+static PyObject *pygpu_profiler_stats(PyObject *UNUSED(self))
+{
+	const DRWProfilerFrame *frame = DRW_profiler_frame_get();
+	if (frame == NULL) {
+		Py_RETURN_NONE;
+	}
+
+	PyObject *ret = PyDict_New();
+	PyObject *list;
+
+	pygpu_profiler_dict_set_steal(ret, "total_time", PyFloat_FromDouble(frame->total_time));
+	pygpu_profiler_dict_set_steal(ret, "objects", PyLong_FromLong(frame->objects_len));
+	pygpu_profiler_dict_set_steal(ret, "draw_calls", PyLong_FromLong(frame->draw_calls));
+	pygpu_profiler_dict_set_steal(ret, "occluded_calls", PyLong_FromLong(frame->occluded_calls));
+	pygpu_profiler_dict_set_steal(ret, "instanced_calls", PyLong_FromLong(frame->instanced_calls));
+	pygpu_profiler_dict_set_steal(ret, "call_states", PyLong_FromLong(frame->call_states));
+	pygpu_profiler_dict_set_steal(ret, "call_states_time", PyFloat_FromDouble(frame->call_states_time));
+
+	list = PyList_New(frame->engines_len);
+	for (int i = 0; i < frame->engines_len; i++) {
+		const DRWProfilerEngine *pf_engine = &frame->engines[i];
+		PyObject *item = PyDict_New();
+		pygpu_profiler_dict_set_steal(item, "idname", PyUnicode_FromString(pf_engine->idname));
+		for (int stage = 0; stage < DRW_PROFILER_STAGE_LEN; stage++) {
+			pygpu_profiler_dict_set_steal(
+			        item, DRW_profiler_stage_name(stage), PyFloat_FromDouble(pf_engine->stage_time[stage]));
+		}
+		pygpu_profiler_dict_set_steal(item, "draw_calls", PyLong_FromLong(pf_engine->draw_calls));
+		PyList_SET_ITEM(list, i, item);
+	}
+	pygpu_profiler_dict_set_steal(ret, "engines", list);
+
+	list = PyList_New(frame->slowest_objects_len);
+	for (int i = 0; i < frame->slowest_objects_len; i++) {
+		const DRWProfilerObject *pf_object = &frame->slowest_objects[i];
+		/* Skip the ID code. */
+		PyList_SET_ITEM(list, i, Py_BuildValue("(sd)", pf_object->name + 2, pf_object->time));
+	}
+	pygpu_profiler_dict_set_steal(ret, "slowest_objects", list);
+
+	return ret;
+}
+
+PyDoc_STRVAR(pygpu_profiler_dump_doc,
+"dump(filepath)\n"
+"\n"
+"   Write the statistics of the last recorded viewport redraw to a JSON file.\n"
+"\n"
+"   :param filepath: Path of the file to write.\n"
+"   :type filepath: str\n"
+);
+static PyObject *pygpu_profiler_dump(PyObject *UNUSED(self), PyObject *value)
+{
+	PyObject *value_coerce = NULL;
+	const char *filepath = PyC_UnicodeAsByte(value, &value_coerce);
+	if (filepath == NULL) {
+		return NULL;
+	}
+
+	const bool ok = DRW_profiler_write_json(filepath);
+	if (!ok) {
+		PyErr_Format(PyExc_IOError, "dump: could not write to '%s'", filepath);
+	}
+	/* Owns the memory 'filepath' points to. */
+	Py_XDECREF(value_coerce);
+
+	if (!ok) {
+		return NULL;
+	}
+	Py_RETURN_NONE;
+}
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Module
+ * \{ */
+
+static struct PyMethodDef BPy_GPU_profiler_methods[] = {
+	{"enable", (PyCFunction)pygpu_profiler_enable, METH_VARARGS, pygpu_profiler_enable_doc},
+	{"is_enabled", (PyCFunction)pygpu_profiler_is_enabled, METH_NOARGS, pygpu_profiler_is_enabled_doc},
+	{"stats", (PyCFunction)pygpu_profiler_stats, METH_NOARGS, pygpu_profiler_stats_doc},
+	{"dump", (PyCFunction)pygpu_profiler_dump, METH_O, pygpu_profiler_dump_doc},
+	{NULL, NULL, 0, NULL}
+};
+
+PyDoc_STRVAR(BPy_GPU_profiler_doc,
+"This module provides access to the CPU profiler of the viewport draw manager."
+);
+static PyModuleDef BPy_GPU_profiler_module_def = {
+	PyModuleDef_HEAD_INIT,
+	.m_name = "gpu.profiler",
+	.m_doc = BPy_GPU_profiler_doc,
+	.m_methods = BPy_GPU_profiler_methods,
+};
+
+PyObject *BPyInit_gpu_profiler(void)
+{
+	PyObject *submodule;
+
+	submodule = PyModule_Create(&BPy_GPU_profiler_module_def);
+
+	return submodule;
+}
+
+/** \} */
@@ -552,6 +552,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
 	BLI_argsPrintArgDoc(ba, "--debug-depsgraph-build");
 	BLI_argsPrintArgDoc(ba, "--debug-depsgraph-tag");
 	BLI_argsPrintArgDoc(ba, "--debug-depsgraph-no-threads");
+	BLI_argsPrintArgDoc(ba, "--debug-depsgraph-trace");
 
 	BLI_argsPrintArgDoc(ba, "--debug-gpumem");
 	BLI_argsPrintArgDoc(ba, "--debug-gpu-shaders");
@@ -887,6 +888,21 @@ static int arg_handle_debug_mode_generic_set(int UNUSED(argc), const char **UNUS
 	return 0;
 }
 
+static const char arg_handle_debug_depsgraph_trace_set_doc[] =
+"<filepath>\n"
+"\tRecord evaluation timeline of all dependency graphs, written as Chrome trace event JSON on exit.";
+static int arg_handle_debug_depsgraph_trace_set(int argc, const char **argv, void *UNUSED(data))
+{
+	if (argc > 1) {
+		DEG_debug_timeline_trace_file_set(argv[1]);
+		return 1;
+	}
+	else {
+		printf("\nError: you must specify a path after '--debug-depsgraph-trace'.\n");
+		return 0;
+	}
+}
+
 static const char arg_handle_debug_mode_io_doc[] =
 "\n\tEnable debug messages for I/O (collada, ...).";
 static int arg_handle_debug_mode_io(int UNUSED(argc), const char **UNUSED(argv), void *UNUSED(data))
@@ -1908,6 +1924,8 @@ void main_args_setup(bContext *C, bArgs *ba)
 	            CB_EX(arg_handle_debug_mode_generic_set, depsgraph_no_threads), (void *)G_DEBUG_DEPSGRAPH_NO_THREADS);
 	BLI_argsAdd(ba, 1, NULL, "--debug-depsgraph-pretty",
 	            CB_EX(arg_handle_debug_mode_generic_set, depsgraph_pretty), (void *)G_DEBUG_DEPSGRAPH_PRETTY);
+	BLI_argsAdd(ba, 1, NULL, "--debug-depsgraph-trace",
+	            CB(arg_handle_debug_depsgraph_trace_set), NULL);
 	BLI_argsAdd(ba, 1, NULL, "--debug-gpumem",
 	            CB_EX(arg_handle_debug_mode_generic_set, gpumem), (void *)G_DEBUG_GPU_MEM);
 	BLI_argsAdd(ba, 1, NULL, "--debug-gpu-shaders",
@@ -0,0 +1,158 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_kdopbvh.h"
+#include "BLI_math.h"
+
+#include "BKE_bvhutils.h"
+#include "BKE_library.h"
+#include "BKE_mesh.h"
+#include "BKE_mesh_runtime.h"
+
+#include "PIL_time.h"
+}
+
+#include <stdio.h>
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+/* Grid of \a res x \a res quads at height \a z. */
+static Mesh *mesh_grid_new(const int res, const float z)
+{
+	const int verts_len = (res + 1) * (res + 1);
+	Mesh *mesh = BKE_mesh_new_nomain(verts_len, 0, 0, res * res * 4, res * res);
+
+	for (int y = 0; y <= res; y++) {
+		for (int x = 0; x <= res; x++) {
+			MVert *mv = &mesh->mvert[y * (res + 1) + x];
+			mv->co[0] = (float)x;
+			mv->co[1] = (float)y;
+			mv->co[2] = z;
+		}
+	}
+	for (int y = 0; y < res; y++) {
+		for (int x = 0; x < res; x++) {
+			const int p = y * res + x;
+			const int v = y * (res + 1) + x;
+			mesh->mpoly[p].loopstart = p * 4;
+			mesh->mpoly[p].totloop = 4;
+			mesh->mloop[p * 4 + 0].v = v;
+			mesh->mloop[p * 4 + 1].v = v + 1;
+			mesh->mloop[p * 4 + 2].v = v + res + 2;
+			mesh->mloop[p * 4 + 3].v = v + res + 1;
+		}
+	}
+	return mesh;
+}
+
+static void mesh_free(Mesh *mesh)
+{
+	BKE_mesh_free(mesh);
+	BKE_libblock_free_data(&mesh->id, false);
+	MEM_freeN(mesh);
+}
+
+static BVHTree *mesh_looptri_tree_get(Mesh *mesh, BVHTreeFromMesh *data)
+{
+	return BKE_bvhtree_from_mesh_get(data, mesh, BVHTREE_FROM_LOOPTRI, 2);
+}
+
+static float mesh_ray_cast_down(BVHTreeFromMesh *data, const float x, const float y)
+{
+	const float co[3] = {x, y, 10.0f};
+	const float dir[3] = {0.0f, 0.0f, -1.0f};
+	BVHTreeRayHit hit;
+	hit.index = -1;
+	hit.dist = BVH_RAYCAST_DIST_MAX;
+	BLI_bvhtree_ray_cast(data->tree, co, dir, 0.0f, &hit, data->raycast_callback, data);
+	return (hit.index != -1) ? co[2] - hit.dist : -FLT_MAX;
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(bvhcache_stash, RefitSameTopology)
+{
+	const uint blocks_init = MEM_get_memory_blocks_in_use();
+	BVHCacheStash *stash = NULL;
+	BVHTreeFromMesh data;
+
+	Mesh *mesh_a = mesh_grid_new(8, 0.0f);
+	BVHTree *tree = mesh_looptri_tree_get(mesh_a, &data);
+	EXPECT_FLOAT_EQ(0.0f, mesh_ray_cast_down(&data, 2.5f, 3.5f));
+	free_bvhtree_from_mesh(&data);
+	bvhcache_stash_from_mesh(&stash, mesh_a);
+	EXPECT_EQ(NULL, mesh_a->runtime.bvh_cache);
+	mesh_free(mesh_a);
+
+	/* The next mesh with the same topology reuses the tree, refit to its positions. */
+	Mesh *mesh_b = mesh_grid_new(8, 1.0f);
+	bvhcache_unstash_to_mesh(&stash, mesh_b);
+	EXPECT_EQ(NULL, stash);
+	EXPECT_EQ(tree, mesh_looptri_tree_get(mesh_b, &data));
+	EXPECT_FLOAT_EQ(1.0f, mesh_ray_cast_down(&data, 2.5f, 3.5f));
+	EXPECT_FLOAT_EQ(1.0f, mesh_ray_cast_down(&data, 7.5f, 0.5f));
+	free_bvhtree_from_mesh(&data);
+
+	mesh_free(mesh_b);
+	EXPECT_EQ(blocks_init, MEM_get_memory_blocks_in_use());
+}
+
+TEST(bvhcache_stash, FreeChangedTopology)
+{
+	const uint blocks_init = MEM_get_memory_blocks_in_use();
+	BVHCacheStash *stash = NULL;
+	BVHTreeFromMesh data;
+
+	Mesh *mesh_a = mesh_grid_new(8, 0.0f);
+	mesh_looptri_tree_get(mesh_a, &data);
+	free_bvhtree_from_mesh(&data);
+	bvhcache_stash_from_mesh(&stash, mesh_a);
+	mesh_free(mesh_a);
+
+	Mesh *mesh_b = mesh_grid_new(4, 1.0f);
+	bvhcache_unstash_to_mesh(&stash, mesh_b);
+	EXPECT_EQ(NULL, stash);
+	EXPECT_EQ(NULL, mesh_b->runtime.bvh_cache);
+
+	mesh_free(mesh_b);
+	EXPECT_EQ(blocks_init, MEM_get_memory_blocks_in_use());
+}
+
+/* Prints the time taken by the first ray cast on a newly evaluated mesh,
+ * with the tree built from scratch and refit from the previous mesh. */
+TEST(bvhcache_stash, RefitTiming)
+{
+	const int res = 512;
+	BVHCacheStash *stash = NULL;
+	BVHTreeFromMesh data;
+
+	Mesh *mesh_a = mesh_grid_new(res, 0.0f);
+	double time = PIL_check_seconds_timer();
+	mesh_looptri_tree_get(mesh_a, &data);
+	const double time_build = PIL_check_seconds_timer() - time;
+	free_bvhtree_from_mesh(&data);
+	bvhcache_stash_from_mesh(&stash, mesh_a);
+	mesh_free(mesh_a);
+
+	Mesh *mesh_b = mesh_grid_new(res, 1.0f);
+	BKE_mesh_runtime_looptri_ensure(mesh_b);
+	time = PIL_check_seconds_timer();
+	bvhcache_unstash_to_mesh(&stash, mesh_b);
+	mesh_looptri_tree_get(mesh_b, &data);
+	const double time_refit = PIL_check_seconds_timer() - time;
+	EXPECT_FLOAT_EQ(1.0f, mesh_ray_cast_down(&data, 100.5f, 200.5f));
+	free_bvhtree_from_mesh(&data);
+	mesh_free(mesh_b);
+
+	printf("%d triangles: build %.4fs, refit %.4fs\n", res * res * 2, time_build, time_refit);
+}
@@ -0,0 +1,240 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+
+#include "DNA_customdata_types.h"
+#include "DNA_ID.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BLI_utildefines.h"
+
+#include "BKE_customdata.h"
+#include "BKE_library.h"
+#include "BKE_mesh.h"
+}
+
+#include <string.h>
+
+#define ELEM_LEN 4
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+static float *customdata_float_layer_init(CustomData *data, int totelem)
+{
+	CustomData_reset(data);
+	float *values = (float *)CustomData_add_layer(data, CD_PROP_FLT, CD_CALLOC, NULL, totelem);
+	for (int i = 0; i < totelem; i++) {
+		values[i] = (float)i;
+	}
+	return values;
+}
+
+static void customdata_share(const CustomData *src, CustomData *dst, int totelem)
+{
+	CustomData_copy(src, dst, CD_MASK_PROP_FLT, CD_SHARE, totelem);
+}
+
+static void expect_float_layer_values(const float *values, int totelem)
+{
+	for (int i = 0; i < totelem; i++) {
+		EXPECT_EQ((float)i, values[i]);
+	}
+}
+
+static Mesh *mesh_quad_new(void)
+{
+	Mesh *mesh = BKE_mesh_new_nomain(4, 0, 0, 4, 1);
+	for (int i = 0; i < 4; i++) {
+		mesh->mvert[i].co[0] = (float)i;
+		mesh->mloop[i].v = i;
+	}
+	mesh->mpoly[0].totloop = 4;
+	return mesh;
+}
+
+/* Copy the way the dependency graph does for copy-on-write. */
+static Mesh *mesh_copy_cow(const Mesh *mesh)
+{
+	Mesh *mesh_copy = NULL;
+	BKE_id_copy_ex(NULL, &mesh->id, (ID **)&mesh_copy,
+	               (LIB_ID_CREATE_NO_MAIN |
+	                LIB_ID_CREATE_NO_USER_REFCOUNT |
+	                LIB_ID_CREATE_NO_DEG_TAG |
+	                LIB_ID_COPY_CD_SHARE),
+	               false);
+	return mesh_copy;
+}
+
+static void mesh_free(Mesh *mesh)
+{
+	BKE_mesh_free(mesh);
+	BKE_libblock_free_data(&mesh->id, false);
+	MEM_freeN(mesh);
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(customdata_share, ShareArray)
+{
+	const uint blocks_init = MEM_get_memory_blocks_in_use();
+	CustomData src, dst;
+	float *values = customdata_float_layer_init(&src, ELEM_LEN);
+
+	customdata_share(&src, &dst, ELEM_LEN);
+	EXPECT_EQ(values, CustomData_get_layer(&dst, CD_PROP_FLT));
+	EXPECT_TRUE(CustomData_is_referenced_layer(&dst, CD_PROP_FLT));
+	EXPECT_FALSE(CustomData_is_referenced_layer(&src, CD_PROP_FLT));
+
+	CustomData_free(&dst, ELEM_LEN);
+	/* The owner keeps its array. */
+	EXPECT_EQ(values, CustomData_get_layer(&src, CD_PROP_FLT));
+	expect_float_layer_values(values, ELEM_LEN);
+
+	CustomData_free(&src, ELEM_LEN);
+	EXPECT_EQ(blocks_init, MEM_get_memory_blocks_in_use());
+}
+
+TEST(customdata_share, FreeOwner)
+{
+	const uint blocks_init = MEM_get_memory_blocks_in_use();
+	CustomData src, dst;
+	float *values = customdata_float_layer_init(&src, ELEM_LEN);
+
+	customdata_share(&src, &dst, ELEM_LEN);
+	const uint blocks_shared = MEM_get_memory_blocks_in_use();
+
+	/* Only the layers of the owner are freed, the array stays with the sharing layer. */
+	CustomData_free(&src, ELEM_LEN);
+	EXPECT_EQ(blocks_shared - 1, MEM_get_memory_blocks_in_use());
+	EXPECT_EQ(values, CustomData_get_layer(&dst, CD_PROP_FLT));
+	expect_float_layer_values(values, ELEM_LEN);
+
+	/* The last sharing layer frees the orphaned array. */
+	CustomData_free(&dst, ELEM_LEN);
+	EXPECT_EQ(blocks_init, MEM_get_memory_blocks_in_use());
+}
+
+TEST(customdata_share, ReleaseLastSharer)
+{
+	const uint blocks_init = MEM_get_memory_blocks_in_use();
+	CustomData src, dst_a, dst_b;
+	float *values = customdata_float_layer_init(&src, ELEM_LEN);
+
+	customdata_share(&src, &dst_a, ELEM_LEN);
+	customdata_share(&src, &dst_b, ELEM_LEN);
+	CustomData_free(&src, ELEM_LEN);
+
+	const uint blocks_shared = MEM_get_memory_blocks_in_use();
+	CustomData_free(&dst_a, ELEM_LEN);
+	/* Only the layers are freed, the array is still used by the other sharer. */
+	EXPECT_EQ(blocks_shared - 1, MEM_get_memory_blocks_in_use());
+	EXPECT_EQ(values, CustomData_get_layer(&dst_b, CD_PROP_FLT));
+	expect_float_layer_values(values, ELEM_LEN);
+
+	CustomData_free(&dst_b, ELEM_LEN);
+	EXPECT_EQ(blocks_init, MEM_get_memory_blocks_in_use());
+}
+
+TEST(customdata_share, DuplicateReferenced)
+{
+	const uint blocks_init = MEM_get_memory_blocks_in_use();
+	CustomData src, dst;
+	float *values = customdata_float_layer_init(&src, ELEM_LEN);
+
+	customdata_share(&src, &dst, ELEM_LEN);
+
+	/* Writers get a copy of their own, without touching the shared array. */
+	float *values_dst = (float *)CustomData_duplicate_referenced_layer(&dst, CD_PROP_FLT, ELEM_LEN);
+	EXPECT_NE(values, values_dst);
+	EXPECT_FALSE(CustomData_is_referenced_layer(&dst, CD_PROP_FLT));
+	expect_float_layer_values(values_dst, ELEM_LEN);
+	values_dst[0] = -1.0f;
+	expect_float_layer_values(values, ELEM_LEN);
+
+	CustomData_free(&src, ELEM_LEN);
+	CustomData_free(&dst, ELEM_LEN);
+	EXPECT_EQ(blocks_init, MEM_get_memory_blocks_in_use());
+}
+
+TEST(customdata_share, ReallocShared)
+{
+	const uint blocks_init = MEM_get_memory_blocks_in_use();
+	CustomData src, dst;
+	float *values = customdata_float_layer_init(&src, ELEM_LEN);
+
+	customdata_share(&src, &dst, ELEM_LEN);
+
+	/* The owner moves to a new array, the sharing layer keeps the old one. */
+	CustomData_realloc(&src, ELEM_LEN * 2);
+	float *values_src = (float *)CustomData_get_layer(&src, CD_PROP_FLT);
+	EXPECT_NE(values, values_src);
+	EXPECT_EQ(values, CustomData_get_layer(&dst, CD_PROP_FLT));
+	expect_float_layer_values(values_src, ELEM_LEN);
+	values_src[0] = -1.0f;
+	expect_float_layer_values(values, ELEM_LEN);
+
+	CustomData_free(&dst, ELEM_LEN);
+	CustomData_free(&src, ELEM_LEN * 2);
+	EXPECT_EQ(blocks_init, MEM_get_memory_blocks_in_use());
+}
+
+/* Edits of a local mesh only reach its copy on the next copy-on-write update. */
+TEST(customdata_share, MeshLocalEdit)
+{
+	const uint blocks_init = MEM_get_memory_blocks_in_use();
+	Mesh *mesh = mesh_quad_new();
+
+	Mesh *mesh_cow = mesh_copy_cow(mesh);
+	EXPECT_NE(mesh->mvert, mesh_cow->mvert);
+	EXPECT_NE(mesh->mloop, mesh_cow->mloop);
+	EXPECT_FALSE(CustomData_is_referenced_layer(&mesh_cow->ldata, CD_MLOOP));
+
+	mesh->mvert[1].co[0] = -1.0f;
+	mesh->mloop[1].v = 3;
+	EXPECT_EQ(1.0f, mesh_cow->mvert[1].co[0]);
+	EXPECT_EQ(1, mesh_cow->mloop[1].v);
+
+	mesh_free(mesh_cow);
+	mesh_cow = mesh_copy_cow(mesh);
+	EXPECT_EQ(-1.0f, mesh_cow->mvert[1].co[0]);
+	EXPECT_EQ(3, mesh_cow->mloop[1].v);
+
+	mesh_free(mesh_cow);
+	mesh_free(mesh);
+	EXPECT_EQ(blocks_init, MEM_get_memory_blocks_in_use());
+}
+
+/* Linked meshes share their topology, vertices are still copied. */
+TEST(customdata_share, MeshLinked)
+{
+	const uint blocks_init = MEM_get_memory_blocks_in_use();
+	Library lib;
+	memset(&lib, 0, sizeof(lib));
+	Mesh *mesh = mesh_quad_new();
+	mesh->id.lib = &lib;
+
+	Mesh *mesh_cow = mesh_copy_cow(mesh);
+	EXPECT_EQ(mesh->mloop, mesh_cow->mloop);
+	EXPECT_EQ(mesh->mpoly, mesh_cow->mpoly);
+	EXPECT_TRUE(CustomData_is_referenced_layer(&mesh_cow->ldata, CD_MLOOP));
+	EXPECT_NE(mesh->mvert, mesh_cow->mvert);
+	EXPECT_FALSE(CustomData_is_referenced_layer(&mesh_cow->vdata, CD_MVERT));
+
+	mesh->mvert[1].co[0] = -1.0f;
+	EXPECT_EQ(1.0f, mesh_cow->mvert[1].co[0]);
+
+	/* The copy outlives the original. */
+	MLoop *mloop = mesh->mloop;
+	mesh_free(mesh);
+	EXPECT_EQ(mloop, mesh_cow->mloop);
+	EXPECT_EQ(1, mesh_cow->mloop[1].v);
+
+	mesh_free(mesh_cow);
+	EXPECT_EQ(blocks_init, MEM_get_memory_blocks_in_use());
+}
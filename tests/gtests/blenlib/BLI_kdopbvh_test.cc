@@ -95,3 +95,53 @@ static void find_nearest_points_test(int points_len, float scale, int round, int
 TEST(kdopbvh, FindNearest_1)		{ find_nearest_points_test(1, 1.0, 1000, 1234); }
 TEST(kdopbvh, FindNearest_2)		{ find_nearest_points_test(2, 1.0, 1000, 123); }
 TEST(kdopbvh, FindNearest_500)		{ find_nearest_points_test(500, 1.0, 1000, 12); }
+
+/**
+ * Move all points and refit, nearest queries on the refit tree must give the same results
+ * as a tree built from the moved points.
+ */
+static void refit_test(int points_len, int random_seed)
+{
+	struct RNG *rng = BLI_rng_new(random_seed);
+	BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 4, 6);
+	BVHTree *tree_build = BLI_bvhtree_new(points_len, 0.0, 4, 6);
+
+	float (*points)[3] = (float (*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+
+	for (int i = 0; i < points_len; i++) {
+		rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+		BLI_bvhtree_insert(tree, i, points[i], 1);
+	}
+	BLI_bvhtree_balance(tree);
+	const float area_ratio_build = BLI_bvhtree_calc_branch_area_ratio(tree);
+	EXPECT_GE(area_ratio_build, 1.0f);
+
+	for (int i = 0; i < points_len; i++) {
+		float offset[3];
+		rng_v3_round(offset, 3, rng, 1000, 0.25f);
+		add_v3_v3(points[i], offset);
+		BLI_bvhtree_update_node(tree, i, points[i], NULL, 1);
+		BLI_bvhtree_insert(tree_build, i, points[i], 1);
+	}
+	BLI_bvhtree_update_tree(tree);
+	BLI_bvhtree_balance(tree_build);
+
+	EXPECT_GE(BLI_bvhtree_calc_branch_area_ratio(tree), 1.0f);
+
+	for (int i = 0; i < points_len; i++) {
+		BVHTreeNearest nearest = {0}, nearest_build = {0};
+		nearest.index = nearest_build.index = -1;
+		nearest.dist_sq = nearest_build.dist_sq = FLT_MAX;
+		BLI_bvhtree_find_nearest(tree, points[i], &nearest, NULL, NULL);
+		BLI_bvhtree_find_nearest(tree_build, points[i], &nearest_build, NULL, NULL);
+		EXPECT_EQ(nearest_build.dist_sq, nearest.dist_sq);
+	}
+
+	BLI_bvhtree_free(tree);
+	BLI_bvhtree_free(tree_build);
+	BLI_rng_free(rng);
+	MEM_freeN(points);
+}
+
+TEST(kdopbvh, Refit_100)		{ refit_test(100, 123); }
+TEST(kdopbvh, Refit_20000)		{ refit_test(20000, 12); }
@@ -0,0 +1,97 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_compiler_attrs.h"
+#include "BLI_kdtree.h"
+#include "BLI_rand.h"
+#include "BLI_math_vector.h"
+#include "MEM_guardedalloc.h"
+}
+
+#include "stubs/bf_intern_eigen_stubs.h"
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+static float (*rng_points_new(int points_len, struct RNG *rng, float scale))[3]
+{
+	float (*points)[3] = (float (*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+	for (int i = 0; i < points_len; i++) {
+		for (int j = 0; j < 3; j++) {
+			points[i][j] = (BLI_rng_get_float(rng) * 2.0f - 1.0f) * scale;
+		}
+	}
+	return points;
+}
+
+static KDTree *kdtree_from_points(const float (*points)[3], int points_len)
+{
+	KDTree *tree = BLI_kdtree_new(points_len);
+	for (int i = 0; i < points_len; i++) {
+		BLI_kdtree_insert(tree, i, points[i]);
+	}
+	BLI_kdtree_balance(tree);
+	return tree;
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(kdtree, Empty)
+{
+	KDTree *tree = BLI_kdtree_new(0);
+	BLI_kdtree_balance(tree);
+	{
+		float co[3] = {0};
+		KDTreeNearest nearest;
+		EXPECT_EQ(-1, BLI_kdtree_find_nearest(tree, co, &nearest));
+	}
+	BLI_kdtree_free(tree);
+}
+
+/**
+ * Compare nearest queries with a brute force search,
+ * large trees are balanced in parallel, small ones on a single thread.
+ */
+static void find_nearest_test(int points_len, int queries_len, int random_seed)
+{
+	struct RNG *rng = BLI_rng_new(random_seed);
+	float (*points)[3] = rng_points_new(points_len, rng, 1.0f);
+	float (*co)[3] = rng_points_new(queries_len, rng, 1.5f);
+	KDTree *tree = kdtree_from_points(points, points_len);
+
+	for (int i = 0; i < queries_len; i++) {
+		int index_expect = -1;
+		float dist_sq_expect = FLT_MAX;
+		for (int j = 0; j < points_len; j++) {
+			const float dist_sq = len_squared_v3v3(points[j], co[i]);
+			if (dist_sq < dist_sq_expect) {
+				dist_sq_expect = dist_sq;
+				index_expect = j;
+			}
+		}
+
+		KDTreeNearest nearest;
+		EXPECT_EQ(index_expect, BLI_kdtree_find_nearest(tree, co[i], &nearest));
+		EXPECT_EQ(index_expect, nearest.index);
+		EXPECT_FLOAT_EQ(sqrtf(dist_sq_expect), nearest.dist);
+	}
+
+	/* Each point finds itself. */
+	for (int i = 0; i < points_len; i++) {
+		KDTreeNearest nearest;
+		EXPECT_EQ(i, BLI_kdtree_find_nearest(tree, points[i], &nearest));
+		EXPECT_EQ(0.0f, nearest.dist);
+	}
+
+	BLI_kdtree_free(tree);
+	BLI_rng_free(rng);
+	MEM_freeN(points);
+	MEM_freeN(co);
+}
+
+TEST(kdtree, FindNearest_1)		{ find_nearest_test(1, 10, 1234); }
+TEST(kdtree, FindNearest_500)		{ find_nearest_test(500, 500, 123); }
+TEST(kdtree, FindNearest_50000)		{ find_nearest_test(50000, 200, 12); }
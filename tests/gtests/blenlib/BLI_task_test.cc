@@ -9,6 +9,8 @@ extern "C" {
 #include "BLI_mempool.h"
 #include "BLI_task.h"
 #include "BLI_utildefines.h"
+
+#include "MEM_guardedalloc.h"
 };
 
 #define NUM_ITEMS 10000
@@ -74,3 +76,99 @@ TEST(task, MempoolIter)
 
 	BLI_mempool_destroy(mempool);
 }
+
+struct MempoolThreadsafeData {
+	BLI_mempool *mempool;
+	int **data;
+};
+
+static void task_mempool_threadsafe_alloc_func(
+        void *__restrict userdata,
+        const int i,
+        const ParallelRangeTLS *__restrict tls)
+{
+	MempoolThreadsafeData *data = (MempoolThreadsafeData *)userdata;
+	BLI_mempool_local *local = (BLI_mempool_local *)tls->userdata_chunk;
+
+	if (local->pool == NULL) {
+		BLI_mempool_local_init(data->mempool, local);
+	}
+
+	/* Use both the local cache and the pool directly. */
+	data->data[i] = (int *)((i % 5) ? BLI_mempool_local_alloc(local) : BLI_mempool_alloc(data->mempool));
+	*data->data[i] = i;
+}
+
+static void task_mempool_threadsafe_free_func(
+        void *__restrict userdata,
+        const int i,
+        const ParallelRangeTLS *__restrict tls)
+{
+	MempoolThreadsafeData *data = (MempoolThreadsafeData *)userdata;
+	BLI_mempool_local *local = (BLI_mempool_local *)tls->userdata_chunk;
+
+	if (local->pool == NULL) {
+		BLI_mempool_local_init(data->mempool, local);
+	}
+
+	EXPECT_EQ(*data->data[i], i);
+	if (i % 3) {
+		BLI_mempool_local_free(local, data->data[i]);
+	}
+	else {
+		BLI_mempool_free(data->mempool, data->data[i]);
+	}
+}
+
+static void task_mempool_threadsafe_finalize(void *__restrict UNUSED(userdata), void *__restrict userdata_chunk)
+{
+	BLI_mempool_local *local = (BLI_mempool_local *)userdata_chunk;
+	if (local->pool != NULL) {
+		BLI_mempool_local_flush(local);
+	}
+}
+
+TEST(task, MempoolThreadsafe)
+{
+	const int items_num = NUM_ITEMS * 10;
+	int **items = (int **)MEM_mallocN(sizeof(*items) * items_num, __func__);
+	BLI_mempool *mempool = BLI_mempool_create(
+	        sizeof(int), 0, 64, BLI_MEMPOOL_ALLOW_ITER | BLI_MEMPOOL_THREADSAFE);
+	MempoolThreadsafeData data = {mempool, items};
+
+	BLI_mempool_local local = {NULL};
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.min_iter_per_thread = 128;
+	settings.userdata_chunk = &local;
+	settings.userdata_chunk_size = sizeof(local);
+	settings.func_finalize = task_mempool_threadsafe_finalize;
+
+	BLI_task_parallel_range(0, items_num, &data, task_mempool_threadsafe_alloc_func, &settings);
+	EXPECT_EQ(items_num, BLI_mempool_len(mempool));
+
+	/* All elements are unique and reachable by iteration. */
+	int items_found = 0;
+	{
+		BLI_mempool_iter iter;
+		int *item;
+		BLI_mempool_iternew(mempool, &iter);
+		while ((item = (int *)BLI_mempool_iterstep(&iter))) {
+			EXPECT_EQ(items[*item], item);
+			items_found++;
+		}
+	}
+	EXPECT_EQ(items_num, items_found);
+
+	BLI_task_parallel_range(0, items_num, &data, task_mempool_threadsafe_free_func, &settings);
+	EXPECT_EQ(0, BLI_mempool_len(mempool));
+
+	/* Bulk allocation reuses the free elements. */
+	BLI_mempool_alloc_n(mempool, (void **)items, (unsigned int)items_num);
+	EXPECT_EQ(items_num, BLI_mempool_len(mempool));
+	BLI_mempool_free_n(mempool, (void **)items, (unsigned int)items_num);
+	EXPECT_EQ(0, BLI_mempool_len(mempool));
+
+	BLI_mempool_destroy(mempool);
+	MEM_freeN(items);
+}
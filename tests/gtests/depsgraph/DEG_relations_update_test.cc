@@ -0,0 +1,235 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+
+#include "DNA_constraint_types.h"
+#include "DNA_customdata_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_string.h"
+
+#include "BKE_collection.h"
+#include "BKE_constraint.h"
+#include "BKE_layer.h"
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "PIL_time.h"
+}
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+
+#include "intern/depsgraph.h"
+#include "intern/nodes/deg_node_component.h"
+#include "intern/nodes/deg_node_id.h"
+#include "intern/nodes/deg_node_operation.h"
+
+#include "util/deg_util_foreach.h"
+
+using std::string;
+using std::vector;
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+struct SceneData {
+	Main *bmain;
+	Scene *scene;
+	ViewLayer *view_layer;
+	vector<Object *> objects;
+};
+
+/* Chain of \a objects_len mesh objects, each one copying the location of the
+ * previous one. */
+static void scene_data_init(SceneData *data, const int objects_len)
+{
+	DEG_register_node_types();
+	data->bmain = BKE_main_new();
+	/* Only what the dependency graph needs, without color management. */
+	data->scene = (Scene *)BKE_libblock_alloc(data->bmain, ID_SCE, "Scene", 0);
+	data->scene->master_collection = BKE_collection_master_add();
+	data->view_layer = BKE_view_layer_add(data->scene, "View Layer");
+	Mesh *mesh = BKE_mesh_add(data->bmain, "Mesh");
+	for (int i = 0; i < objects_len; i++) {
+		char name[MAX_ID_NAME];
+		BLI_snprintf(name, sizeof(name), "Object%04d", i);
+		Object *object = BKE_object_add_only_object(data->bmain, OB_MESH, name);
+		object->data = mesh;
+		id_us_plus(&mesh->id);
+		BKE_collection_object_add(data->bmain, data->scene->master_collection, object);
+		if (i != 0) {
+			bConstraint *con = BKE_constraint_add_for_object(object, "Copy Location", CONSTRAINT_TYPE_LOCLIKE);
+			((bLocateLikeConstraint *)con->data)->tar = data->objects.back();
+		}
+		data->objects.push_back(object);
+	}
+}
+
+static void scene_data_free(SceneData *data)
+{
+	BKE_main_free(data->bmain);
+	DEG_free_node_types();
+}
+
+static Depsgraph *scene_data_depsgraph(SceneData *data)
+{
+	Depsgraph *depsgraph = BKE_scene_get_depsgraph(data->scene, data->view_layer, true);
+	DEG_graph_relations_update(depsgraph, data->bmain, data->scene, data->view_layer);
+	return depsgraph;
+}
+
+static string operation_identifier(const DEG::OperationDepsNode *op_node)
+{
+	return string(op_node->owner->owner->id_orig->name) + " " +
+	       op_node->owner->identifier() + " " + op_node->identifier();
+}
+
+/* Sorted description of all operations and relations between them, which
+ * doesn't depend on the order nodes were built in. */
+static vector<string> depsgraph_relations(Depsgraph *depsgraph)
+{
+	DEG::Depsgraph *deg_graph = (DEG::Depsgraph *)depsgraph;
+	vector<string> relations;
+	foreach (DEG::OperationDepsNode *op_node, deg_graph->operations) {
+		relations.push_back(operation_identifier(op_node));
+		foreach (DEG::DepsRelation *rel, op_node->outlinks) {
+			relations.push_back(operation_identifier(op_node) + " -> " +
+			                    operation_identifier((DEG::OperationDepsNode *)rel->to) +
+			                    " (" + rel->name + ")");
+		}
+	}
+	std::sort(relations.begin(), relations.end());
+	return relations;
+}
+
+/* Relations of a graph built from scratch, the custom data masks of the
+ * objects are checked against the ones left by the incremental update. */
+static void expect_relations_full_build(SceneData *data, Depsgraph *depsgraph)
+{
+	vector<uint64_t> customdata_masks;
+	foreach (Object *object, data->objects) {
+		customdata_masks.push_back(object->customdata_mask);
+	}
+
+	Depsgraph *depsgraph_full = DEG_graph_new(data->scene, data->view_layer, DAG_EVAL_VIEWPORT);
+	DEG_graph_build_from_view_layer(depsgraph_full, data->bmain, data->scene, data->view_layer);
+	const vector<string> relations_full = depsgraph_relations(depsgraph_full);
+	const vector<string> relations = depsgraph_relations(depsgraph);
+	vector<string> relations_missing, relations_extra;
+	std::set_difference(relations_full.begin(), relations_full.end(),
+	                    relations.begin(), relations.end(),
+	                    std::back_inserter(relations_missing));
+	std::set_difference(relations.begin(), relations.end(),
+	                    relations_full.begin(), relations_full.end(),
+	                    std::back_inserter(relations_extra));
+	EXPECT_EQ(vector<string>(), relations_missing);
+	EXPECT_EQ(vector<string>(), relations_extra);
+	for (int i = 0; i < data->objects.size(); i++) {
+		EXPECT_EQ(data->objects[i]->customdata_mask, customdata_masks[i]);
+	}
+	DEG_graph_free(depsgraph_full);
+}
+
+/* Update relations of \a object, which must be done without rebuilding the
+ * nodes of \a object_kept. */
+static void relations_update_incremental(SceneData *data, Depsgraph *depsgraph,
+                                         Object *object, Object *object_kept)
+{
+	DEG::Depsgraph *deg_graph = (DEG::Depsgraph *)depsgraph;
+	DEG::IDDepsNode *id_node_kept = deg_graph->find_id_node(&object_kept->id);
+	DEG_id_tag_relations_update(data->bmain, &object->id);
+	DEG_graph_relations_update(depsgraph, data->bmain, data->scene, data->view_layer);
+	EXPECT_EQ(id_node_kept, deg_graph->find_id_node(&object_kept->id));
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+/* New relations into the updated object, and from it to objects which are
+ * kept in the graph. */
+TEST(deg_relations_update, AddConstraint)
+{
+	SceneData data;
+	scene_data_init(&data, 8);
+	Depsgraph *depsgraph = scene_data_depsgraph(&data);
+
+	Object *object = data.objects[2];
+	bConstraint *con = BKE_constraint_add_for_object(object, "Copy Rotation", CONSTRAINT_TYPE_ROTLIKE);
+	((bRotateLikeConstraint *)con->data)->tar = data.objects[0];
+	relations_update_incremental(&data, depsgraph, object, data.objects[3]);
+	expect_relations_full_build(&data, depsgraph);
+
+	scene_data_free(&data);
+}
+
+TEST(deg_relations_update, RemoveConstraint)
+{
+	SceneData data;
+	scene_data_init(&data, 8);
+	Depsgraph *depsgraph = scene_data_depsgraph(&data);
+
+	Object *object = data.objects[4];
+	BKE_constraints_free(&object->constraints);
+	relations_update_incremental(&data, depsgraph, object, data.objects[5]);
+	expect_relations_full_build(&data, depsgraph);
+
+	scene_data_free(&data);
+}
+
+/* Vertex parent requests custom data from the geometry of the parent, which
+ * is kept in the graph. */
+TEST(deg_relations_update, VertexParent)
+{
+	SceneData data;
+	scene_data_init(&data, 8);
+	Depsgraph *depsgraph = scene_data_depsgraph(&data);
+
+	Object *object = data.objects[5];
+	object->parent = data.objects[1];
+	object->partype = PARVERT1;
+	relations_update_incremental(&data, depsgraph, object, data.objects[1]);
+	EXPECT_TRUE(data.objects[1]->customdata_mask & CD_MASK_ORIGINDEX);
+	expect_relations_full_build(&data, depsgraph);
+
+	scene_data_free(&data);
+}
+
+/* Prints the time taken to update relations of one object in a large scene,
+ * with the incremental update and with a full build. */
+TEST(deg_relations_update, Timing)
+{
+	const int objects_len = 2000;
+	SceneData data;
+	scene_data_init(&data, objects_len);
+	Depsgraph *depsgraph = scene_data_depsgraph(&data);
+
+	Object *object = data.objects[objects_len / 2];
+	double time = PIL_check_seconds_timer();
+	relations_update_incremental(&data, depsgraph, object, data.objects[0]);
+	const double time_incremental = PIL_check_seconds_timer() - time;
+
+	time = PIL_check_seconds_timer();
+	DEG_graph_tag_relations_update(depsgraph);
+	DEG_graph_relations_update(depsgraph, data.bmain, data.scene, data.view_layer);
+	const double time_full = PIL_check_seconds_timer() - time;
+
+	printf("%d objects: incremental %.4fs, full %.4fs\n", objects_len, time_incremental, time_full);
+
+	scene_data_free(&data);
+}
@@ -0,0 +1,130 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# Measure how long it takes to build the dependency graph of a synthetic scene.
+#
+# Usage:
+#   blender --background --factory-startup \
+#       --python tests/python/bl_depsgraph_build_benchmark.py -- \
+#       [--objects=N] [--meshes=N] [--modifiers=N] [--parents] [--repeat=N]
+#
+# Run blender with --debug-depsgraph-build to also get the time spent in each
+# of the builder stages.
+
+import bpy
+
+import sys
+import time
+
+
+def parse_args():
+    args = {
+        "objects": 20000,
+        "meshes": 100,
+        "modifiers": 1,
+        "parents": False,
+        "repeat": 5,
+    }
+    argv = sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else []
+    for arg in argv:
+        if arg == "--parents":
+            args["parents"] = True
+            continue
+        key, _, value = arg.lstrip("-").partition("=")
+        if key not in args:
+            raise Exception("Unknown argument: %r" % arg)
+        args[key] = int(value)
+    return args
+
+
+def scene_clear():
+    for ob in bpy.data.objects[:]:
+        bpy.data.objects.remove(ob)
+    for me in bpy.data.meshes[:]:
+        bpy.data.meshes.remove(me)
+
+
+def scene_create(args):
+    scene = bpy.context.scene
+    collection = scene.collection
+
+    meshes = []
+    for i in range(max(args["meshes"], 1)):
+        me = bpy.data.meshes.new("Mesh.%d" % i)
+        me.from_pydata(
+            ((0.0, 0.0, 0.0), (1.0, 0.0, 0.0), (1.0, 1.0, 0.0), (0.0, 1.0, 0.0)),
+            (),
+            ((0, 1, 2, 3),),
+        )
+        meshes.append(me)
+
+    parent = None
+    for i in range(args["objects"]):
+        ob = bpy.data.objects.new("Object.%d" % i, meshes[i % len(meshes)])
+        ob.location = (i % 100, i // 100, 0.0)
+        for j in range(args["modifiers"]):
+            ob.modifiers.new("Subsurf.%d" % j, 'SUBSURF')
+        if args["parents"] and parent is not None and i % 10 != 0:
+            ob.parent = parent
+        else:
+            parent = ob
+        collection.objects.link(ob)
+
+
+def benchmark(args):
+    view_layer = bpy.context.view_layer
+    depsgraph = view_layer.depsgraph
+
+    # First update builds the graph and expands all copy-on-write datablocks.
+    start = time.time()
+    view_layer.update()
+    first = time.time() - start
+
+    timings = []
+    for _ in range(args["repeat"]):
+        depsgraph.debug_tag_update()
+        start = time.time()
+        view_layer.update()
+        timings.append(time.time() - start)
+
+    print("Dependency graph: %s" % depsgraph.debug_stats())
+    print("First update: %.4f sec" % first)
+    print("Relations update: min %.4f, avg %.4f, max %.4f sec" %
+          (min(timings), sum(timings) / len(timings), max(timings)))
+
+
+def main():
+    args = parse_args()
+    print("Building scene with %d objects, %d meshes, %d modifiers%s" %
+          (args["objects"], args["meshes"], args["modifiers"],
+           ", parented" if args["parents"] else ""))
+    scene_clear()
+    scene_create(args)
+    benchmark(args)
+
+
+if __name__ == "__main__":
+    # So a python error exits(1)
+    try:
+        main()
+    except:
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
@@ -0,0 +1,140 @@
+# Apache License, Version 2.0
+
+# ./blender.bin --background -noaudio --factory-startup --python tests/python/bl_undo_memfile.py -- --verbose
+import bpy
+import unittest
+
+
+def context_override():
+    window = bpy.context.window_manager.windows[0]
+    return {"window": window, "screen": window.screen}
+
+
+def undo_push(message):
+    bpy.ops.ed.undo_push(context_override(), message=message)
+
+
+def undo():
+    bpy.ops.ed.undo(context_override())
+
+
+class TestUndoMemfile(unittest.TestCase):
+    """
+    Undo steps reuse the data of ID's which are written exactly as in the previous step,
+    ensure edits which don't go through the depsgraph are still written.
+    """
+
+    def setUp(self):
+        bpy.ops.wm.read_factory_settings()
+        # Undo reloads main, ID's are accessed by name after each step.
+        ob = bpy.data.objects.new("UndoObject", None)
+        bpy.context.scene.collection.objects.link(ob)
+        ma = bpy.data.materials.new("UndoMaterial")
+        ma.use_nodes = True
+
+    def test_idprop_python(self):
+        bpy.data.objects["UndoObject"]["value"] = 0
+        undo_push("A")
+        bpy.data.objects["UndoObject"]["value"] = 1
+        undo_push("B")
+        bpy.data.objects["UndoObject"]["value"] = 2
+        undo_push("C")
+
+        undo()
+        self.assertEqual(bpy.data.objects["UndoObject"]["value"], 1)
+        undo()
+        self.assertEqual(bpy.data.objects["UndoObject"]["value"], 0)
+
+    def test_idprop_array(self):
+        bpy.data.objects["UndoObject"]["array"] = [0.0, 0.0, 0.0]
+        undo_push("A")
+        bpy.data.objects["UndoObject"]["array"][1] = 1.0
+        undo_push("B")
+        bpy.data.objects["UndoObject"]["array"][1] = 2.0
+        undo_push("C")
+
+        undo()
+        self.assertEqual(list(bpy.data.objects["UndoObject"]["array"]), [0.0, 1.0, 0.0])
+
+    def test_idprop_group(self):
+        bpy.data.objects["UndoObject"]["group"] = {"a": 0}
+        undo_push("A")
+        bpy.data.objects["UndoObject"]["group"].update({"a": 1})
+        undo_push("B")
+        bpy.data.objects["UndoObject"]["group"].clear()
+        undo_push("C")
+
+        undo()
+        self.assertEqual(bpy.data.objects["UndoObject"]["group"].to_dict(), {"a": 1})
+
+    def test_node_tree(self):
+        def roughness_input():
+            node_tree = bpy.data.materials["UndoMaterial"].node_tree
+            return node_tree.nodes["Principled BSDF"].inputs["Roughness"]
+
+        roughness_input().default_value = 0.0
+        undo_push("A")
+        roughness_input().default_value = 0.25
+        undo_push("B")
+        roughness_input().default_value = 0.5
+        undo_push("C")
+
+        undo()
+        self.assertAlmostEqual(roughness_input().default_value, 0.25)
+        undo()
+        self.assertAlmostEqual(roughness_input().default_value, 0.0)
+
+    def test_node_tree_idprop(self):
+        def node_tree():
+            return bpy.data.materials["UndoMaterial"].node_tree
+
+        node_tree()["value"] = 0
+        undo_push("A")
+        node_tree()["value"] = 1
+        undo_push("B")
+        node_tree()["value"] = 2
+        undo_push("C")
+
+        undo()
+        self.assertEqual(node_tree()["value"], 1)
+
+    def test_foreach_set(self):
+        def mesh():
+            return bpy.data.meshes["UndoMesh"]
+
+        me = bpy.data.meshes.new("UndoMesh")
+        me.vertices.add(1)
+        undo_push("A")
+        mesh().vertices.foreach_set("co", (1.0, 0.0, 0.0))
+        undo_push("B")
+        mesh().vertices.foreach_set("co", (2.0, 0.0, 0.0))
+        undo_push("C")
+
+        undo()
+        self.assertEqual(tuple(mesh().vertices[0].co), (1.0, 0.0, 0.0))
+        undo()
+        self.assertEqual(tuple(mesh().vertices[0].co), (0.0, 0.0, 0.0))
+
+    def test_collection_property(self):
+        bpy.types.Object.undo_items = bpy.props.CollectionProperty(type=bpy.types.PropertyGroup)
+        try:
+            undo_push("A")
+            bpy.data.objects["UndoObject"].undo_items.add().name = "a"
+            undo_push("B")
+            bpy.data.objects["UndoObject"].undo_items.add().name = "b"
+            undo_push("C")
+            bpy.data.objects["UndoObject"].undo_items.remove(0)
+            undo_push("D")
+
+            undo()
+            self.assertEqual([item.name for item in bpy.data.objects["UndoObject"].undo_items], ["a", "b"])
+            undo()
+            self.assertEqual([item.name for item in bpy.data.objects["UndoObject"].undo_items], ["a"])
+        finally:
+            del bpy.types.Object.undo_items
+
+
+if __name__ == '__main__':
+    import sys
+    sys.argv = [__file__] + (sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else [])
+    unittest.main()